@@ -53,6 +53,8 @@
 #include "../multithread.h"
 #include "aes.h"
 
+#include <dvfs_b91.h>
+
 /* Parameter validation macros based on platform_util.h */
 #define AES_VALIDATE_RET(cond) MBEDTLS_INTERNAL_VALIDATE_RET(cond, MBEDTLS_ERR_AES_BAD_INPUT_DATA)
 #define AES_VALIDATE(cond)     MBEDTLS_INTERNAL_VALIDATE(cond)
@@ -756,7 +758,9 @@ int mbedtls_internal_aes_encrypt(mbedtls_aes_context *ctx, const unsigned char i
 {
     if (ctx->nr == 10) {
         mbedtls_aes_lock();
+        B91DvfsBoost();
         (void)aes_encrypt((unsigned char *)ctx->buf, (unsigned char *)input, output);
+        B91DvfsUnboost();
         mbedtls_aes_unlock();
         return 0;
     }
@@ -768,6 +772,9 @@ int mbedtls_internal_aes_encrypt(mbedtls_aes_context *ctx, const unsigned char i
         uint32_t Y[4];
     } t;
 
+    /* Key sizes other than 128 bits are done in software */
+    B91DvfsBoost();
+
     GET_UINT32_LE(t.X[0], input, 0);
     t.X[0] ^= *RK++;
     GET_UINT32_LE(t.X[1], input, 4);
@@ -802,6 +809,7 @@ int mbedtls_internal_aes_encrypt(mbedtls_aes_context *ctx, const unsigned char i
     PUT_UINT32_LE(t.X[3], output, 12);
 
     mbedtls_platform_zeroize(&t, sizeof(t));
+    B91DvfsUnboost();
 
     return (0);
 }
@@ -815,7 +823,9 @@ int mbedtls_internal_aes_decrypt(mbedtls_aes_context *ctx, const unsigned char i
 {
     if (ctx->nr == 10) {
         mbedtls_aes_lock();
+        B91DvfsBoost();
         (void)aes_decrypt((unsigned char *)ctx->buf, (unsigned char *)input, output);
+        B91DvfsUnboost();
         mbedtls_aes_unlock();
         return 0;
     }
@@ -827,6 +837,8 @@ int mbedtls_internal_aes_decrypt(mbedtls_aes_context *ctx, const unsigned char i
         uint32_t Y[4];
     } t;
 
+    B91DvfsBoost();
+
     GET_UINT32_LE(t.X[0], input, 0);
     t.X[0] ^= *RK++;
     GET_UINT32_LE(t.X[1], input, 4);
@@ -861,6 +873,7 @@ int mbedtls_internal_aes_decrypt(mbedtls_aes_context *ctx, const unsigned char i
     PUT_UINT32_LE(t.X[3], output, 12);
 
     mbedtls_platform_zeroize(&t, sizeof(t));
+    B91DvfsUnboost();
 
     return (0);
 }
@@ -48,6 +48,8 @@
 #include "pke.h"
 #include <string.h>
 
+#include <dvfs_b91.h>
+
 #if defined(MBEDTLS_ECP_ALT)
 
 /****************************************************************
@@ -243,10 +245,12 @@ int ecp_alt_b91_backend_check_pubkey(const mbedtls_ecp_group *grp, const mbedtls
                     (void)mbedtls_mpi_write_binary_le(&pt->Y, (unsigned char *)Qy, sizeof(Qy));
 
                     mbedtls_ecp_lock();
+                    B91DvfsBoost();
                     if (pke_eccp_point_verify(eccp_curve, Qx, Qy) == PKE_SUCCESS)
                         result = 0;
                     else
                         result = MBEDTLS_ERR_ECP_INVALID_KEY;
+                    B91DvfsUnboost();
                     mbedtls_ecp_unlock();
                 }
             }
@@ -280,6 +284,7 @@ int ecp_alt_b91_backend_mul(
                     (void)mbedtls_mpi_write_binary_le(&P->Y, (unsigned char *)Qy, sizeof(Qy));
 
                     mbedtls_ecp_lock();
+                    B91DvfsBoost();
                     if (pke_eccp_point_mul(eccp_curve, ms, Qx, Qy, Qx, Qy) == PKE_SUCCESS) {
                         (void)mbedtls_mpi_read_binary_le(&R->X, (const unsigned char *)Qx, sizeof(Qx));
                         (void)mbedtls_mpi_read_binary_le(&R->Y, (const unsigned char *)Qy, sizeof(Qy));
@@ -287,6 +292,7 @@ int ecp_alt_b91_backend_mul(
                         result = 0;
                     } else
                         result = MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+                    B91DvfsUnboost();
                     mbedtls_ecp_unlock();
                 }
             }
@@ -299,6 +305,7 @@ int ecp_alt_b91_backend_mul(
                     (void)mbedtls_mpi_write_binary_le(&P->X, (unsigned char *)Qx, sizeof(Qx));
 
                     mbedtls_ecp_lock();
+                    B91DvfsBoost();
                     if (pke_x25519_point_mul(mont_curve, ms, Qx, Qx) == PKE_SUCCESS) {
                         (void)mbedtls_mpi_read_binary_le(&R->X, (const unsigned char *)Qx, sizeof(Qx));
                         (void)mbedtls_mpi_lset(&R->Y, 0);
@@ -306,6 +313,7 @@ int ecp_alt_b91_backend_mul(
                         result = 0;
                     } else
                         result = MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+                    B91DvfsUnboost();
                     mbedtls_ecp_unlock();
                 }
             }
@@ -343,6 +351,7 @@ int ecp_alt_b91_backend_muladd(mbedtls_ecp_group *grp, mbedtls_ecp_point *R, con
                     result = MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
 
                     mbedtls_ecp_lock();
+                    B91DvfsBoost();
 
                     do {
                         (void)mbedtls_mpi_write_binary_le(m, (unsigned char *)ms, sizeof(ms));
@@ -362,6 +371,7 @@ int ecp_alt_b91_backend_muladd(mbedtls_ecp_group *grp, mbedtls_ecp_point *R, con
                         result = 0;
                     } while (0);
 
+                    B91DvfsUnboost();
                     mbedtls_ecp_unlock();
                 }
             }
@@ -24,6 +24,7 @@
 
 #include <los_compiler.h>
 
+
 #include "hal_hota_board.h"
 
 #include <B91/flash.h>
@@ -29,6 +29,9 @@
 #include <unistd.h>
 
 #include <hiview_log.h>
+#include <los_event.h>
+
+#include <boot_b91.h>
 
 #include <hal_file.h>
 #include <utils_file.h>
@@ -107,6 +110,11 @@ static char *GetActualFilePath(const char *path)
     int len;
     char *file_path = NULL;
 
+    /* With B91_LAZY_INIT /data is mounted by the late init task, which may still be running */
+    if (B91BootWaitLateInit(LOS_WAIT_FOREVER) != LOS_OK) {
+        return NULL;
+    }
+
     len = strnlen(path, MAX_PATH_LEN);
     if (len >= MAX_PATH_LEN) {
         printf("path is too long!\r\n");
@@ -42,10 +42,14 @@
 #include "application\print\printf.h"
 #include "assert.h"
 #include "common\compiler.h"
+#include "drivers/B91/stimer.h"
+#include "lf_pool.h"
 #include "types.h"
 #include "utility.h"
 #include <buf_pool0/myBuf.h>
 #include <buf_pool0/myHeap.h>
+#include <usb_dbg/myudb.h>
+#include <string.h>
 
 /**************************************************************************************************
   Global Variables
@@ -92,7 +96,7 @@ void myCsExit(void)
 
 /* Unit of memory storage-- a structure containing a pointer. */
 typedef struct myBufMem_tag {
-    struct myBufMem_tag *pNext;
+    struct myBufMem_tag *pNext; /* Free list link of the lf_pool while the buffer is free. */
 #if MY_BUF_FREE_CHECK_ASSERT == TRUE
     u32 free;
 #endif
@@ -102,7 +106,7 @@ typedef struct myBufMem_tag {
 typedef struct {
     myBufPoolDesc_t desc; /* Number of buffers and length. */
     myBufMem_t *pStart;   /* Start of pool. */
-    myBufMem_t *pFree;    /* First free buffer in pool. */
+    lf_pool_t pool;       /* Free buffers, taken and given back without a critical section. */
 #if MY_BUF_STATS == TRUE
     u8 numAlloc;   /* Number of buffers currently allocated from pool. */
     u8 maxAlloc;   /* Maximum buffers ever allocated from pool. */
@@ -136,6 +140,170 @@ _attribute_data_retention_ u8 myPoolOverFlowCount[MY_BUF_STATS_MAX_POOL];
 _attribute_data_retention_ static myBufDiagCback_t myBufDiagCback = NULL;
 #endif
 
+#if MY_BUF_DIAG == TRUE
+/* Outstanding buffer, tracked by its position among all buffers. */
+typedef struct {
+    u32 ms;     /* OS time of the allocation in milliseconds. */
+    u16 len;    /* Requested length. */
+    u8 site;    /* Index in myBufDiagSites, MY_BUF_DIAG_NO_SITE if the table was full. */
+    u8 live;    /* Set while allocated. */
+} myBufDiagBuf_t;
+
+#define MY_BUF_DIAG_NO_SITE 0xFF
+
+/* Wraps of the system timer counted by the default myBufDiagTimeMs(). */
+_attribute_data_retention_ static u32 myBufDiagTimeLast;
+_attribute_data_retention_ static u32 myBufDiagTimeHigh;
+
+/* The 32 bit system timer wraps within minutes, so it is extended by the wraps seen between two calls;
+ * that misses a wrap if no buffer is allocated or reported for a whole timer period. A platform with a
+ * 64 bit time base provides its own myBufDiagTimeMs(). */
+__attribute__((weak)) u32 myBufDiagTimeMs(void)
+{
+    u32 r = irq_disable();
+    u32 now = stimer_get_tick();
+    if (now < myBufDiagTimeLast) {
+        myBufDiagTimeHigh++;
+    }
+    myBufDiagTimeLast = now;
+    u64 ticks = ((u64)myBufDiagTimeHigh << 32) | now;
+    irq_restore(r);
+
+    return (u32)(ticks / SYSTEM_TIMER_TICK_1MS);
+}
+
+/* Pool diagnostics; bufSize is not used, the pool descriptor has it. */
+_attribute_data_retention_ static myBufDiagPoolStat_t myBufDiagPools[MY_BUF_STATS_MAX_POOL];
+
+/* Position of the first buffer of each pool among all buffers. */
+_attribute_data_retention_ static u16 myBufDiagFirstBuf[MY_BUF_STATS_MAX_POOL];
+
+_attribute_data_retention_ static myBufDiagSite_t myBufDiagSites[MY_BUF_DIAG_MAX_SITE];
+
+_attribute_data_retention_ static myBufDiagBuf_t myBufDiagBufs[MY_BUF_DIAG_MAX_BUF];
+#endif
+
+#if MY_BUF_STATS == TRUE
+/* Raise a statistics watermark, another context may raise it at the same time. */
+static void myBufStatMax8(u8 *pMax, u8 val)
+{
+    u8 cur = __atomic_load_n(pMax, __ATOMIC_RELAXED);
+
+    while ((val > cur) &&
+           !__atomic_compare_exchange_n(pMax, &cur, val, TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+#endif
+
+#if (MY_BUF_STATS == TRUE) || (MY_BUF_DIAG == TRUE)
+static void myBufStatMax16(u16 *pMax, u16 val)
+{
+    u16 cur = __atomic_load_n(pMax, __ATOMIC_RELAXED);
+
+    while ((val > cur) &&
+           !__atomic_compare_exchange_n(pMax, &cur, val, TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+#endif
+
+#if MY_BUF_DIAG == TRUE
+static void myBufStatMax32(u32 *pMax, u32 val)
+{
+    u32 cur = __atomic_load_n(pMax, __ATOMIC_RELAXED);
+
+    while ((val > cur) &&
+           !__atomic_compare_exchange_n(pMax, &cur, val, TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+/*!
+ *  \brief  Find or add the allocation site of a caller.
+ *
+ *  \param  caller  Return address of the myBufAlloc() call.
+ *
+ *  \return Index in myBufDiagSites, MY_BUF_DIAG_NO_SITE if the table is full.
+ */
+static u8 myBufDiagSiteGet(u32 caller)
+{
+    u8 i = (u8)((caller >> 1) % MY_BUF_DIAG_MAX_SITE);
+
+    for (u8 n = 0; n < MY_BUF_DIAG_MAX_SITE; n++) {
+        u32 cur = __atomic_load_n(&myBufDiagSites[i].caller, __ATOMIC_RELAXED);
+
+        if (cur == caller) {
+            return i;
+        }
+        /* Claim an empty slot; another context may claim it first, for the same caller or not. */
+        if ((cur == 0) && (__atomic_compare_exchange_n(&myBufDiagSites[i].caller, &cur, caller, FALSE,
+                                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED) ||
+                           (cur == caller))) {
+            return i;
+        }
+        i = (i + 1) % MY_BUF_DIAG_MAX_SITE;
+    }
+    return MY_BUF_DIAG_NO_SITE;
+}
+
+/*!
+ *  \brief  Account for an allocation.
+ *
+ *  \param  poolId  Pool of the buffer.
+ *  \param  pPool   Pool of the buffer.
+ *  \param  pBuf    Buffer.
+ *  \param  len     Requested length.
+ *  \param  caller  Return address of the myBufAlloc() call.
+ */
+static void myBufDiagAlloc(u8 poolId, myBufPool_t *pPool, myBufMem_t *pBuf, u16 len, u32 caller)
+{
+    myBufDiagPoolStat_t *pStat = &myBufDiagPools[poolId];
+    u8 site = myBufDiagSiteGet(caller);
+    u32 pos = myBufDiagFirstBuf[poolId] + lf_pool_index(&pPool->pool, pBuf);
+
+    __atomic_fetch_add(&pStat->allocs, 1, __ATOMIC_RELAXED);
+    myBufStatMax32(&pStat->maxAlloc, __atomic_add_fetch(&pStat->numAlloc, 1, __ATOMIC_RELAXED));
+    myBufStatMax16(&pStat->maxReqLen, len);
+
+    if (site != MY_BUF_DIAG_NO_SITE) {
+        myBufDiagSite_t *pSite = &myBufDiagSites[site];
+        __atomic_fetch_add(&pSite->allocs, 1, __ATOMIC_RELAXED);
+        myBufStatMax32(&pSite->maxAlloc, __atomic_add_fetch(&pSite->numAlloc, 1, __ATOMIC_RELAXED));
+    }
+
+    /* The buffer is ours until it is freed, no other context writes its entry. */
+    if (pos < MY_BUF_DIAG_MAX_BUF) {
+        myBufDiagBufs[pos].ms = myBufDiagTimeMs();
+        myBufDiagBufs[pos].len = len;
+        myBufDiagBufs[pos].site = site;
+        __atomic_store_n(&myBufDiagBufs[pos].live, TRUE, __ATOMIC_RELEASE);
+    }
+}
+
+/*!
+ *  \brief  Account for a free.
+ *
+ *  \param  poolId  Pool of the buffer.
+ *  \param  pPool   Pool of the buffer.
+ *  \param  pBuf    Buffer.
+ */
+static void myBufDiagFree(u8 poolId, myBufPool_t *pPool, myBufMem_t *pBuf)
+{
+    myBufDiagPoolStat_t *pStat = &myBufDiagPools[poolId];
+    u32 pos = myBufDiagFirstBuf[poolId] + lf_pool_index(&pPool->pool, pBuf);
+
+    __atomic_fetch_add(&pStat->frees, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_sub(&pStat->numAlloc, 1, __ATOMIC_RELAXED);
+
+    if (pos < MY_BUF_DIAG_MAX_BUF) {
+        u8 site = myBufDiagBufs[pos].site;
+        __atomic_store_n(&myBufDiagBufs[pos].live, FALSE, __ATOMIC_RELAXED);
+        if (site != MY_BUF_DIAG_NO_SITE) {
+            __atomic_fetch_sub(&myBufDiagSites[site].numAlloc, 1, __ATOMIC_RELAXED);
+        }
+    }
+}
+#endif
+
 /*!
  *  \brief  Calculate size required by the buffer pool.
  *
@@ -199,7 +367,6 @@ u32 myBufInit(u8 numPools, myBufPoolDesc_t *pDesc)
     myBufPool_t *pPool;
     myBufMem_t *pStart;
     u16 len;
-    u8 i;
 
     myBufMem = (myBufMem_t *)myHeapGetFreeStartAddress();
     pPool = (myBufPool_t *)myBufMem;
@@ -208,6 +375,13 @@ u32 myBufInit(u8 numPools, myBufPoolDesc_t *pDesc)
     pStart = (myBufMem_t *)(pPool + numPools);
 
     myBufNumPools = numPools;
+#if MY_BUF_DIAG == TRUE
+    assert(numPools <= MY_BUF_STATS_MAX_POOL);
+    memset(myBufDiagPools, 0, sizeof(myBufDiagPools));
+    memset(myBufDiagSites, 0, sizeof(myBufDiagSites));
+    memset(myBufDiagBufs, 0, sizeof(myBufDiagBufs));
+    u16 firstBuf = 0;
+#endif
 
     /* Create each pool; see loop exit condition below. */
     while (TRUE) {
@@ -233,36 +407,35 @@ u32 myBufInit(u8 numPools, myBufPoolDesc_t *pDesc)
 
         pPool->desc.num = pDesc->num;
         pDesc++;
+#if MY_BUF_DIAG == TRUE
+        if ((pPool - (myBufPool_t *)myBufMem) < MY_BUF_STATS_MAX_POOL) {
+            myBufDiagFirstBuf[pPool - (myBufPool_t *)myBufMem] = firstBuf;
+        }
+        firstBuf += pPool->desc.num;
+#endif
 
         pPool->pStart = pStart;
-        pPool->pFree = pStart;
 #if MY_BUF_STATS == TRUE
         pPool->numAlloc = 0;
         pPool->maxAlloc = 0;
         pPool->maxReqLen = 0;
 #endif
 
-        /* Initialize free list. */
-        len = pPool->desc.len / sizeof(myBufMem_t);
-        for (i = pPool->desc.num; i > 1; i--) {
-            /* Verify we didn't overrun memory; if we did, abort. */
-            if (pStart > &myBufMem[myHeapCountAvailable() / sizeof(myBufMem_t)]) {
-                assert(FALSE);
-                return 0;
-            }
-            /* Pointer to the next free buffer is stored in the buffer itself. */
-            pStart->pNext = pStart + len;
-            pStart += len;
-        }
-
         /* Verify we didn't overrun memory; if we did, abort. */
-        if (pStart > &myBufMem[myHeapCountAvailable() / sizeof(myBufMem_t)]) {
+        len = pPool->desc.len / sizeof(myBufMem_t);
+        if (pStart + len * (pPool->desc.num - 1) > &myBufMem[myHeapCountAvailable() / sizeof(myBufMem_t)]) {
             assert(FALSE);
             return 0;
         }
-        /* Last one in list points to NULL. */
-        pStart->pNext = NULL;
-        pStart += len;
+
+        /* Initialize free list. */
+        lf_pool_init(&pPool->pool, pStart, pPool->desc.len, pPool->desc.num);
+#if MY_BUF_FREE_CHECK_ASSERT == TRUE
+        for (u8 i = 0; i < pPool->desc.num; i++) {
+            pStart[i * len].free = MY_BUF_FREE_NUM;
+        }
+#endif
+        pStart += len * pPool->desc.num;
 
         /* Next pool. */
         pPool++;
@@ -293,48 +466,39 @@ void *myBufAlloc(u16 len)
     for (i = myBufNumPools; i > 0; i--, pPool++) {
         /* Check if buffer is big enough. */
         if (len <= pPool->desc.len) {
-            /* Enter critical section. */
-            myCsEnter();
+            /* Take a buffer, interrupts stay enabled. */
+            pBuf = (myBufMem_t *)lf_pool_alloc(&pPool->pool);
 
-            /* Check if buffers are available. */
-            if (pPool->pFree != NULL) {
+            if (pBuf != NULL) {
                 /* Allocation succeeded. */
-                pBuf = pPool->pFree;
-
-                /* Next free buffer is stored inside current free buffer. */
-                pPool->pFree = pBuf->pNext;
-
 #if MY_BUF_FREE_CHECK_ASSERT == TRUE
                 pBuf->free = 0;
 #endif
 #if MY_BUF_STATS_HIST == TRUE
                 /* Increment count for buffers of this length. */
                 if (len < MY_BUF_STATS_MAX_LEN) {
-                    myBufAllocCount[len]++;
+                    __atomic_fetch_add(&myBufAllocCount[len], 1, __ATOMIC_RELAXED);
                 } else {
-                    myBufAllocCount[0]++;
+                    __atomic_fetch_add(&myBufAllocCount[0], 1, __ATOMIC_RELAXED);
                 }
 #endif
 #if MY_BUF_STATS == TRUE
-                if (++pPool->numAlloc > pPool->maxAlloc) {
-                    pPool->maxAlloc = pPool->numAlloc;
-                }
-                pPool->maxReqLen = max2(pPool->maxReqLen, len);
+                myBufStatMax8(&pPool->maxAlloc, __atomic_add_fetch(&pPool->numAlloc, 1, __ATOMIC_RELAXED));
+                myBufStatMax16(&pPool->maxReqLen, len);
+#endif
+#if MY_BUF_DIAG == TRUE
+                myBufDiagAlloc(myBufNumPools - i, pPool, pBuf, len, (u32)__builtin_return_address(0));
 #endif
-                /* Exit critical section. */
-                myCsExit();
-                ;
-
                 return pBuf;
             } else {
 #if MY_BUF_STATS_HIST == TRUE
                 /* Pool overflow: increment count of overflow for current pool. */
-                myPoolOverFlowCount[myBufNumPools - i]++;
+                __atomic_fetch_add(&myPoolOverFlowCount[myBufNumPools - i], 1, __ATOMIC_RELAXED);
+#endif
+#if MY_BUF_DIAG == TRUE
+                __atomic_fetch_add(&myBufDiagPools[myBufNumPools - i].empty, 1, __ATOMIC_RELAXED);
 #endif
             }
-            /* Exit critical section. */
-            myCsExit();
-            ;
 
 #if MY_BUF_ALLOC_BEST_FIT_FAIL_ASSERT == TRUE
             assert(FALSE);
@@ -386,24 +550,22 @@ void myBufFree(void *pBuf)
     while (pPool >= (myBufPool_t *)myBufMem) {
         /* Check if the buffer memory is located inside this pool. */
         if (p >= pPool->pStart) {
-            /* Enter critical section. */
-            myCsEnter();
-
 #if MY_BUF_FREE_CHECK_ASSERT == TRUE
-            assert(p->free != MY_BUF_FREE_NUM);
-            p->free = MY_BUF_FREE_NUM;
+            /* The swap lets only one of two racing frees of the same buffer pass. */
+            if (__atomic_exchange_n(&p->free, MY_BUF_FREE_NUM, __ATOMIC_RELAXED) == MY_BUF_FREE_NUM) {
+                assert(FALSE);
+                return;
+            }
 #endif
 #if MY_BUF_STATS == TRUE
-            pPool->numAlloc--;
+            __atomic_fetch_sub(&pPool->numAlloc, 1, __ATOMIC_RELAXED);
+#endif
+#if MY_BUF_DIAG == TRUE
+            myBufDiagFree(pPool - (myBufPool_t *)myBufMem, pPool, p);
 #endif
 
             /* Pool found; put buffer back in free list. */
-            p->pNext = pPool->pFree;
-            pPool->pFree = p;
-
-            /* Exit critical section. */
-            myCsExit();
-            ;
+            lf_pool_free(&pPool->pool, p);
 
             return;
         }
@@ -505,4 +667,125 @@ void myBufDiagRegister(myBufDiagCback_t callback)
     /* Unused parameter */
     (void)callback;
 #endif
-}
\ No newline at end of file
+}
+
+/*!
+ *  \brief  Get the 32 bit diagnostics of a pool.
+ *
+ *  \param  poolId  Pool ID.
+ *  \param  pStat   Buffer to store the statistics.
+ */
+void myBufDiagGetPoolStat(u8 poolId, myBufDiagPoolStat_t *pStat)
+{
+    memset(pStat, 0, sizeof(*pStat));
+
+    if (poolId >= myBufNumPools) {
+        return;
+    }
+
+#if MY_BUF_DIAG == TRUE
+    if (poolId < MY_BUF_STATS_MAX_POOL) {
+        *pStat = myBufDiagPools[poolId];
+    }
+#endif
+    pStat->bufSize = ((myBufPool_t *)myBufMem)[poolId].desc.len;
+}
+
+/*!
+ *  \brief  Get the allocation sites seen so far.
+ *
+ *  \param  pSites    Buffer to store the sites.
+ *  \param  maxSites  Number of elements of pSites.
+ *
+ *  \return Number of sites stored.
+ */
+u8 myBufDiagGetSites(myBufDiagSite_t *pSites, u8 maxSites)
+{
+    u8 num = 0;
+
+#if MY_BUF_DIAG == TRUE
+    for (u8 i = 0; (i < MY_BUF_DIAG_MAX_SITE) && (num < maxSites); i++) {
+        if (myBufDiagSites[i].caller != 0) {
+            pSites[num++] = myBufDiagSites[i];
+        }
+    }
+#else
+    (void)pSites;
+    (void)maxSites;
+#endif
+
+    return num;
+}
+
+/*!
+ *  \brief  Dump the pool and allocation site diagnostics to the USB debug channel.
+ */
+void myBufDiagDump(void)
+{
+#if MY_BUF_DIAG == TRUE
+    for (u8 i = 0; i < myBufNumPools; i++) {
+        myBufDiagPoolStat_t stat;
+
+        myBufDiagGetPoolStat(i, &stat);
+        /* size and max request length, allocs, frees, empty, outstanding and high watermark */
+        my_dump_str_u32s(1, "myBuf pool size/req, allocs, frees, empty", (stat.bufSize << 16) | stat.maxReqLen,
+                         stat.allocs, stat.frees, stat.empty);
+        my_dump_str_u32s(1, "myBuf pool size, out, max out", stat.bufSize, stat.numAlloc, stat.maxAlloc, 0);
+    }
+
+    for (u8 i = 0; i < MY_BUF_DIAG_MAX_SITE; i++) {
+        myBufDiagSite_t site = myBufDiagSites[i];
+
+        if (site.caller != 0) {
+            my_dump_str_u32s(1, "myBuf site caller, allocs, out, max out", site.caller, site.allocs,
+                             site.numAlloc, site.maxAlloc);
+        }
+    }
+#endif
+}
+
+/*!
+ *  \brief  Dump the buffers outstanding for longer than minAgeMs to the USB debug channel.
+ *
+ *  \param  minAgeMs  Minimum age in milliseconds.
+ *
+ *  \return Number of such buffers.
+ */
+u16 myBufDiagLeakReport(u32 minAgeMs)
+{
+    u16 num = 0;
+
+#if MY_BUF_DIAG == TRUE
+    u32 now = myBufDiagTimeMs();
+    myBufPool_t *pPool = (myBufPool_t *)myBufMem;
+
+    for (u8 poolId = 0; (poolId < myBufNumPools) && (poolId < MY_BUF_STATS_MAX_POOL); poolId++, pPool++) {
+        for (u16 j = 0; j < pPool->desc.num; j++) {
+            u32 pos = myBufDiagFirstBuf[poolId] + j;
+            if (pos >= MY_BUF_DIAG_MAX_BUF) {
+                break;
+            }
+
+            if (!__atomic_load_n(&myBufDiagBufs[pos].live, __ATOMIC_ACQUIRE)) {
+                continue;
+            }
+            myBufDiagBuf_t buf = myBufDiagBufs[pos];
+
+            u32 ageMs = now - buf.ms;
+            if (ageMs < minAgeMs) {
+                continue;
+            }
+
+            /* The caller is 0 when the site table was full. */
+            my_dump_str_u32s(1, "myBuf leak buf, caller, len, age ms", (u32)pPool->pStart + j * pPool->desc.len,
+                             (buf.site != MY_BUF_DIAG_NO_SITE) ? myBufDiagSites[buf.site].caller : 0, buf.len,
+                             ageMs);
+            num++;
+        }
+    }
+#else
+    (void)minAgeMs;
+#endif
+
+    return num;
+}
@@ -75,6 +75,11 @@ extern "C" {
 #define MY_BUF_STATS_HIST FALSE  // TRUE
 #endif
 
+/*! \brief Diagnostics: 32 bit pool counters, allocation sites and outstanding buffer report */
+#ifndef MY_BUF_DIAG
+#define MY_BUF_DIAG FALSE
+#endif
+
 /**************************************************************************************************
   Macros
 **************************************************************************************************/
@@ -85,6 +90,16 @@ extern "C" {
 /*! \brief Max number of pools can allocate */
 #define MY_BUF_STATS_MAX_POOL 32
 
+/*! \brief Most buffers, of all pools, whose allocation site and age are tracked with MY_BUF_DIAG */
+#ifndef MY_BUF_DIAG_MAX_BUF
+#define MY_BUF_DIAG_MAX_BUF 128
+#endif
+
+/*! \brief Most allocation sites counted with MY_BUF_DIAG */
+#ifndef MY_BUF_DIAG_MAX_SITE
+#define MY_BUF_DIAG_MAX_SITE 16
+#endif
+
 /*! \brief Failure Codes */
 #define MY_BUF_ALLOC_FAILED 1
 
@@ -112,6 +127,25 @@ typedef struct {
     u16 maxReqLen; /*!< \brief Maximum requested buffer length. */
 } myBufPoolStat_t;
 
+/*! \brief Pool diagnostics, MY_BUF_DIAG */
+typedef struct {
+    u32 allocs;    /*!< \brief Buffers allocated. */
+    u32 frees;     /*!< \brief Buffers freed. */
+    u32 empty;     /*!< \brief Requests that fit the pool but found it empty. */
+    u32 numAlloc;  /*!< \brief Number of outstanding allocations. */
+    u32 maxAlloc;  /*!< \brief High allocation watermark. */
+    u16 bufSize;   /*!< \brief Pool buffer size. */
+    u16 maxReqLen; /*!< \brief Maximum requested buffer length. */
+} myBufDiagPoolStat_t;
+
+/*! \brief Allocation site diagnostics, MY_BUF_DIAG */
+typedef struct {
+    u32 caller;   /*!< \brief Return address of the myBufAlloc() call. */
+    u32 allocs;   /*!< \brief Buffers allocated from the site. */
+    u32 numAlloc; /*!< \brief Buffers of the site outstanding. */
+    u32 maxAlloc; /*!< \brief High watermark of the outstanding buffers of the site. */
+} myBufDiagSite_t;
+
 /*! \brief MY buffer diagnostics - buffer allocation failure */
 typedef struct {
     u8 taskId; /*!< \brief Task handler ID where failure occured */
@@ -217,6 +251,48 @@ void myBufGetPoolStats(myBufPoolStat_t *pStat, u8 numPool);
  */
 void myBufDiagRegister(myBufDiagCback_t callback);
 
+/*!
+ *  \brief  Get the 32 bit diagnostics of a pool, all zero without MY_BUF_DIAG.
+ *
+ *  \param  poolId  Pool ID.
+ *  \param  pStat   Buffer to store the statistics.
+ */
+void myBufDiagGetPoolStat(u8 poolId, myBufDiagPoolStat_t *pStat);
+
+/*!
+ *  \brief  Get the allocation sites seen so far.
+ *
+ *  \param  pSites    Buffer to store the sites.
+ *  \param  maxSites  Number of elements of pSites.
+ *
+ *  \return Number of sites stored.
+ */
+u8 myBufDiagGetSites(myBufDiagSite_t *pSites, u8 maxSites);
+
+/*!
+ *  \brief  Dump the pool and allocation site diagnostics to the USB debug channel.
+ */
+void myBufDiagDump(void);
+
+/*!
+ *  \brief  Time base of the buffer ages, milliseconds since start. The weak default extends the system
+ *          timer across its wraps as long as it is called at least once per timer period; a platform
+ *          with a 64 bit time base overrides it.
+ *
+ *  \return Time in milliseconds, wrapping after 49 days.
+ */
+u32 myBufDiagTimeMs(void);
+
+/*!
+ *  \brief  Dump the buffers outstanding for longer than minAgeMs to the USB debug channel, with their
+ *          pool, length and allocation site.
+ *
+ *  \param  minAgeMs  Minimum age in milliseconds.
+ *
+ *  \return Number of such buffers.
+ */
+u16 myBufDiagLeakReport(u32 minAgeMs);
+
 /*! \} */ /* MY_BUF_API */
 
 #ifdef __cplusplus
@@ -17,6 +17,7 @@
  *****************************************************************************/
 #include "ev_buffer.h"
 #include "common/assert.h"
+#include "common/lf_pool.h"
 #include "common/utility.h"
 #include "drivers/B91/ext_driver/ext_misc.h"
 #include "mempool.h"
@@ -29,32 +30,80 @@
 
 #if 1
 
-#define DEFAULT_BUFFER_GROUP_NUM 3
+#define EV_BUF_HEADER_SIZE   OFFSETOF(ev_bufItem_t, data)
+#define EV_BUF_BLOCK_SIZE(s) MEMPOOL_ITEMSIZE_2_BLOCKSIZE(s)
+#define EV_BUF_NO_BIN        0xff
 
 /**************************** Private Variable Definitions *******************/
 
 typedef struct {
-    mem_pool_t *qHead;
+    lf_pool_t pool;
     u16 size;
-    u8 availBufNum;
-    u8 reserved;
+    volatile u16 availBufNum;
+    u16 firstBlock; /* position of the first block of the group in ev_buf_state */
+    u16 reserved;
 } ev_buf_groups_t;
 
+enum {
+    EV_BUF_STATE_FREE,
+    EV_BUF_STATE_USED,
+};
+
 typedef struct bufm_vars {
-    ev_buf_groups_t bufGroups[DEFAULT_BUFFER_GROUP_NUM];
+    ev_buf_groups_t bufGroups[EV_BUFFER_GROUP_MAX];
+    u8 groupNum;
 } ev_buf_vars_t;
 
 ev_buf_vars_t ev_buf_vs;
 ev_buf_vars_t *ev_buf_v = &ev_buf_vs;
 
-MEMPOOL_DECLARE(size_0_pool, size_0_mem, BUFFER_GROUP_0, BUFFER_NUM_IN_GROUP0);
-MEMPOOL_DECLARE(size_1_pool, size_1_mem, BUFFER_GROUP_1, BUFFER_NUM_IN_GROUP1);
-MEMPOOL_DECLARE(size_2_pool, size_2_mem, BUFFER_GROUP_2, BUFFER_NUM_IN_GROUP2);
+static const ev_buf_groupCfg_t ev_buf_defaultCfg[] = {
+    {BUFFER_GROUP_0, BUFFER_NUM_IN_GROUP0},
+    {BUFFER_GROUP_1, BUFFER_NUM_IN_GROUP1},
+    {BUFFER_GROUP_2, BUFFER_NUM_IN_GROUP2},
+};
+
+/* geometry applied by ev_buf_reset, the default one until ev_buf_config */
+static ev_buf_groupCfg_t ev_buf_cfg[EV_BUFFER_GROUP_MAX];
+static u8 ev_buf_cfgNum;
+
+u8 ev_buf_mem[EV_BUFFER_MEM_SIZE] _attribute_aligned_(4);
+
+/* EV_BUF_STATE_xxx of each block, the blocks of a group from its firstBlock on */
+static volatile u8 ev_buf_state[EV_BUFFER_BLOCK_MAX];
+
+#if EV_BUFFER_PROFILE
+static ev_buf_profile_t ev_buf_prof;
+
+/* histogram bin of the request each block holds */
+static u8 ev_buf_reqBin[EV_BUFFER_BLOCK_MAX];
+#endif
+
+/*********************************************************************
+ * @fn      ev_buf_blockIndex
+ *
+ * @brief   Return the position of a block in ev_buf_state
+ *
+ * @param   index - group index
+ * @param   block - block header
+ *
+ * @return  position of the block, -1 if it is not the start of a block of the group
+ */
+static int ev_buf_blockIndex(u8 index, mem_block_t *block)
+{
+    if (index >= ev_buf_v->groupNum) {
+        return -1;
+    }
+
+    int pos = lf_pool_index(&ev_buf_v->bufGroups[index].pool, block);
+    return (pos < 0) ? -1 : (ev_buf_v->bufGroups[index].firstBlock + pos);
+}
 
 /*********************************************************************
  * @fn      ev_buf_isExisted
  *
- * @brief   Return whether the buffer is in the available buffer
+ * @brief   Return whether the buffer is in the available buffer.
+ *          The state of each block is kept aside, so the free list is not walked.
  *
  * @param   index
  * @param   block
@@ -63,17 +112,12 @@ MEMPOOL_DECLARE(size_2_pool, size_2_mem, BUFFER_GROUP_2, BUFFER_NUM_IN_GROUP2);
  */
 u8 ev_buf_isExisted(u8 index, mem_block_t *block)
 {
-    mem_pool_t *pool = (mem_pool_t *)ev_buf_v->bufGroups[index].qHead;
-    mem_block_t *curBlock = pool->free_list;
+    int pos = ev_buf_blockIndex(index, block);
 
-    while (curBlock) {
-        if (block == curBlock) {
-            return TRUE;
-        }
-        curBlock = curBlock->next_block;
+    if (pos < 0) {
+        return FALSE;
     }
-
-    return FALSE;
+    return ev_buf_state[pos] == EV_BUF_STATE_FREE;
 }
 
 u8 *ev_buf_retriveMempoolHeader(u8 *pd)
@@ -81,6 +125,78 @@ u8 *ev_buf_retriveMempoolHeader(u8 *pd)
     return pd - (OFFSETOF(ev_bufItem_t, data) - OFFSETOF(mem_block_t, data));
 }
 
+#if EV_BUFFER_PROFILE
+/* raise a peak that other contexts may raise at the same time */
+static void ev_buf_profileMax(u16 *pPeak, u16 val)
+{
+    u16 cur = __atomic_load_n(pPeak, __ATOMIC_RELAXED);
+
+    while ((val > cur) && !__atomic_compare_exchange_n(pPeak, &cur, val, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+static void ev_buf_profileAlloc(u8 index, int pos, u16 size)
+{
+    u8 bin = EV_BUF_NO_BIN;
+
+    if (size > EV_BUFFER_PROFILE_MAX_SIZE) {
+        __atomic_fetch_add(&ev_buf_prof.reqTooLarge, 1, __ATOMIC_RELAXED);
+    } else {
+        bin = (size - 1) / EV_BUFFER_PROFILE_BIN;
+        __atomic_fetch_add(&ev_buf_prof.reqCount[bin], 1, __ATOMIC_RELAXED);
+        ev_buf_profileMax(&ev_buf_prof.reqPeak[bin],
+                          __atomic_add_fetch(&ev_buf_prof.reqLive[bin], 1, __ATOMIC_RELAXED));
+    }
+    ev_buf_reqBin[pos] = bin;
+
+    ev_buf_groups_t *group = &ev_buf_v->bufGroups[index];
+    ev_buf_profileMax(&ev_buf_prof.groupPeak[index], group->pool.num - group->availBufNum);
+}
+
+static void ev_buf_profileFree(int pos)
+{
+    u8 bin = ev_buf_reqBin[pos];
+
+    if (bin != EV_BUF_NO_BIN) {
+        __atomic_fetch_sub(&ev_buf_prof.reqLive[bin], 1, __ATOMIC_RELAXED);
+    }
+}
+#endif
+
+/*********************************************************************
+ * @fn      ev_buf_checkConfig
+ *
+ * @brief   Check a buffer group geometry
+ *
+ * @param   cfg - groups
+ * @param   num - number of groups
+ *
+ * @return  BUFFER_SUCC, BUFFER_INVALID_PARAMETER or BUFFER_NO_MEMORY
+ */
+static buf_sts_t ev_buf_checkConfig(const ev_buf_groupCfg_t *cfg, u8 num)
+{
+    u32 mem = 0;
+    u32 blocks = 0;
+
+    if (!cfg || (num == 0) || (num > EV_BUFFER_GROUP_MAX)) {
+        return BUFFER_INVALID_PARAMETER;
+    }
+
+    for (u8 i = 0; i < num; i++) {
+        if ((cfg[i].size <= EV_BUF_HEADER_SIZE) || (cfg[i].num == 0) || (cfg[i].size > U16_MAX - 3) ||
+            ((i > 0) && (cfg[i].size <= cfg[i - 1].size))) {
+            return BUFFER_INVALID_PARAMETER;
+        }
+        mem += EV_BUF_BLOCK_SIZE(cfg[i].size) * cfg[i].num;
+        blocks += cfg[i].num;
+    }
+
+    if ((mem > EV_BUFFER_MEM_SIZE) || (blocks > EV_BUFFER_BLOCK_MAX)) {
+        return BUFFER_NO_MEMORY;
+    }
+    return BUFFER_SUCC;
+}
+
 /*********************************************************************
  * @fn      ev_buf_reset
  *
@@ -92,19 +208,36 @@ u8 *ev_buf_retriveMempoolHeader(u8 *pd)
  */
 void ev_buf_reset(void)
 {
-    u16 size[DEFAULT_BUFFER_GROUP_NUM] = {BUFFER_GROUP_0, BUFFER_GROUP_1, BUFFER_GROUP_2};
-    mem_pool_t *memPool[DEFAULT_BUFFER_GROUP_NUM] = {&size_0_pool, &size_1_pool, &size_2_pool};
-    u8 *mem[DEFAULT_BUFFER_GROUP_NUM] = {size_0_mem, size_1_mem, size_2_mem};
-    u8 buffCnt[DEFAULT_BUFFER_GROUP_NUM] = {BUFFER_NUM_IN_GROUP0, BUFFER_NUM_IN_GROUP1, BUFFER_NUM_IN_GROUP2};
+    u8 *mem = ev_buf_mem;
+    u16 firstBlock = 0;
+
+    if (ev_buf_cfgNum == 0) {
+        memcpy(ev_buf_cfg, ev_buf_defaultCfg, sizeof(ev_buf_defaultCfg));
+        ev_buf_cfgNum = ARRAY_SIZE(ev_buf_defaultCfg);
+    }
 
     memset((u8 *)ev_buf_v, 0, sizeof(ev_buf_vars_t));
 
     /* reinitialize available buffer */
-    for (u8 i = 0; i < DEFAULT_BUFFER_GROUP_NUM; i++) {
-        ev_buf_v->bufGroups[i].availBufNum = buffCnt[i];
-        ev_buf_v->bufGroups[i].qHead = mempool_init(memPool[i], mem[i], size[i], buffCnt[i]);
-        ev_buf_v->bufGroups[i].size = size[i];
+    for (u8 i = 0; i < ev_buf_cfgNum; i++) {
+        u16 blockSize = EV_BUF_BLOCK_SIZE(ev_buf_cfg[i].size);
+
+        ev_buf_v->bufGroups[i].availBufNum = ev_buf_cfg[i].num;
+        lf_pool_init(&ev_buf_v->bufGroups[i].pool, mem, blockSize, ev_buf_cfg[i].num);
+        ev_buf_v->bufGroups[i].size = ev_buf_cfg[i].size;
+        ev_buf_v->bufGroups[i].firstBlock = firstBlock;
+        mem += blockSize * ev_buf_cfg[i].num;
+        firstBlock += ev_buf_cfg[i].num;
     }
+    ev_buf_v->groupNum = ev_buf_cfgNum;
+    memset((u8 *)ev_buf_state, EV_BUF_STATE_FREE, sizeof(ev_buf_state));
+
+#if EV_BUFFER_PROFILE
+    /* the request histogram does not depend on the geometry, the group counters do */
+    memset(ev_buf_prof.reqLive, 0, sizeof(ev_buf_prof.reqLive));
+    memset(ev_buf_prof.groupPeak, 0, sizeof(ev_buf_prof.groupPeak));
+    memset(ev_buf_prof.groupEmpty, 0, sizeof(ev_buf_prof.groupEmpty));
+#endif
 }
 
 /*********************************************************************
@@ -121,12 +254,62 @@ void ev_buf_init(void)
     ev_buf_reset();
 }
 
+/*********************************************************************
+ * @fn      ev_buf_config
+ *
+ * @brief   Replace the buffer group geometry. Buffers allocated by
+ *          another context during the call are not noticed, the caller
+ *          makes sure there is none.
+ *
+ * @param   cfg - groups in increasing block size
+ * @param   num - number of groups
+ *
+ * @return  status
+ */
+buf_sts_t ev_buf_config(const ev_buf_groupCfg_t *cfg, u8 num)
+{
+    buf_sts_t ret = ev_buf_checkConfig(cfg, num);
+
+    if (ret != BUFFER_SUCC) {
+        return ret;
+    }
+
+    for (u8 i = 0; i < ev_buf_v->groupNum; i++) {
+        if (ev_buf_v->bufGroups[i].availBufNum != ev_buf_v->bufGroups[i].pool.num) {
+            return BUFFER_IN_USE;
+        }
+    }
+
+    memcpy(ev_buf_cfg, cfg, num * sizeof(ev_buf_groupCfg_t));
+    ev_buf_cfgNum = num;
+    ev_buf_reset();
+    return BUFFER_SUCC;
+}
+
+/*********************************************************************
+ * @fn      ev_buf_getConfig
+ *
+ * @brief   Get the current buffer group geometry
+ *
+ * @param   cfg - EV_BUFFER_GROUP_MAX entries
+ *
+ * @return  number of groups
+ */
+u8 ev_buf_getConfig(ev_buf_groupCfg_t *cfg)
+{
+    for (u8 i = 0; i < ev_buf_v->groupNum; i++) {
+        cfg[i].size = ev_buf_v->bufGroups[i].size;
+        cfg[i].num = ev_buf_v->bufGroups[i].pool.num;
+    }
+    return ev_buf_v->groupNum;
+}
+
 /*********************************************************************
  * @fn      ev_buf_allocate
  *
  * @brief   Allocate an available buffer according to the requested size
- *          The allocated buffer will have only three kind of size, defined
- *          in @ref EV_BUFFER_CONSTANT
+ *          The allocated buffer will have only the sizes of the groups
+ *          of the geometry, see @ref ev_buffer_groups
  *
  * @param   size - requested size
  *
@@ -140,40 +323,44 @@ u8 *my_ev_buf_allocate(u16 size, u16 line)
 u8 *ev_buf_allocate(u16 size)
 #endif
 {
-    if ((size == 0) || (size > MAX_BUFFER_SIZE)) {
+    if (size == 0) {
         /* the size parameter is wrong */
         return NULL;
     }
-    u32 r = irq_disable();
-    u8 index = U8_MAX;
-
-    /* find related the buffer blocks */
-    for (u8 i = 0; i < DEFAULT_BUFFER_GROUP_NUM; i++) {
-        if ((size <= ev_buf_v->bufGroups[i].size - OFFSETOF(ev_bufItem_t, data)) &&
-            ev_buf_v->bufGroups[i].availBufNum) {
-            index = i;
-            break;
+
+    /* take a block of the smallest group that fits and still has one, without masking interrupts */
+    ev_bufItem_t *pNewBuf = NULL;
+    u8 index;
+    for (index = 0; index < ev_buf_v->groupNum; index++) {
+        if (size <= ev_buf_v->bufGroups[index].size - EV_BUF_HEADER_SIZE) {
+            pNewBuf = (ev_bufItem_t *)lf_pool_alloc(&ev_buf_v->bufGroups[index].pool);
+            if (pNewBuf) {
+                break;
+            }
+#if EV_BUFFER_PROFILE
+            __atomic_fetch_add(&ev_buf_prof.groupEmpty[index], 1, __ATOMIC_RELAXED);
+#endif
         }
     }
-    if ((index == U8_MAX) || (!ev_buf_v->bufGroups[index].availBufNum)) {
+    if (!pNewBuf) {
         /* no available buffer */
-        irq_restore(r);
-        return NULL;
-    }
-    u8 *temp = (u8 *)mempool_alloc(ev_buf_v->bufGroups[index].qHead);
-    if (!temp) {
-        irq_restore(r);
+#if EV_BUFFER_PROFILE
+        __atomic_fetch_add(&ev_buf_prof.allocFail, 1, __ATOMIC_RELAXED);
+#endif
         return NULL;
     }
-    ev_buf_v->bufGroups[index].availBufNum--;
+    __atomic_fetch_sub(&ev_buf_v->bufGroups[index].availBufNum, 1, __ATOMIC_RELAXED);
 
-    ev_bufItem_t *pNewBuf = (ev_bufItem_t *)(temp - 4);
     pNewBuf->groupIndex = index;
 #if EV_BUFFER_DEBUG
     pNewBuf->line = line;
     pNewBuf->flag = 0xfe;
 #endif
-    irq_restore(r);
+    int pos = ev_buf_blockIndex(index, (mem_block_t *)pNewBuf);
+    ev_buf_state[pos] = EV_BUF_STATE_USED;
+#if EV_BUFFER_PROFILE
+    ev_buf_profileAlloc(index, pos, size);
+#endif
     return pNewBuf->data;
 }
 
@@ -194,8 +381,6 @@ buf_sts_t my_ev_buf_free(u8 *pBuf, u16 line)
 buf_sts_t ev_buf_free(u8 *pBuf)
 #endif
 {
-    u32 r = irq_disable();
-
     if (!is_ev_buf(pBuf)) {
 #if EV_BUFFER_DEBUG
         T_DBG_evFreeBuf = (u32)pBuf;
@@ -204,26 +389,34 @@ buf_sts_t ev_buf_free(u8 *pBuf)
     }
 
     ev_bufItem_t *pDelBuf = ev_buf_getHead(pBuf);
+    u8 index = (u8)pDelBuf->groupIndex;
+    int pos = ev_buf_blockIndex(index, (mem_block_t *)pDelBuf);
+
+    if (pos < 0) {
+        /* not the start of an ev buffer, the free list would be corrupted */
+        return BUFFER_INVALID_PARAMETER;
+    }
 
-    /* check whether the buffer is duplicated release */
-    if (ev_buf_isExisted(pDelBuf->groupIndex, (mem_block_t *)pDelBuf)) {
+    /* check whether the buffer is duplicated release, the swap lets only one of two racing frees pass */
+    if (__atomic_exchange_n(&ev_buf_state[pos], EV_BUF_STATE_FREE, __ATOMIC_RELAXED) == EV_BUF_STATE_FREE) {
 #if EV_BUFFER_DEBUG
         T_DBG_evFreeBuf = (u32)pBuf;
         T_DBG_evFreeBufLine = line;
 #endif
-        irq_restore(r);
         return BUFFER_DUPLICATE_FREE;
     }
 
-    mempool_free(ev_buf_v->bufGroups[pDelBuf->groupIndex].qHead, ev_buf_retriveMempoolHeader(pBuf));
-    ev_buf_v->bufGroups[pDelBuf->groupIndex].availBufNum++;
-
+#if EV_BUFFER_PROFILE
+    ev_buf_profileFree(pos);
+#endif
 #if EV_BUFFER_DEBUG
     pDelBuf->line = line;
     pDelBuf->flag = 0xff;
 #endif
 
-    irq_restore(r);
+    lf_pool_free(&ev_buf_v->bufGroups[index].pool, pDelBuf);
+    __atomic_fetch_add(&ev_buf_v->bufGroups[index].availBufNum, 1, __ATOMIC_RELAXED);
+
     return BUFFER_SUCC;
 }
 
@@ -253,19 +446,15 @@ ev_bufItem_t *ev_buf_getHead(u8 *pd)
  */
 u8 *ev_buf_getTail(u8 *pd, int offsetToTail)
 {
-    u32 index;
-    u16 size[DEFAULT_BUFFER_GROUP_NUM] = {BUFFER_GROUP_0, BUFFER_GROUP_1, BUFFER_GROUP_2};
+    u8 index = (u8)ev_buf_getHead(pd)->groupIndex;
 
-    memcpy((u8 *)&index, pd - 4, 4);
-    assert((index < 3) && (index >= 0));
-    return (u8 *)(pd - 8 + size[index] - offsetToTail);
+    assert(index < ev_buf_v->groupNum);
+    return (u8 *)(pd - EV_BUF_HEADER_SIZE + ev_buf_v->bufGroups[index].size - offsetToTail);
 }
 
 u8 is_ev_buf(void *arg)
 {
-    if (((u32)arg >= (u32)(size_0_mem) && (u32)arg <= ((u32)(size_0_mem) + sizeof(size_0_mem))) ||
-        ((u32)arg >= (u32)(size_1_mem) && (u32)arg <= ((u32)(size_1_mem) + sizeof(size_1_mem))) ||
-        ((u32)arg >= (u32)(size_2_mem) && (u32)arg <= ((u32)(size_2_mem) + sizeof(size_2_mem)))) {
+    if (((u8 *)arg >= ev_buf_mem) && ((u8 *)arg < ev_buf_mem + sizeof(ev_buf_mem))) {
         return 1;
     }
     return 0;
@@ -275,7 +464,7 @@ u16 ev_buf_getFreeMaxSize(void)
 {
     u16 size = 0;
 
-    for (u8 i = 0; i < DEFAULT_BUFFER_GROUP_NUM; i++) {
+    for (u8 i = 0; i < ev_buf_v->groupNum; i++) {
         if (ev_buf_v->bufGroups[i].availBufNum) {
             if ((ev_buf_v->bufGroups[i].size - OFFSETOF(ev_bufItem_t, data)) > size) {
                 size = ev_buf_v->bufGroups[i].size - OFFSETOF(ev_bufItem_t, data);
@@ -286,4 +475,164 @@ u16 ev_buf_getFreeMaxSize(void)
     return size;
 }
 
+/*********************************************************************
+ * @fn      ev_buf_profileGet
+ *
+ * @brief   Get a copy of the request profile
+ *
+ * @param   profile - profile copy
+ *
+ * @return  None
+ */
+void ev_buf_profileGet(ev_buf_profile_t *profile)
+{
+#if EV_BUFFER_PROFILE
+    memcpy(profile, &ev_buf_prof, sizeof(ev_buf_profile_t));
+#else
+    memset(profile, 0, sizeof(ev_buf_profile_t));
+#endif
+}
+
+/*********************************************************************
+ * @fn      ev_buf_profileReset
+ *
+ * @brief   Clear the request profile, the requests held now stay
+ *          counted as live
+ *
+ * @param   None
+ *
+ * @return  None
+ */
+void ev_buf_profileReset(void)
+{
+#if EV_BUFFER_PROFILE
+    memset(ev_buf_prof.reqCount, 0, sizeof(ev_buf_prof.reqCount));
+    memcpy(ev_buf_prof.reqPeak, ev_buf_prof.reqLive, sizeof(ev_buf_prof.reqPeak));
+    ev_buf_prof.reqTooLarge = 0;
+    for (u8 i = 0; i < ev_buf_v->groupNum; i++) {
+        ev_buf_prof.groupPeak[i] = ev_buf_v->bufGroups[i].pool.num - ev_buf_v->bufGroups[i].availBufNum;
+    }
+    memset(ev_buf_prof.groupEmpty, 0, sizeof(ev_buf_prof.groupEmpty));
+    ev_buf_prof.allocFail = 0;
+#endif
+}
+
+#if EV_BUFFER_PROFILE
+/* RAM of a group serving the requests of the profiled bins first to last */
+static u32 ev_buf_profileCost(const u8 *bins, const u32 *peakSum, u8 first, u8 last, u16 *pSize, u16 *pNum)
+{
+    u32 num = peakSum[last + 1] - peakSum[first];
+    u16 size = EV_BUF_HEADER_SIZE + (bins[last] + 1) * EV_BUFFER_PROFILE_BIN;
+
+    num += (num * EV_BUFFER_PROFILE_MARGIN + 99) / 100;
+    if (pSize) {
+        *pSize = size;
+        *pNum = num;
+    }
+    return EV_BUF_BLOCK_SIZE(size) * num;
+}
+#endif
+
+/*********************************************************************
+ * @fn      ev_buf_profileRecommend
+ *
+ * @brief   Compute the geometry that serves the profiled peaks with the
+ *          least RAM. Groups end at histogram bins, a group gets as many
+ *          buffers as the sum of the peaks of its bins plus the margin,
+ *          which is never less than the requests it had at once.
+ *          Requests over EV_BUFFER_PROFILE_MAX_SIZE are left out.
+ *
+ * @param   cfg - EV_BUFFER_GROUP_MAX entries
+ * @param   maxGroups - most groups to use
+ *
+ * @return  number of groups, 0 without profile data
+ */
+u8 ev_buf_profileRecommend(ev_buf_groupCfg_t *cfg, u8 maxGroups)
+{
+#if EV_BUFFER_PROFILE
+    /* bins with requests, and the sums of their peaks */
+    static u8 bins[EV_BUFFER_PROFILE_BIN_NUM];
+    static u32 peakSum[EV_BUFFER_PROFILE_BIN_NUM + 1];
+    /* least RAM for the first j bins in g groups, and where the last of these groups starts */
+    static u32 best[EV_BUFFER_GROUP_MAX + 1][EV_BUFFER_PROFILE_BIN_NUM + 1];
+    static u8 from[EV_BUFFER_GROUP_MAX + 1][EV_BUFFER_PROFILE_BIN_NUM + 1];
+    u8 binNum = 0;
+
+    for (u8 i = 0; i < EV_BUFFER_PROFILE_BIN_NUM; i++) {
+        u16 peak = ev_buf_prof.reqPeak[i];
+        if (peak) {
+            peakSum[binNum + 1] = peakSum[binNum] + peak;
+            bins[binNum++] = i;
+        }
+    }
+    peakSum[0] = 0;
+
+    maxGroups = min(min(maxGroups, EV_BUFFER_GROUP_MAX), binNum);
+    if (maxGroups == 0) {
+        return 0;
+    }
+
+    for (u8 g = 0; g <= maxGroups; g++) {
+        for (u8 j = 0; j <= binNum; j++) {
+            best[g][j] = U32_MAX;
+        }
+    }
+    best[0][0] = 0;
+
+    for (u8 g = 1; g <= maxGroups; g++) {
+        for (u8 j = g; j <= binNum; j++) {
+            for (u8 i = g - 1; i < j; i++) {
+                if (best[g - 1][i] == U32_MAX) {
+                    continue;
+                }
+                u32 cost = best[g - 1][i] + ev_buf_profileCost(bins, peakSum, i, j - 1, NULL, NULL);
+                if (cost < best[g][j]) {
+                    best[g][j] = cost;
+                    from[g][j] = i;
+                }
+            }
+        }
+    }
+
+    u8 groups = 1;
+    for (u8 g = 2; g <= maxGroups; g++) {
+        if (best[g][binNum] < best[groups][binNum]) {
+            groups = g;
+        }
+    }
+
+    u8 j = binNum;
+    for (u8 g = groups; g > 0; g--) {
+        u8 i = from[g][j];
+        ev_buf_profileCost(bins, peakSum, i, j - 1, &cfg[g - 1].size, &cfg[g - 1].num);
+        j = i;
+    }
+    return groups;
+#else
+    (void)cfg;
+    (void)maxGroups;
+    return 0;
+#endif
+}
+
+/*********************************************************************
+ * @fn      ev_buf_profileApply
+ *
+ * @brief   Recommend a geometry and apply it
+ *
+ * @param   maxGroups - most groups to use
+ *
+ * @return  status
+ */
+buf_sts_t ev_buf_profileApply(u8 maxGroups)
+{
+    ev_buf_groupCfg_t cfg[EV_BUFFER_GROUP_MAX];
+    u8 num = ev_buf_profileRecommend(cfg, maxGroups);
+
+    if (num == 0) {
+        return BUFFER_INVALID_PARAMETER;
+    }
+    return ev_buf_config(cfg, num);
+}
+
 #endif /* MODULE_BUFM_ENABLE */
@@ -33,7 +33,8 @@
  */
 
 /** @addtogroup ev_buffer_groups EV Buffer Groups
- * Definition the length of each buffer group
+ * Definition the length of each buffer group of the default geometry,
+ * ev_buf_config() replaces it at run time
  * @{
  */
 #define BUFFER_GROUP_0  24
@@ -61,6 +62,46 @@
 
 /** @} end of group ev_buffer_typical_size */
 
+/** @addtogroup ev_buffer_geometry EV Buffer Geometry Limits
+ * The memory of all groups is one block of EV_BUFFER_MEM_SIZE bytes, by default the size of the default
+ * geometry. Another geometry may use it for more, smaller buffers, up to EV_BUFFER_BLOCK_MAX in all.
+ * @{
+ */
+#define EV_BUFFER_GROUP_MAX 8
+
+#ifndef EV_BUFFER_MEM_SIZE
+#define EV_BUFFER_MEM_SIZE                                                                                            \
+    (((BUFFER_GROUP_0 + 3) & ~3) * BUFFER_NUM_IN_GROUP0 + ((BUFFER_GROUP_1 + 3) & ~3) * BUFFER_NUM_IN_GROUP1 +     \
+     ((BUFFER_GROUP_2 + 3) & ~3) * BUFFER_NUM_IN_GROUP2)
+#endif
+
+#ifndef EV_BUFFER_BLOCK_MAX
+#define EV_BUFFER_BLOCK_MAX (2 * (BUFFER_NUM_IN_GROUP0 + BUFFER_NUM_IN_GROUP1 + BUFFER_NUM_IN_GROUP2))
+#endif
+
+/** @} end of group ev_buffer_geometry */
+
+/** @addtogroup ev_buffer_profile EV Buffer Profiling
+ * With EV_BUFFER_PROFILE the request sizes are counted in a histogram of EV_BUFFER_PROFILE_BIN byte bins up
+ * to EV_BUFFER_PROFILE_MAX_SIZE, with the most requests of each bin held at once, and the most buffers of
+ * each group held at once. ev_buf_profileRecommend() derives the geometry that would have needed the least
+ * RAM, with EV_BUFFER_PROFILE_MARGIN percent more buffers than the observed peaks.
+ * @{
+ */
+#ifndef EV_BUFFER_PROFILE
+#define EV_BUFFER_PROFILE 0
+#endif
+
+#define EV_BUFFER_PROFILE_BIN      4
+#define EV_BUFFER_PROFILE_MAX_SIZE 256
+#define EV_BUFFER_PROFILE_BIN_NUM  (EV_BUFFER_PROFILE_MAX_SIZE / EV_BUFFER_PROFILE_BIN)
+
+#ifndef EV_BUFFER_PROFILE_MARGIN
+#define EV_BUFFER_PROFILE_MARGIN 25
+#endif
+
+/** @} end of group ev_buffer_profile */
+
 /** @} end of group EV_BUFFER_CONSTANT */
 
 /** @defgroup EV_BUFFER_TYPE EV Buffer Types
@@ -89,9 +130,32 @@ typedef enum buf_sts_e {
     // SUCCESS always be ZERO
     BUFFER_SUCC,
     BUFFER_INVALID_PARAMETER = 1,  // !< Invalid parameter passed to the buffer API
-    BUFFER_DUPLICATE_FREE          // !< The same buffer is freed more than once
+    BUFFER_DUPLICATE_FREE,         // !< The same buffer is freed more than once
+    BUFFER_IN_USE,                 // !< The geometry can not change while buffers are allocated
+    BUFFER_NO_MEMORY               // !< The geometry needs more than EV_BUFFER_MEM_SIZE or EV_BUFFER_BLOCK_MAX
 } buf_sts_t;
 
+/**
+ *  @brief Definition of a buffer group: the size of its blocks, header included, and their number
+ */
+typedef struct {
+    u16 size;
+    u16 num;
+} ev_buf_groupCfg_t;
+
+/**
+ *  @brief Profile of the requests, see @ref ev_buffer_profile
+ */
+typedef struct {
+    u32 reqCount[EV_BUFFER_PROFILE_BIN_NUM]; /*!< requests of sizes in (i * BIN, (i + 1) * BIN] */
+    u16 reqPeak[EV_BUFFER_PROFILE_BIN_NUM];  /*!< most requests of the bin held at once */
+    u16 reqLive[EV_BUFFER_PROFILE_BIN_NUM];  /*!< requests of the bin held now */
+    u32 reqTooLarge;                          /*!< requests over EV_BUFFER_PROFILE_MAX_SIZE */
+    u16 groupPeak[EV_BUFFER_GROUP_MAX];       /*!< most buffers of the group held at once */
+    u32 groupEmpty[EV_BUFFER_GROUP_MAX];      /*!< requests that fit the group but found it empty */
+    u32 allocFail;                            /*!< requests no group could serve */
+} ev_buf_profile_t;
+
 /**  @} end of group EV_BUFFER_TYPE */
 
 /** @defgroup EV_BUFFER_FUNCTIONS EV Buffer API
@@ -167,6 +231,62 @@ ev_bufItem_t *ev_buf_getHead(u8 *pd);
 u8 is_ev_buf(void *arg);
 
 u16 ev_buf_getFreeMaxSize(void);
+
+/**
+ * @brief       Replace the buffer group geometry, only while no buffer is allocated
+ *
+ * @param       cfg - groups in increasing block size
+ * @param       num - number of groups, at most EV_BUFFER_GROUP_MAX
+ *
+ * @return      BUFFER_SUCC, BUFFER_INVALID_PARAMETER, BUFFER_IN_USE or BUFFER_NO_MEMORY
+ */
+buf_sts_t ev_buf_config(const ev_buf_groupCfg_t *cfg, u8 num);
+
+/**
+ * @brief       Get the current buffer group geometry
+ *
+ * @param       cfg - EV_BUFFER_GROUP_MAX entries
+ *
+ * @return      number of groups
+ */
+u8 ev_buf_getConfig(ev_buf_groupCfg_t *cfg);
+
+/**
+ * @brief       Get a copy of the request profile, all zero without EV_BUFFER_PROFILE
+ *
+ * @param       profile - profile copy
+ *
+ * @return      None
+ */
+void ev_buf_profileGet(ev_buf_profile_t *profile);
+
+/**
+ * @brief       Clear the request profile, the requests held now stay counted as live
+ *
+ * @param       None
+ *
+ * @return      None
+ */
+void ev_buf_profileReset(void);
+
+/**
+ * @brief       Compute the geometry that serves the profiled peaks with the least RAM
+ *
+ * @param       cfg - EV_BUFFER_GROUP_MAX entries
+ * @param       maxGroups - most groups to use
+ *
+ * @return      number of groups, 0 without profile data
+ */
+u8 ev_buf_profileRecommend(ev_buf_groupCfg_t *cfg, u8 maxGroups);
+
+/**
+ * @brief       Recommend a geometry and apply it with ev_buf_config()
+ *
+ * @param       maxGroups - most groups to use
+ *
+ * @return      status of ev_buf_config(), BUFFER_INVALID_PARAMETER without profile data
+ */
+buf_sts_t ev_buf_profileApply(u8 maxGroups);
 /**  @} end of group EV_BUFFER_FUNCTIONS */
 
 /**  @} end of group EV_BUFFER */
@@ -73,6 +73,7 @@ static _attribute_ram_code_ zb_buf_t *zb_buf_get(void)
             memset(buf->buf, 0, ZB_BUF_SIZE);
             g_mPool.usedNum++;
             buf->hdr.used = 1;
+            __atomic_store_n(&buf->refCnt, 1, __ATOMIC_RELAXED);
 #if ZB_BUFFER_DEBUG
             u32 idx = buf->allocCnt % ZB_BUFF_DBG_NUM;
             buf->allocInfo[idx].allocLine = line;
@@ -146,16 +147,13 @@ volatile u32 T_zbBufFreeDbg = 0;
 volatile u32 T_zbBufFreeDbgLine = 0;
 volatile u32 T_zbBufFreeDbgIdx = 0;
 volatile u32 T_zbBufFreeDbgIdx1 = 0;
-u8 my_zb_buf_free(zb_buf_t *buf, u16 line)
+static void zb_buf_release(zb_buf_t *buf, u16 line)
 #else
-u8 zb_buf_free(zb_buf_t *buf)
+static void zb_buf_release(zb_buf_t *buf)
 #endif
 {
     u8 r = irq_disable();
 
-    if (!is_zb_buf((void *)buf)) {
-    }
-
 #if ZB_BUFFER_DEBUG
     u32 idx = buf->freeCnt % ZB_BUFF_DBG_NUM;
     T_zbBufFreeDbgLine = buf->allocInfo[idx].freeLine;
@@ -189,9 +187,139 @@ u8 zb_buf_free(zb_buf_t *buf)
     buf->hdr.handle = 0xff;
 
     irq_restore(r);
+}
+
+/* start of a buffer of the pool, not only an address inside one */
+static inline bool zb_buf_valid(zb_buf_t *buf)
+{
+    return is_zb_buf((void *)buf) && (((u32)buf - (u32)&g_mPool.pool[0]) % sizeof(zb_buf_t) == 0);
+}
+
+/*
+ * drop a reference, return the references held before, 0 for a buffer already back in the pool
+ * */
+static _attribute_ram_code_ u32 zb_buf_dropRef(zb_buf_t *buf)
+{
+    if (!zb_buf_valid(buf)) {
+        T_zbBufDbg = (u32)buf;
+        return 0;
+    }
+
+    u32 refs = __atomic_load_n(&buf->refCnt, __ATOMIC_RELAXED);
+    do {
+        if (refs == 0) {
+            T_zbBufFreeDbg = buf->hdr.used;
+            T_zbBufDbg = (u32)buf;
+            return 0;
+        }
+        /* the reads of this holder are done before the last holder gives the buffer back */
+    } while (!__atomic_compare_exchange_n(&buf->refCnt, &refs, refs - 1, 1, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+    return refs;
+}
+
+#if ZB_BUFFER_DEBUG
+u8 my_zb_buf_free(zb_buf_t *buf, u16 line)
+#else
+u8 zb_buf_free(zb_buf_t *buf)
+#endif
+{
+    u32 refs = zb_buf_dropRef(buf);
+
+    if (refs == 0) {
+        return FAILURE;
+    }
+    if (refs == 1) {
+#if ZB_BUFFER_DEBUG
+        zb_buf_release(buf, line);
+#else
+        zb_buf_release(buf);
+#endif
+    }
     return SUCCESS;
 }
 
+/*
+ * take a reference of an allocated buffer, a buffer back in the pool can not be taken again
+ * */
+_attribute_ram_code_ zb_buf_t *zb_buf_ref(zb_buf_t *buf)
+{
+    if (!zb_buf_valid(buf)) {
+        return NULL;
+    }
+
+    u32 refs = __atomic_load_n(&buf->refCnt, __ATOMIC_RELAXED);
+    do {
+        if (refs == 0) {
+            return NULL;
+        }
+    } while (!__atomic_compare_exchange_n(&buf->refCnt, &refs, refs + 1, 1, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+    return buf;
+}
+
+#if ZB_BUFFER_DEBUG
+_attribute_ram_code_ u32 my_zb_buf_unref(zb_buf_t *buf, u16 line)
+#else
+_attribute_ram_code_ u32 zb_buf_unref(zb_buf_t *buf)
+#endif
+{
+    u32 refs = zb_buf_dropRef(buf);
+
+    if (refs == 1) {
+#if ZB_BUFFER_DEBUG
+        zb_buf_release(buf, line);
+#else
+        zb_buf_release(buf);
+#endif
+    }
+    return refs ? (refs - 1) : 0;
+}
+
+/*
+ * views share the bytes of the buffer, nothing is copied
+ * */
+u8 zb_buf_slice(zb_buf_slice_t *slice, zb_buf_t *buf, u8 *data, u16 len)
+{
+    if (!slice || !zb_buf_valid(buf)) {
+        return FAILURE;
+    }
+    if ((data < buf->buf) || ((u32)(data - buf->buf) + len > ZB_BUF_SIZE)) {
+        return FAILURE;
+    }
+    if (!zb_buf_ref(buf)) {
+        return FAILURE;
+    }
+
+    slice->buf = buf;
+    slice->data = data;
+    slice->len = len;
+    return SUCCESS;
+}
+
+u8 zb_buf_rxSlice(zb_buf_slice_t *slice, u8 *rxBuf, u16 offset, u16 len)
+{
+    return zb_buf_slice(slice, ZB_BUF_FROM_RXBUF(rxBuf), rxBuf + offset, len);
+}
+
+u8 zb_buf_subSlice(zb_buf_slice_t *sub, const zb_buf_slice_t *slice, u16 offset, u16 len)
+{
+    if (!slice || !slice->buf || ((u32)offset + len > slice->len)) {
+        return FAILURE;
+    }
+    return zb_buf_slice(sub, slice->buf, slice->data + offset, len);
+}
+
+void zb_buf_sliceRelease(zb_buf_slice_t *slice)
+{
+    if (slice && slice->buf) {
+        zb_buf_unref(slice->buf);
+        slice->buf = NULL;
+        slice->data = NULL;
+        slice->len = 0;
+    }
+}
+
 void *tl_bufInitalloc(zb_buf_t *p, u8 size)
 {
 #ifdef ZB_SECURITY
@@ -79,11 +79,21 @@ typedef struct zb_buf_s {
     struct zb_buf_s *next;
     u32 allocCnt;
     u32 freeCnt;
+    volatile u32 refCnt;  // holders of the buffer, it goes back to the pool when the last one lets go
 #if ZB_BUFFER_DEBUG
     zb_buf_allocInfo_t allocInfo[ZB_BUFF_DBG_NUM];
 #endif
 } zb_buf_t;
 
+/**
+   Read only view of a part of a buffer, it holds a reference of the buffer
+ */
+typedef struct {
+    zb_buf_t *buf;
+    u8 *data;
+    u16 len;
+} zb_buf_slice_t;
+
 typedef struct {
     zb_buf_t *head;
     u32 usedNum;
@@ -129,12 +139,48 @@ u8 *tl_getRxBuf(void);
 zb_buf_t *zb_buf_allocate(void);
 #endif
 
+/*
+ * zb_buf_free drops the reference of the caller, the buffer goes back to the pool with the last one.
+ * A buffer with no reference left is not freed again, FAILURE is returned.
+ * */
 #if ZB_BUFFER_DEBUG
 #define zb_buf_free(x) my_zb_buf_free(x, __LINE__)
 #else
 u8 zb_buf_free(zb_buf_t *buf);
 #endif
 
+/*
+ * Zero copy sharing of a buffer: the allocation holds the first reference, every other consumer of the
+ * same buffer (sniffer, parser, forwarder) takes its own with zb_buf_ref and drops it with zb_buf_unref
+ * or zb_buf_free. The shared data must not be written while more than one reference is held.
+ * */
+
+/* take a reference, NULL if the buffer is not allocated */
+zb_buf_t *zb_buf_ref(zb_buf_t *buf);
+
+/* drop a reference, return the references left */
+#if ZB_BUFFER_DEBUG
+u32 my_zb_buf_unref(zb_buf_t *buf, u16 line);
+#define zb_buf_unref(x) my_zb_buf_unref(x, __LINE__)
+#else
+u32 zb_buf_unref(zb_buf_t *buf);
+#endif
+
+/* buffer of a PHY RX buffer returned by tl_getRxBuf */
+#define ZB_BUF_FROM_RXBUF(p) ((zb_buf_t *)tl_phyRxBufTozbBuf(p))
+
+/* view of len bytes from data inside buf, referencing buf; FAILURE if the bytes are not inside buf->buf */
+u8 zb_buf_slice(zb_buf_slice_t *slice, zb_buf_t *buf, u8 *data, u16 len);
+
+/* view of len bytes at offset of a received PHY RX buffer */
+u8 zb_buf_rxSlice(zb_buf_slice_t *slice, u8 *rxBuf, u16 offset, u16 len);
+
+/* narrower view of len bytes at offset of an existing view, it takes its own reference */
+u8 zb_buf_subSlice(zb_buf_slice_t *sub, const zb_buf_slice_t *slice, u16 offset, u16 len);
+
+/* drop the reference of a view, the buffer is freed with the last one */
+void zb_buf_sliceRelease(zb_buf_slice_t *slice);
+
 #define ZB_BUF_FROM_REF(ref) (&g_mPool.pool[ref])
 
 #define ZB_REF_FROM_BUF(p) ((p) - &g_mPool.pool[0])
@@ -0,0 +1,83 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+#include "lf_pool.h"
+
+#define LF_POOL_TAG_ONE   0x10000
+#define LF_POOL_LINK_MASK 0xffff
+
+/* Link of a free block: index + 1 of the next free block, 0 at the end */
+#define LF_POOL_LINK(pool, i) (*(volatile u32 *)((pool)->mem + (u32)(i) * (pool)->blockSize))
+
+lf_pool_t *lf_pool_init(lf_pool_t *pool, void *mem, u16 blockSize, u16 num)
+{
+    if (!pool || !mem || (blockSize < sizeof(u32)) || (blockSize & 3) || (num > LF_POOL_MAX_NUM)) {
+        return 0;
+    }
+
+    pool->mem = (u8 *)mem;
+    pool->blockSize = blockSize;
+    pool->num = num;
+    for (u32 i = 0; i < num; i++) {
+        LF_POOL_LINK(pool, i) = (i + 1 < num) ? (i + 2) : 0;
+    }
+    __atomic_store_n(&pool->head, (num != 0) ? 1 : 0, __ATOMIC_RELEASE);
+    return pool;
+}
+
+void *lf_pool_alloc(lf_pool_t *pool)
+{
+    u32 head = __atomic_load_n(&pool->head, __ATOMIC_ACQUIRE);
+    u32 link;
+    u32 next;
+
+    do {
+        link = head & LF_POOL_LINK_MASK;
+        if (link == 0) {
+            return 0;
+        }
+        /* The block may be taken and written meanwhile, the tag then makes the swap fail */
+        next = ((head & ~LF_POOL_LINK_MASK) + LF_POOL_TAG_ONE) | LF_POOL_LINK(pool, link - 1);
+    } while (!__atomic_compare_exchange_n(&pool->head, &head, next, 1, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+
+    return pool->mem + (link - 1) * pool->blockSize;
+}
+
+void lf_pool_free(lf_pool_t *pool, void *block)
+{
+    u32 link = (u32)(((u8 *)block - pool->mem) / pool->blockSize) + 1;
+    u32 head = __atomic_load_n(&pool->head, __ATOMIC_RELAXED);
+    u32 next;
+
+    do {
+        LF_POOL_LINK(pool, link - 1) = head & LF_POOL_LINK_MASK;
+        next = ((head & ~LF_POOL_LINK_MASK) + LF_POOL_TAG_ONE) | link;
+    } while (!__atomic_compare_exchange_n(&pool->head, &head, next, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+int lf_pool_index(const lf_pool_t *pool, const void *block)
+{
+    const u8 *p = (const u8 *)block;
+
+    if ((p < pool->mem) || (p >= pool->mem + (u32)pool->num * pool->blockSize)) {
+        return -1;
+    }
+    if ((u32)(p - pool->mem) % pool->blockSize) {
+        return -1;
+    }
+    return (int)((u32)(p - pool->mem) / pool->blockSize);
+}
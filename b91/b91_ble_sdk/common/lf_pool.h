@@ -0,0 +1,85 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+#pragma once
+
+#include "types.h"
+
+/*
+ * Lock-free pool of fixed size blocks.
+ *
+ * The free list is a stack of block indexes whose head is swapped with LR/SC, so tasks and interrupt handlers
+ * allocate and free without masking interrupts. The head carries a tag that changes on every update: a pop
+ * interrupted between reading the head and swapping it fails and retries even if the same block is back on
+ * top (the ABA case), which a plain pointer head could not detect.
+ *
+ * The index of the next free block is kept in the first word of each free block, so blocks must be at least
+ * 4 bytes and 4 byte aligned. Needs the A extension on RISC-V.
+ */
+
+#if defined(__riscv) && !defined(__riscv_atomic)
+#error "lf_pool needs the RISC-V A extension"
+#endif
+
+/** Most blocks of a pool, the index and the tag share the 32 bit head */
+#define LF_POOL_MAX_NUM 0xfffe
+
+typedef struct {
+    volatile u32 head; /* tag in the upper 16 bits, index + 1 of the first free block in the lower 16 bits */
+    u8 *mem;
+    u16 blockSize;
+    u16 num;
+} lf_pool_t;
+
+/**
+ * @brief       Build the free list of a pool, not safe against concurrent use of the pool
+ *
+ * @param       pool - pool to initialize
+ * @param       mem - memory of num blocks, 4 byte aligned
+ * @param       blockSize - block size, a multiple of 4
+ * @param       num - number of blocks, at most LF_POOL_MAX_NUM
+ *
+ * @return      pool, NULL for bad parameters
+ */
+lf_pool_t *lf_pool_init(lf_pool_t *pool, void *mem, u16 blockSize, u16 num);
+
+/**
+ * @brief       Take a block, safe from tasks and interrupt handlers
+ *
+ * @param       pool - pool to take the block from
+ *
+ * @return      start of the block, NULL if the pool is empty
+ */
+void *lf_pool_alloc(lf_pool_t *pool);
+
+/**
+ * @brief       Give a block back, safe from tasks and interrupt handlers
+ *
+ * @param       pool - pool the block was taken from
+ * @param       block - start of the block
+ */
+void lf_pool_free(lf_pool_t *pool, void *block);
+
+/**
+ * @brief       Position of a block in its pool
+ *
+ * @param       pool - pool
+ * @param       block - start of the block
+ *
+ * @return      index of the block, -1 if it is not the start of a block of the pool
+ */
+int lf_pool_index(const lf_pool_t *pool, const void *block);
@@ -0,0 +1,186 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+#include "ring_fifo.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "compiler.h"
+
+int ring_fifo_init(ring_fifo_t *f, u8 *p, u32 size, u8 mp)
+{
+    if (!f || !p || ((uintptr_t)p & 3) || (size < 2 * RING_FIFO_HDR_SIZE) || (size & (size - 1))) {
+        return -1;
+    }
+    memset(p, 0, size);
+    f->head = 0;
+    f->tail = 0;
+    f->wpos = 0;
+    f->rpos = 0;
+    f->size = size;
+    f->p = p;
+    f->mp = mp;
+    return 0;
+}
+
+u32 ring_fifo_used(ring_fifo_t *f)
+{
+    return __atomic_load_n(&f->head, __ATOMIC_RELAXED) - __atomic_load_n(&f->tail, __ATOMIC_RELAXED);
+}
+
+/* bytes of padding needed before a record of rec bytes at pos */
+static inline u32 ring_fifo_pad(ring_fifo_t *f, u32 pos, u32 rec)
+{
+    u32 off = pos & (f->size - 1);
+    return ((off + rec) > f->size) ? (f->size - off) : 0;
+}
+
+_attribute_ram_code_ u8 *ring_fifo_reserve(ring_fifo_t *f, u16 n)
+{
+    u32 rec = RING_FIFO_REC_SIZE(n);
+    u32 pos = f->wpos;
+    u32 pad = ring_fifo_pad(f, pos, rec);
+
+    if ((n > RING_FIFO_MAX_LEN) || (rec > f->size) ||
+        (f->size - (pos - __atomic_load_n(&f->tail, __ATOMIC_ACQUIRE)) < pad + rec)) {
+        return 0;
+    }
+
+    if (pad) {
+        ring_fifo_hdr_t *h = (ring_fifo_hdr_t *)(f->p + (pos & (f->size - 1)));
+        h->len = RING_FIFO_PAD;
+        h->size = (u16)pad;
+        pos += pad;
+    }
+    ring_fifo_hdr_t *h = (ring_fifo_hdr_t *)(f->p + (pos & (f->size - 1)));
+    h->len = n;
+    h->size = (u16)rec;
+    f->wpos = pos + rec;
+    return (u8 *)(h + 1);
+}
+
+_attribute_ram_code_ void ring_fifo_commit(ring_fifo_t *f)
+{
+    /* the records are written before they are seen */
+    __atomic_store_n(&f->head, f->wpos, __ATOMIC_RELEASE);
+}
+
+_attribute_ram_code_ u8 *ring_fifo_mpReserve(ring_fifo_t *f, u16 n)
+{
+    u32 rec = RING_FIFO_REC_SIZE(n);
+    u32 head = __atomic_load_n(&f->head, __ATOMIC_RELAXED);
+    u32 pad;
+
+    if ((n > RING_FIFO_MAX_LEN) || (rec > f->size)) {
+        return 0;
+    }
+    do {
+        pad = ring_fifo_pad(f, head, rec);
+        if (f->size - (head - __atomic_load_n(&f->tail, __ATOMIC_ACQUIRE)) < pad + rec) {
+            return 0;
+        }
+    } while (!__atomic_compare_exchange_n(&f->head, &head, head + pad + rec, 1, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+    if (pad) {
+        ring_fifo_hdr_t *h = (ring_fifo_hdr_t *)(f->p + (head & (f->size - 1)));
+        h->len = RING_FIFO_PAD;
+        __atomic_store_n(&h->size, (u16)pad, __ATOMIC_RELEASE);
+        head += pad;
+    }
+    ring_fifo_hdr_t *h = (ring_fifo_hdr_t *)(f->p + (head & (f->size - 1)));
+    h->len = n;
+    return (u8 *)(h + 1);
+}
+
+_attribute_ram_code_ void ring_fifo_mpCommit(ring_fifo_t *f, u8 *p)
+{
+    ring_fifo_hdr_t *h = (ring_fifo_hdr_t *)p - 1;
+    (void)f;
+    __atomic_store_n(&h->size, (u16)RING_FIFO_REC_SIZE(h->len), __ATOMIC_RELEASE);
+}
+
+int ring_fifo_push(ring_fifo_t *f, const u8 *p, u16 n)
+{
+    u8 *pd = f->mp ? ring_fifo_mpReserve(f, n) : ring_fifo_reserve(f, n);
+
+    if (!pd) {
+        return -1;
+    }
+    memcpy(pd, p, n);
+    if (f->mp) {
+        ring_fifo_mpCommit(f, pd);
+    } else {
+        ring_fifo_commit(f);
+    }
+    return 0;
+}
+
+_attribute_ram_code_ u8 *ring_fifo_get(ring_fifo_t *f, u16 *n)
+{
+    u32 head = __atomic_load_n(&f->head, __ATOMIC_ACQUIRE);
+
+    while (f->rpos != head) {
+        ring_fifo_hdr_t *h = (ring_fifo_hdr_t *)(f->p + (f->rpos & (f->size - 1)));
+        u16 size = __atomic_load_n(&h->size, __ATOMIC_ACQUIRE);
+        if (size == 0) {
+            return 0; /* reserved, its producer has not committed it yet */
+        }
+        f->rpos += size;
+        if (h->len != RING_FIFO_PAD) {
+            if (n) {
+                *n = h->len;
+            }
+            return (u8 *)(h + 1);
+        }
+    }
+    return 0;
+}
+
+_attribute_ram_code_ void ring_fifo_release(ring_fifo_t *f)
+{
+    u32 tail = f->tail;
+
+    if (f->mp && (f->rpos != tail)) {
+        u32 off = tail & (f->size - 1);
+        u32 len = f->rpos - tail;
+        if (off + len > f->size) {
+            memset(f->p + off, 0, f->size - off);
+            memset(f->p, 0, off + len - f->size);
+        } else {
+            memset(f->p + off, 0, len);
+        }
+    }
+    /* the records are read, and zeroed, before their space is reused */
+    __atomic_store_n(&f->tail, f->rpos, __ATOMIC_RELEASE);
+}
+
+int ring_fifo_pop(ring_fifo_t *f, u8 *p, u16 n)
+{
+    u16 len;
+    u8 *pd = ring_fifo_get(f, &len);
+
+    if (!pd) {
+        return -1;
+    }
+    if (len > n) {
+        len = n;
+    }
+    memcpy(p, pd, len);
+    ring_fifo_release(f);
+    return len;
+}
@@ -0,0 +1,150 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+#pragma once
+
+#include "types.h"
+
+/*
+ * Ring FIFO of variable length records.
+ *
+ * A record takes a 4 byte header and its payload rounded up to 4 bytes, instead of a full slot of my_fifo,
+ * and is always contiguous: a record that does not fit before the end of the ring is preceded by a padding
+ * record. head and tail are free running 32 bit byte indexes, the ring size is a power of two.
+ *
+ * Single producer: ring_fifo_reserve() hands out the payload of the next record, any number of records
+ * may be reserved and written before ring_fifo_commit() publishes them all with one release store of head.
+ * Multiple producers (ring_fifo_init with mp set, tasks and interrupt handlers): ring_fifo_mpReserve()
+ * claims the space with a CAS on head and ring_fifo_mpCommit() publishes the record by storing its size
+ * in the header; the consumer zeroes the space it releases so an uncommitted header reads as size 0.
+ * Single consumer: ring_fifo_get() returns the next record without copying, ring_fifo_release() gives
+ * back the space of all records got so far with one release store of tail.
+ *
+ * A record of more than half the ring may not fit even in an empty ring, after the padding.
+ */
+#if defined(__riscv) && !defined(__riscv_atomic)
+#error "ring_fifo needs the RISC-V A extension"
+#endif
+
+#define RING_FIFO_HDR_SIZE 4
+#define RING_FIFO_PAD      0xffff /* len of a padding record */
+#define RING_FIFO_MAX_LEN  0xfff8 /* the record size must fit the 16 bit header */
+
+#define RING_FIFO_REC_SIZE(n) ((RING_FIFO_HDR_SIZE + (n) + 3) & ~3)
+
+typedef struct {
+    u16 len;           /* payload length, RING_FIFO_PAD for padding */
+    volatile u16 size; /* bytes of the record with header and padding, 0 until committed */
+} ring_fifo_hdr_t;
+
+typedef struct {
+    volatile u32 head; /* end of the published records, of the reserved ones with multiple producers */
+    volatile u32 tail; /* start of the records not released by the consumer */
+    u32 wpos;          /* single producer: end of the reserved records */
+    u32 rpos;          /* consumer: end of the records got */
+    u32 size;
+    u8 *p;
+    u8 mp;
+} ring_fifo_t;
+
+/**
+ * @brief       Set up a fifo over zeroed memory, not safe against concurrent use of the fifo
+ *
+ * @param       f - fifo to initialize
+ * @param       p - memory of size bytes, 4 byte aligned
+ * @param       size - ring size, a power of two
+ * @param       mp - 1 for multiple producers, they must use ring_fifo_mpReserve() and ring_fifo_mpCommit()
+ *
+ * @return      0, -1 for bad parameters
+ */
+int ring_fifo_init(ring_fifo_t *f, u8 *p, u32 size, u8 mp);
+
+/**
+ * @brief       Bytes taken by published or reserved records, padding and headers included
+ */
+u32 ring_fifo_used(ring_fifo_t *f);
+
+/**
+ * @brief       Reserve the next record, single producer only; it is seen by the consumer after ring_fifo_commit()
+ *
+ * @param       f - fifo
+ * @param       n - payload length, at most RING_FIFO_MAX_LEN
+ *
+ * @return      payload of n bytes, 4 byte aligned, NULL if the fifo is full
+ */
+u8 *ring_fifo_reserve(ring_fifo_t *f, u16 n);
+
+/**
+ * @brief       Publish all records reserved since the last commit, single producer only
+ */
+void ring_fifo_commit(ring_fifo_t *f);
+
+/**
+ * @brief       Reserve a record, safe from tasks and interrupt handlers of a fifo with multiple producers
+ *
+ * @param       f - fifo
+ * @param       n - payload length, at most RING_FIFO_MAX_LEN
+ *
+ * @return      payload of n bytes, 4 byte aligned, NULL if the fifo is full
+ */
+u8 *ring_fifo_mpReserve(ring_fifo_t *f, u16 n);
+
+/**
+ * @brief       Publish a record of ring_fifo_mpReserve(); records are seen in reservation order, a record not
+ *              committed yet holds back the ones reserved after it
+ *
+ * @param       f - fifo
+ * @param       p - payload returned by ring_fifo_mpReserve()
+ */
+void ring_fifo_mpCommit(ring_fifo_t *f, u8 *p);
+
+/**
+ * @brief       Copy a record into the fifo and publish it, with either kind of producer
+ *
+ * @return      0, -1 if the fifo is full
+ */
+int ring_fifo_push(ring_fifo_t *f, const u8 *p, u16 n);
+
+/**
+ * @brief       Next published record, consumer only; it stays valid until ring_fifo_release()
+ *
+ * @param       f - fifo
+ * @param       n - payload length, may be NULL
+ *
+ * @return      payload, NULL if there is no published record
+ */
+u8 *ring_fifo_get(ring_fifo_t *f, u16 *n);
+
+/**
+ * @brief       Give back the space of all records got so far, consumer only
+ */
+void ring_fifo_release(ring_fifo_t *f);
+
+/**
+ * @brief       Copy the next record out and release it, consumer only; a longer record is truncated to n
+ *
+ * @return      bytes copied, -1 if there is no published record
+ */
+int ring_fifo_pop(ring_fifo_t *f, u8 *p, u16 n);
+
+#define RING_FIFO_INIT(name, size)                                                                                    \
+    u8 name##_b[(size)] __attribute__((aligned(4))) = {0};                                                            \
+    ring_fifo_t name = {0, 0, 0, 0, (size), name##_b, 0}
+
+#define RING_FIFO_INIT_MP(name, size)                                                                                 \
+    u8 name##_b[(size)] __attribute__((aligned(4))) = {0};                                                            \
+    ring_fifo_t name = {0, 0, 0, 0, (size), name##_b, 1}
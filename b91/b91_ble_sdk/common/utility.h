@@ -149,6 +149,7 @@ static inline u64 mul64_32x32(u32 u, u32 v)
     return (u64)u * v;
 }
 
+/* FIFO of fixed size slots, ring_fifo.h has variable length records and batches */
 typedef struct {
     u32 size;
     u16 num;
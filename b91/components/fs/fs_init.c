@@ -27,6 +27,9 @@
 
 #include <B91/flash.h>
 
+#include <boot_b91.h>
+#include <energy_b91.h>
+
 #define LITTLEFS_PHYS_ADDR (1024 * 1024)
 #define LITTLEFS_PHYS_SIZE (128 * 1024)
 
@@ -54,14 +57,18 @@ static int readFunc(int partition, UINT32 *offset, unsigned char *buf, UINT32 si
 /* partition low-level write func */
 static int writeFunc(int partition, UINT32 *offset, const unsigned char *buf, UINT32 size)
 {
+    B91EnergyOn(B91_ENERGY_FLASH_PROGRAM);
     flash_write_page(LITTLEFS_PHYS_ADDR + *offset, size, (unsigned char *)buf);
+    B91EnergyOff(B91_ENERGY_FLASH_PROGRAM);
     return LFS_ERR_OK;
 }
 
 /* partition low-level erase func */
 static int eraseFunc(int partition, UINT32 offset, UINT32 size)
 {
+    B91EnergyOn(B91_ENERGY_FLASH_ERASE);
     flash_erase_sector(LITTLEFS_PHYS_ADDR + offset);
+    B91EnergyOff(B91_ENERGY_FLASH_ERASE);
     return LFS_ERR_OK;
 }
 
@@ -163,6 +170,7 @@ int32_t FsDriverInit(struct HdfDeviceObject *object)
             }
         }
     }
+    B91BootMark("hdf-fs");
 
     return HDF_SUCCESS;
 }
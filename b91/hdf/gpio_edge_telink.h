@@ -0,0 +1,71 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+#ifndef GPIO_EDGE_TELINK_H
+#define GPIO_EDGE_TELINK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Pin resolution of the shared GPIO interrupt, free of register access so it also runs on the host.
+ *
+ * The shared source is raised by any enabled pin whose input differs from its polarity bit. Only the active
+ * edge of a pin would interrupt with the polarity gpio_set_irq() programs, so the handler re-arms every edge
+ * pin for the transition away from the level it just read: the return to idle interrupts as well, and the
+ * next active edge shows up as a change against the level recorded then.
+ */
+
+/**
+ * @brief Returns the pins of one port to dispatch: level pins at their active level and edge pins whose level
+ *        moved to the active one since the previous interrupt.
+ */
+static inline uint8_t GpioPortFired(uint8_t rise, uint8_t fall, uint8_t high, uint8_t low, uint8_t lastLevel,
+                                    uint8_t level)
+{
+    uint8_t changed = level ^ lastLevel;
+
+    return (changed & level & rise) | (changed & ~level & fall) | (level & high) | (~level & low);
+}
+
+/**
+ * @brief Returns the polarity register of a port with every pin of edge armed for the transition away from
+ *        level, the other pins keep their polarity.
+ */
+static inline uint8_t GpioEdgePolarity(uint8_t pol, uint8_t edge, uint8_t level)
+{
+    return (pol & ~edge) | (level & edge);
+}
+
+/**
+ * @brief Debounce and glitch filter of the event service. An edge is accepted when the level read by the
+ *        handler is the active level of the trigger (an edge that already bounced back is a glitch), and both
+ *        the previous accepted edge and the last return to idle are at least debounceTicks old, so neither the
+ *        bounces of a press nor those of its release count as a new press.
+ */
+static inline bool GpioEventFilter(uint8_t activeLevel, uint32_t lastTick, uint32_t idleTick, uint32_t debounceTicks,
+                                   uint8_t level, uint32_t tick)
+{
+    if (level != activeLevel) {
+        return false;
+    }
+
+    return ((uint32_t)(tick - lastTick) >= debounceTicks) && ((uint32_t)(tick - idleTick) >= debounceTicks);
+}
+
+#endif /* GPIO_EDGE_TELINK_H */
@@ -16,17 +16,41 @@
  *
  *****************************************************************************/
 
+#include <string.h>
+
 #include "device_resource_if.h"
 #include "gpio/gpio_core.h"
+#include "gpio_if.h"
 #include "hdf_device_desc.h"
+#include "hdf_sbuf.h"
 #include "osal.h"
 
+#include <B91/analog.h>
 #include <B91/gpio.h>
+#include <B91/stimer.h>
 
 #include <b91_irq.h>
+#include <boot_b91.h>
+#include <defer_b91.h>
+#include <pm_device_b91.h>
+#include <pm_governor_b91.h>
+
+#include "gpio_edge_telink.h"
+#include "gpio_telink.h"
 
 #define GPIO_INDEX_MAX ((sizeof(g_GpioIndexToActualPin) / sizeof(gpio_pin_e)))
 
+#define GPIO_PORT_NUM       6
+#define GPIO_PINS_PER_PORT  8
+#define GPIO_LOCAL_NONE     0xFF
+#define GPIO_IRQ_SCAN_MAX   4
+
+enum B91GpioIrqSource {
+    GPIO_IRQ_SRC_GPIO = 0,
+    GPIO_IRQ_SRC_RISC0,
+    GPIO_IRQ_SRC_RISC1,
+};
+
 struct B91GpioCntlr {
     struct GpioCntlr cntlr;
 
@@ -34,13 +58,45 @@ struct B91GpioCntlr {
 
     struct {
         bool irq_enabled;
+        uint8_t trigger; /* gpio_irq_trigger_type_e */
+        uint8_t source;  /* B91GpioIrqSource */
+        bool event_enabled;
+        uint32_t event_tick;    /* stimer tick of the last accepted event */
+        uint32_t idle_tick;     /* stimer tick the pin last returned to idle, seen on the shared source only */
+        uint32_t debounceTicks; /* edges closer than this to the last accepted one or to idle_tick are dropped */
+        bool deferred;          /* HDF callback runs in the deferred work task instead of the ISR */
     }* config;
 
     uint8_t pinNum;
+
+    /* Local pins routed to the dedicated GPIO2RISC0/GPIO2RISC1 sources, GPIO_LOCAL_NONE if unused */
+    uint8_t riscPin[2];
+
+    /* Per-port masks of the pins served by the shared GPIO source, indexed by trigger type */
+    uint8_t triggerMask[INTR_LOW_LEVEL + 1][GPIO_PORT_NUM];
+    uint8_t lastLevel[GPIO_PORT_NUM];
+    uint8_t actualToLocal[GPIO_PORT_NUM * GPIO_PINS_PER_PORT];
+
+    /* Per-port masks of the pins listed in pinMap, the only ones the port API may touch */
+    uint8_t portMask[GPIO_PORT_NUM];
+
+    struct B91GpioIrqStats irqStats;
+
+    /* Event queue, filled from interrupt context and drained by B91GpioEventRead */
+    struct B91GpioEvent events[B91_GPIO_EVENT_QUEUE_LEN];
+    uint32_t eventHead;
+    uint32_t eventTail;
+    struct OsalSem eventSem;
+
+    B91PmDevice pm;
 };
 
 static struct B91GpioCntlr g_B91GpioCntlr = {};
 
+/* Service published for the controller: the one of the GPIO core with the port commands in front */
+static struct IDeviceIoService g_GpioPortService;
+static struct IDeviceIoService *g_GpioCoreService;
+
 static const gpio_pin_e g_GpioIndexToActualPin[] = {
     GPIO_PA0, /* 0  */
     GPIO_PA1, /* 1  */
@@ -125,6 +181,8 @@ static int32_t GpioDevSetIrq(struct GpioCntlr *cntlr, uint16_t local, uint16_t m
 static int32_t GpioDevEnableIrq(struct GpioCntlr *cntlr, uint16_t local);
 static int32_t GpioDevDisableIrq(struct GpioCntlr *cntlr, uint16_t local);
 static int32_t GpioDevUnsetIrq(struct GpioCntlr *cntlr, uint16_t local);
+static int32_t GpioDevDispatch(struct HdfDeviceIoClient *client, int cmd, struct HdfSBuf *data,
+                               struct HdfSBuf *reply);
 
 /* GpioMethod Definitions */
 struct GpioMethod g_GpioCntlrMethod = {
@@ -141,17 +199,393 @@ struct GpioMethod g_GpioCntlrMethod = {
     .disableIrq = GpioDevDisableIrq,
 };
 
+static inline uint8_t GpioActualIndex(struct B91GpioCntlr *pB91GpioCntlr, uint16_t local)
+{
+    return pB91GpioCntlr->pinReflectionMap[local];
+}
+
+/**
+ * @brief Rebuilds the per-port trigger masks used by GpioIrqHandler. Called with interrupts disabled.
+ */
+static void GpioUpdateIrqMasks(struct B91GpioCntlr *pB91GpioCntlr)
+{
+    (void)memset(pB91GpioCntlr->triggerMask, 0, sizeof(pB91GpioCntlr->triggerMask));
+
+    for (uint16_t i = 0; i < pB91GpioCntlr->pinNum; ++i) {
+        if (!pB91GpioCntlr->config[i].irq_enabled || (pB91GpioCntlr->config[i].source != GPIO_IRQ_SRC_GPIO)) {
+            continue;
+        }
+
+        uint8_t index = GpioActualIndex(pB91GpioCntlr, i);
+        pB91GpioCntlr->triggerMask[pB91GpioCntlr->config[i].trigger][index / GPIO_PINS_PER_PORT] |=
+            BIT(index % GPIO_PINS_PER_PORT);
+    }
+
+    for (uint8_t port = 0; port < GPIO_PORT_NUM; ++port) {
+        uint8_t edge = pB91GpioCntlr->triggerMask[INTR_RISING_EDGE][port] |
+                       pB91GpioCntlr->triggerMask[INTR_FALLING_EDGE][port];
+        gpio_pin_e base = g_GpioIndexToActualPin[port * GPIO_PINS_PER_PORT];
+
+        pB91GpioCntlr->lastLevel[port] = reg_gpio_in(base);
+        if (edge != 0) {
+            reg_gpio_pol(base) = GpioEdgePolarity(reg_gpio_pol(base), edge, pB91GpioCntlr->lastLevel[port]);
+        }
+    }
+
+    /* Re-arming may have raised the source on a level nobody moved to */
+    gpio_clr_irq_status(FLD_GPIO_IRQ_CLR);
+}
+
+/* Deep retention loses the GPIO registers: per port, in restore order, outputs before they are enabled */
+static const uint8_t g_GpioPmPortRegs[] = {
+    3, /* out */
+    5, /* ds */
+    1, /* ie */
+    2, /* oen */
+    6, /* gpio function */
+    4, /* pol */
+    7, /* irq_en */
+};
+
+/* Pin mux, GPIO2RISC enables and the interrupt control of the GPIO block */
+static const uint32_t g_GpioPmRegs[] = {
+    0x140330, 0x140331, 0x140332, 0x140333, 0x140334, 0x140335, 0x140336, 0x140337, 0x140350, 0x140351,
+    0x140356, 0x140357, 0x140338, 0x140339, 0x14033a, 0x14033b, 0x14033c, 0x140340, 0x140341, 0x140342,
+    0x140343, 0x140344, 0x140352, 0x140353, 0x140355,
+};
+
+/* Input enable, pull enable and drive strength of ports C and D are analog registers */
+static const uint8_t g_GpioPmAnalogRegs[] = {
+    areg_gpio_pc_ie, areg_gpio_pc_pe, areg_gpio_pc_ds, areg_gpio_pd_ie, areg_gpio_pd_pe, areg_gpio_pd_ds,
+};
+
+static struct {
+    uint8_t port[GPIO_PORT_NUM][sizeof(g_GpioPmPortRegs)];
+    uint8_t regs[sizeof(g_GpioPmRegs) / sizeof(g_GpioPmRegs[0])];
+    uint8_t analog[sizeof(g_GpioPmAnalogRegs)];
+} g_GpioPmSaved;
+
+#define GPIO_PORT_REG(port, offset) REG_ADDR8(0x140300 + ((port) << 3) + (offset))
+
+static uint32_t GpioPmPrepare(B91PmDevice *dev, uint32_t mode)
+{
+    (void)dev;
+
+    if (mode != B91_PM_MODE_DEEP_RET) {
+        return LOS_OK;
+    }
+
+    for (uint8_t port = 0; port < GPIO_PORT_NUM; ++port) {
+        for (uint8_t i = 0; i < sizeof(g_GpioPmPortRegs); ++i) {
+            g_GpioPmSaved.port[port][i] = GPIO_PORT_REG(port, g_GpioPmPortRegs[i]);
+        }
+    }
+    for (uint8_t i = 0; i < sizeof(g_GpioPmSaved.regs); ++i) {
+        g_GpioPmSaved.regs[i] = REG_ADDR8(g_GpioPmRegs[i]);
+    }
+    for (uint8_t i = 0; i < sizeof(g_GpioPmAnalogRegs); ++i) {
+        g_GpioPmSaved.analog[i] = analog_read_reg8(g_GpioPmAnalogRegs[i]);
+    }
+    return LOS_OK;
+}
+
+static void GpioPmResume(B91PmDevice *dev, uint32_t mode)
+{
+    struct B91GpioCntlr *pB91GpioCntlr = (struct B91GpioCntlr *)dev->priv;
+
+    if (mode != B91_PM_MODE_DEEP_RET) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < sizeof(g_GpioPmAnalogRegs); ++i) {
+        analog_write_reg8(g_GpioPmAnalogRegs[i], g_GpioPmSaved.analog[i]);
+    }
+    for (uint8_t port = 0; port < GPIO_PORT_NUM; ++port) {
+        for (uint8_t i = 0; i < sizeof(g_GpioPmPortRegs); ++i) {
+            GPIO_PORT_REG(port, g_GpioPmPortRegs[i]) = g_GpioPmSaved.port[port][i];
+        }
+    }
+    for (uint8_t i = 0; i < sizeof(g_GpioPmSaved.regs); ++i) {
+        REG_ADDR8(g_GpioPmRegs[i]) = g_GpioPmSaved.regs[i];
+    }
+
+    /* The pins may have moved while asleep, a wake-up pad certainly did */
+    GpioUpdateIrqMasks(pB91GpioCntlr);
+}
+
+static inline uint8_t GpioActiveLevel(uint8_t trigger)
+{
+    return ((trigger == INTR_RISING_EDGE) || (trigger == INTR_HIGH_LEVEL)) ? 1 : 0;
+}
+
+_attribute_ram_code_ static void GpioEventPush(struct B91GpioCntlr *pB91GpioCntlr, uint16_t local, uint8_t level,
+                                               uint32_t tick)
+{
+    unsigned int r = core_interrupt_disable();
+
+    if ((pB91GpioCntlr->eventHead - pB91GpioCntlr->eventTail) >= B91_GPIO_EVENT_QUEUE_LEN) {
+        pB91GpioCntlr->irqStats.eventOverflow++;
+        core_restore_interrupt(r);
+        return;
+    }
+
+    struct B91GpioEvent *event = &pB91GpioCntlr->events[pB91GpioCntlr->eventHead % B91_GPIO_EVENT_QUEUE_LEN];
+    event->local = local;
+    event->level = level;
+    event->tick = tick;
+    pB91GpioCntlr->eventHead++;
+
+    core_restore_interrupt(r);
+
+    (void)OsalSemPost(&pB91GpioCntlr->eventSem);
+}
+
+static void GpioDeferredCallback(void *arg, uint32_t local)
+{
+    GpioCntlrIrqCallback(&((struct B91GpioCntlr *)arg)->cntlr, (uint16_t)local);
+}
+
+/**
+ * @brief Delivers one fired pin: applies the event filter if the pin uses the event service, then queues
+ *        the event and calls the HDF callback.
+ */
+_attribute_ram_code_ static void GpioPinFired(struct B91GpioCntlr *pB91GpioCntlr, uint16_t local, uint8_t level,
+                                              uint32_t tick)
+{
+    if (pB91GpioCntlr->config[local].event_enabled) {
+        if (!GpioEventFilter(GpioActiveLevel(pB91GpioCntlr->config[local].trigger),
+                             pB91GpioCntlr->config[local].event_tick, pB91GpioCntlr->config[local].idle_tick,
+                             pB91GpioCntlr->config[local].debounceTicks, level, tick)) {
+            pB91GpioCntlr->irqStats.filtered++;
+            return;
+        }
+
+        pB91GpioCntlr->config[local].event_tick = tick;
+        GpioEventPush(pB91GpioCntlr, local, level, tick);
+    }
+
+    /* If the work queue is full the callback is still delivered, from the ISR */
+    if (pB91GpioCntlr->config[local].deferred &&
+        (B91DeferPost(B91_DEFER_PRIO_HIGH, GpioDeferredCallback, pB91GpioCntlr, local) == LOS_OK)) {
+        return;
+    }
+
+    GpioCntlrIrqCallback(&pB91GpioCntlr->cntlr, local);
+}
+
+/**
+ * @brief Dispatches every pin of the given port set in the fired mask.
+ * @return number of pins dispatched.
+ */
+_attribute_ram_code_ static uint32_t GpioDispatchPort(struct B91GpioCntlr *pB91GpioCntlr, uint8_t port, uint8_t fired,
+                                                      uint8_t level, uint32_t tick)
+{
+    uint32_t callbacks = 0;
+
+    while (fired != 0) {
+        uint8_t bit = __builtin_ctz(fired);
+        fired &= fired - 1;
+
+        uint8_t local = pB91GpioCntlr->actualToLocal[port * GPIO_PINS_PER_PORT + bit];
+        if (local != GPIO_LOCAL_NONE) {
+            GpioPinFired(pB91GpioCntlr, local, (level >> bit) & 1, tick);
+            callbacks++;
+        }
+    }
+
+    return callbacks;
+}
+
+/**
+ * @brief Records the return to idle of the edge pins of the given port set in the mask, for the event filter.
+ */
+_attribute_ram_code_ static void GpioMarkIdle(struct B91GpioCntlr *pB91GpioCntlr, uint8_t port, uint8_t idle,
+                                              uint32_t tick)
+{
+    while (idle != 0) {
+        uint8_t bit = __builtin_ctz(idle);
+        idle &= idle - 1;
+
+        uint8_t local = pB91GpioCntlr->actualToLocal[port * GPIO_PINS_PER_PORT + bit];
+        if (local != GPIO_LOCAL_NONE) {
+            pB91GpioCntlr->config[local].idle_tick = tick;
+        }
+    }
+}
+
+_attribute_ram_code_ static uint8_t GpioLocalLevel(struct B91GpioCntlr *pB91GpioCntlr, uint16_t local)
+{
+    return gpio_get_level(g_GpioIndexToActualPin[GpioActualIndex(pB91GpioCntlr, local)]) ? 1 : 0;
+}
+
+/*
+ * The shared GPIO source has no per-pin pending register: it fires on the OR of all enabled pins. The pins
+ * which triggered are recovered from one read of the input registers: level pins that are at their active
+ * level and edge pins whose level moved to the active one since the previous interrupt. Edge pins are
+ * re-armed for the opposite transition on every pass (see gpio_edge_telink.h), and the ports are scanned
+ * again while an edge pin moved during the scan, since the status clear below also drops that edge.
+ */
 _attribute_ram_code_ static void GpioIrqHandler(void)
 {
     struct B91GpioCntlr *pB91GpioCntlr = &g_B91GpioCntlr;
+    uint32_t start = stimer_get_tick();
+    uint32_t callbacks = 0;
+    bool resolved = false;
+    bool moved;
+
+    for (uint32_t pass = 0; pass < GPIO_IRQ_SCAN_MAX; ++pass) {
+        for (uint8_t port = 0; port < GPIO_PORT_NUM; ++port) {
+            uint8_t rise = pB91GpioCntlr->triggerMask[INTR_RISING_EDGE][port];
+            uint8_t fall = pB91GpioCntlr->triggerMask[INTR_FALLING_EDGE][port];
+            uint8_t high = pB91GpioCntlr->triggerMask[INTR_HIGH_LEVEL][port];
+            uint8_t low = pB91GpioCntlr->triggerMask[INTR_LOW_LEVEL][port];
+            if ((rise | fall | high | low) == 0) {
+                continue;
+            }
+
+            gpio_pin_e base = g_GpioIndexToActualPin[port * GPIO_PINS_PER_PORT];
+            uint8_t level = reg_gpio_in(base);
+            uint8_t fired = GpioPortFired(rise, fall, high, low, pB91GpioCntlr->lastLevel[port], level);
+            uint8_t moves = (level ^ pB91GpioCntlr->lastLevel[port]) & (rise | fall);
+            if ((moves | fired) != 0) {
+                resolved = true;
+            }
+            GpioMarkIdle(pB91GpioCntlr, port, moves & ~fired, start);
+            pB91GpioCntlr->lastLevel[port] = level;
+            if ((rise | fall) != 0) {
+                reg_gpio_pol(base) = GpioEdgePolarity(reg_gpio_pol(base), rise | fall, level);
+            }
+
+            callbacks += GpioDispatchPort(pB91GpioCntlr, port, fired, level, start);
+        }
+
+        gpio_clr_irq_status(FLD_GPIO_IRQ_CLR);
 
-    for (size_t i = 0; i < pB91GpioCntlr->pinNum; ++i) {
-        if (pB91GpioCntlr->config[i].irq_enabled) {
-            GpioCntlrIrqCallback(&pB91GpioCntlr->cntlr, i);
+        moved = false;
+        for (uint8_t port = 0; port < GPIO_PORT_NUM; ++port) {
+            uint8_t edge = pB91GpioCntlr->triggerMask[INTR_RISING_EDGE][port] |
+                           pB91GpioCntlr->triggerMask[INTR_FALLING_EDGE][port];
+            if (((reg_gpio_in(g_GpioIndexToActualPin[port * GPIO_PINS_PER_PORT]) ^ pB91GpioCntlr->lastLevel[port]) &
+                 edge) != 0) {
+                moved = true;
+            }
+        }
+        if (!moved) {
+            break;
         }
     }
 
-    gpio_clr_irq_status(FLD_GPIO_IRQ_CLR);
+    if (!resolved) {
+        /* Pulse shorter than the interrupt latency, fall back to notifying every edge-triggered pin */
+        pB91GpioCntlr->irqStats.unresolved++;
+        for (uint8_t port = 0; port < GPIO_PORT_NUM; ++port) {
+            callbacks += GpioDispatchPort(pB91GpioCntlr, port,
+                                          pB91GpioCntlr->triggerMask[INTR_RISING_EDGE][port] |
+                                              pB91GpioCntlr->triggerMask[INTR_FALLING_EDGE][port],
+                                          pB91GpioCntlr->lastLevel[port], start);
+        }
+    }
+
+    uint32_t ticks = stimer_get_tick() - start;
+    pB91GpioCntlr->irqStats.irqCount++;
+    pB91GpioCntlr->irqStats.callbacks += callbacks;
+    pB91GpioCntlr->irqStats.totalTicks += ticks;
+    if (ticks > pB91GpioCntlr->irqStats.maxTicks) {
+        pB91GpioCntlr->irqStats.maxTicks = ticks;
+    }
+}
+
+_attribute_ram_code_ static void GpioRisc0IrqHandler(void)
+{
+    struct B91GpioCntlr *pB91GpioCntlr = &g_B91GpioCntlr;
+
+    uint32_t tick = stimer_get_tick();
+    uint16_t local = pB91GpioCntlr->riscPin[0];
+
+    GpioPinFired(pB91GpioCntlr, local, GpioLocalLevel(pB91GpioCntlr, local), tick);
+    pB91GpioCntlr->irqStats.riscIrqCount++;
+    gpio_clr_irq_status(FLD_GPIO_IRQ_GPIO2RISC0_CLR);
+}
+
+_attribute_ram_code_ static void GpioRisc1IrqHandler(void)
+{
+    struct B91GpioCntlr *pB91GpioCntlr = &g_B91GpioCntlr;
+
+    uint32_t tick = stimer_get_tick();
+    uint16_t local = pB91GpioCntlr->riscPin[1];
+
+    GpioPinFired(pB91GpioCntlr, local, GpioLocalLevel(pB91GpioCntlr, local), tick);
+    pB91GpioCntlr->irqStats.riscIrqCount++;
+    gpio_clr_irq_status(FLD_GPIO_IRQ_GPIO2RISC1_CLR);
+}
+
+int32_t B91GpioEventEnable(uint16_t local, uint32_t debounceUs)
+{
+    struct B91GpioCntlr *pB91GpioCntlr = &g_B91GpioCntlr;
+
+    RETURN_ERR_IF_OUT_OF_RANGE(local);
+
+    unsigned int r = core_interrupt_disable();
+    pB91GpioCntlr->config[local].debounceTicks = debounceUs * SYSTEM_TIMER_TICK_1US;
+    pB91GpioCntlr->config[local].event_tick = stimer_get_tick() - pB91GpioCntlr->config[local].debounceTicks;
+    pB91GpioCntlr->config[local].idle_tick = pB91GpioCntlr->config[local].event_tick;
+    pB91GpioCntlr->config[local].event_enabled = true;
+    core_restore_interrupt(r);
+
+    return HDF_SUCCESS;
+}
+
+int32_t B91GpioEventDisable(uint16_t local)
+{
+    struct B91GpioCntlr *pB91GpioCntlr = &g_B91GpioCntlr;
+
+    RETURN_ERR_IF_OUT_OF_RANGE(local);
+
+    pB91GpioCntlr->config[local].event_enabled = false;
+
+    return HDF_SUCCESS;
+}
+
+int32_t B91GpioSetDeferred(uint16_t local, bool enable)
+{
+    struct B91GpioCntlr *pB91GpioCntlr = &g_B91GpioCntlr;
+
+    RETURN_ERR_IF_OUT_OF_RANGE(local);
+
+    pB91GpioCntlr->config[local].deferred = enable;
+
+    return HDF_SUCCESS;
+}
+
+int32_t B91GpioEventRead(struct B91GpioEvent *event, uint32_t timeoutMs)
+{
+    struct B91GpioCntlr *pB91GpioCntlr = &g_B91GpioCntlr;
+
+    if (event == NULL) {
+        return HDF_ERR_INVALID_PARAM;
+    }
+
+    if (OsalSemWait(&pB91GpioCntlr->eventSem, timeoutMs) != HDF_SUCCESS) {
+        return HDF_ERR_TIMEOUT;
+    }
+
+    unsigned int r = core_interrupt_disable();
+    *event = pB91GpioCntlr->events[pB91GpioCntlr->eventTail % B91_GPIO_EVENT_QUEUE_LEN];
+    pB91GpioCntlr->eventTail++;
+    core_restore_interrupt(r);
+
+    return HDF_SUCCESS;
+}
+
+void B91GpioGetIrqStats(struct B91GpioIrqStats *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+
+    unsigned int r = core_interrupt_disable();
+    *stats = g_B91GpioCntlr.irqStats;
+    core_restore_interrupt(r);
 }
 
 static int32_t GetGpioDeviceResource(struct B91GpioCntlr *cntlr, const struct DeviceResourceNode *resourceNode)
@@ -191,6 +625,31 @@ static int32_t GetGpioDeviceResource(struct B91GpioCntlr *cntlr, const struct De
         cntlr->pinReflectionMap[i] = pinIndex;
     }
 
+    (void)memset(cntlr->actualToLocal, GPIO_LOCAL_NONE, sizeof(cntlr->actualToLocal));
+    for (uint32_t i = 0; i < cntlr->pinNum; i++) {
+        cntlr->config[i].irq_enabled = false;
+        cntlr->config[i].trigger = INTR_RISING_EDGE;
+        cntlr->config[i].source = GPIO_IRQ_SRC_GPIO;
+        cntlr->config[i].event_enabled = false;
+        cntlr->config[i].deferred = false;
+        if (cntlr->pinReflectionMap[i] < GPIO_INDEX_MAX) {
+            cntlr->actualToLocal[cntlr->pinReflectionMap[i]] = i;
+            cntlr->portMask[cntlr->pinReflectionMap[i] / GPIO_PINS_PER_PORT] |=
+                BIT(cntlr->pinReflectionMap[i] % GPIO_PINS_PER_PORT);
+        }
+    }
+
+    /* Optional: up to two latency-critical pins get the dedicated GPIO2RISC0/GPIO2RISC1 interrupts */
+    (void)dri->GetUint8(resourceNode, "risc0Pin", &cntlr->riscPin[0], GPIO_LOCAL_NONE);
+    (void)dri->GetUint8(resourceNode, "risc1Pin", &cntlr->riscPin[1], GPIO_LOCAL_NONE);
+    for (uint32_t i = 0; i < sizeof(cntlr->riscPin); i++) {
+        if (cntlr->riscPin[i] < cntlr->pinNum) {
+            cntlr->config[cntlr->riscPin[i]].source = GPIO_IRQ_SRC_RISC0 + i;
+        } else {
+            cntlr->riscPin[i] = GPIO_LOCAL_NONE;
+        }
+    }
+
     return HDF_SUCCESS;
 }
 
@@ -212,6 +671,12 @@ static int32_t GpioDriverInit(struct HdfDeviceObject *device)
         return ret;
     }
 
+    ret = OsalSemInit(&pB91GpioCntlr->eventSem, 0);
+    if (ret != HDF_SUCCESS) {
+        HDF_LOGE("%s: OsalSemInit failed: %ld", __func__, ret);
+        return ret;
+    }
+
     pB91GpioCntlr->cntlr.count = pB91GpioCntlr->pinNum;
     pB91GpioCntlr->cntlr.priv = (void *)device->property;
     pB91GpioCntlr->cntlr.ops = &g_GpioCntlrMethod;
@@ -225,9 +690,37 @@ static int32_t GpioDriverInit(struct HdfDeviceObject *device)
         return ret;
     }
 
-    B91IrqRegister(IRQ25_GPIO, (HWI_PROC_FUNC)GpioIrqHandler, 0);
+    /* A copy rather than the core's own service, which other controllers may share */
+    g_GpioCoreService = gpioCntlr->device.service;
+    if (g_GpioCoreService != NULL) {
+        g_GpioPortService = *g_GpioCoreService;
+    }
+    g_GpioPortService.Dispatch = GpioDevDispatch;
+    gpioCntlr->device.service = &g_GpioPortService;
+    device->service = &g_GpioPortService;
+
+    B91IrqRegisterPrio(IRQ25_GPIO, (HWI_PROC_FUNC)GpioIrqHandler, 0, B91_IRQ_PRIO_DEFAULT);
     plic_interrupt_enable(IRQ25_GPIO);
 
+    if (pB91GpioCntlr->riscPin[0] != GPIO_LOCAL_NONE) {
+        B91IrqRegisterPrio(IRQ26_GPIO2RISC0, (HWI_PROC_FUNC)GpioRisc0IrqHandler, 0, B91_IRQ_PRIO_TIMER);
+        plic_interrupt_enable(IRQ26_GPIO2RISC0);
+    }
+
+    if (pB91GpioCntlr->riscPin[1] != GPIO_LOCAL_NONE) {
+        B91IrqRegisterPrio(IRQ27_GPIO2RISC1, (HWI_PROC_FUNC)GpioRisc1IrqHandler, 0, B91_IRQ_PRIO_TIMER);
+        plic_interrupt_enable(IRQ27_GPIO2RISC1);
+    }
+
+    pB91GpioCntlr->pm.name = "hdf-gpio";
+    pB91GpioCntlr->pm.priv = pB91GpioCntlr;
+    pB91GpioCntlr->pm.prepare = GpioPmPrepare;
+    pB91GpioCntlr->pm.resume = GpioPmResume;
+    if (B91PmDeviceRegister(&pB91GpioCntlr->pm) != LOS_OK) {
+        HDF_LOGW("%s: no PM slot, GPIO setup is lost in deep retention", __func__);
+    }
+
+    B91BootMark("hdf-gpio");
     HDF_LOGD("%s: dev service:%s init success!", __func__, HdfDeviceGetServiceName(device));
     return ret;
 }
@@ -254,9 +747,197 @@ static void GpioDriverRelease(struct HdfDeviceObject *device)
         HDF_LOGE("%s: no service bound!", __func__);
         return;
     }
+    B91PmDeviceUnregister(&pB91GpioCntlr->pm);
     GpioCntlrRemove(gpioCntlr);
 }
 
+/* Port API ------------------------------------------------------------------ */
+
+#define RETURN_ERR_IF_PORT_INVALID(port, mask)                                                                        \
+    do {                                                                                                              \
+        if ((port) >= GPIO_PORT_NUM) {                                                                                \
+            return HDF_ERR_INVALID_PARAM;                                                                             \
+        }                                                                                                             \
+        if (((mask) & ~g_B91GpioCntlr.portMask[port]) != 0) {                                                         \
+            return HDF_ERR_INVALID_PARAM;                                                                             \
+        }                                                                                                             \
+    } while (0)
+
+static inline gpio_pin_e GpioPortBase(uint8_t port)
+{
+    return g_GpioIndexToActualPin[port * GPIO_PINS_PER_PORT];
+}
+
+int32_t B91GpioPortRead(uint8_t port, uint8_t *value)
+{
+    RETURN_ERR_IF_PORT_INVALID(port, 0);
+    if (value == NULL) {
+        return HDF_ERR_INVALID_PARAM;
+    }
+
+    *value = reg_gpio_in(GpioPortBase(port)) & g_B91GpioCntlr.portMask[port];
+    return HDF_SUCCESS;
+}
+
+/*
+ * The output register has no set/clear aliases, so every update is a read-modify-write of one byte with
+ * interrupts disabled for its duration, which keeps concurrent updates of other pins of the port intact.
+ */
+_attribute_ram_code_ int32_t B91GpioPortWrite(uint8_t port, uint8_t mask, uint8_t value)
+{
+    RETURN_ERR_IF_PORT_INVALID(port, mask);
+
+    gpio_pin_e base = GpioPortBase(port);
+    unsigned int r = core_interrupt_disable();
+    reg_gpio_out(base) = (reg_gpio_out(base) & ~mask) | (value & mask);
+    core_restore_interrupt(r);
+
+    return HDF_SUCCESS;
+}
+
+_attribute_ram_code_ int32_t B91GpioPortSet(uint8_t port, uint8_t mask)
+{
+    RETURN_ERR_IF_PORT_INVALID(port, mask);
+
+    gpio_pin_e base = GpioPortBase(port);
+    unsigned int r = core_interrupt_disable();
+    reg_gpio_out(base) |= mask;
+    core_restore_interrupt(r);
+
+    return HDF_SUCCESS;
+}
+
+_attribute_ram_code_ int32_t B91GpioPortClear(uint8_t port, uint8_t mask)
+{
+    RETURN_ERR_IF_PORT_INVALID(port, mask);
+
+    gpio_pin_e base = GpioPortBase(port);
+    unsigned int r = core_interrupt_disable();
+    reg_gpio_out(base) &= ~mask;
+    core_restore_interrupt(r);
+
+    return HDF_SUCCESS;
+}
+
+_attribute_ram_code_ int32_t B91GpioPortToggle(uint8_t port, uint8_t mask)
+{
+    RETURN_ERR_IF_PORT_INVALID(port, mask);
+
+    gpio_pin_e base = GpioPortBase(port);
+    unsigned int r = core_interrupt_disable();
+    reg_gpio_out(base) ^= mask;
+    core_restore_interrupt(r);
+
+    return HDF_SUCCESS;
+}
+
+int32_t B91GpioLocalToPortBit(uint16_t local, uint8_t *port, uint8_t *bit)
+{
+    struct B91GpioCntlr *pB91GpioCntlr = &g_B91GpioCntlr;
+
+    RETURN_ERR_IF_OUT_OF_RANGE(local);
+    if (port == NULL || bit == NULL) {
+        return HDF_ERR_INVALID_PARAM;
+    }
+
+    *port = GpioActualIndex(pB91GpioCntlr, local) / GPIO_PINS_PER_PORT;
+    *bit = GpioActualIndex(pB91GpioCntlr, local) % GPIO_PINS_PER_PORT;
+    return HDF_SUCCESS;
+}
+
+/**
+ * @brief Handles the B91_GPIO_IO_PORT_* commands and passes everything else to the GPIO core service.
+ */
+static int32_t GpioDevDispatch(struct HdfDeviceIoClient *client, int cmd, struct HdfSBuf *data,
+                               struct HdfSBuf *reply)
+{
+    uint8_t port = 0;
+    uint8_t mask = 0;
+    uint8_t value = 0;
+    int32_t ret;
+
+    switch (cmd) {
+        case B91_GPIO_IO_PORT_READ: {
+            if (!HdfSbufReadUint8(data, &port)) {
+                return HDF_ERR_IO;
+            }
+            ret = B91GpioPortRead(port, &value);
+            if (ret == HDF_SUCCESS && !HdfSbufWriteUint8(reply, value)) {
+                return HDF_ERR_IO;
+            }
+            return ret;
+        }
+        case B91_GPIO_IO_PORT_WRITE: {
+            if (!HdfSbufReadUint8(data, &port) || !HdfSbufReadUint8(data, &mask) ||
+                !HdfSbufReadUint8(data, &value)) {
+                return HDF_ERR_IO;
+            }
+            return B91GpioPortWrite(port, mask, value);
+        }
+        case B91_GPIO_IO_PORT_SET:
+        case B91_GPIO_IO_PORT_CLEAR:
+        case B91_GPIO_IO_PORT_TOGGLE: {
+            if (!HdfSbufReadUint8(data, &port) || !HdfSbufReadUint8(data, &mask)) {
+                return HDF_ERR_IO;
+            }
+            if (cmd == B91_GPIO_IO_PORT_SET) {
+                return B91GpioPortSet(port, mask);
+            } else if (cmd == B91_GPIO_IO_PORT_CLEAR) {
+                return B91GpioPortClear(port, mask);
+            } else {
+                return B91GpioPortToggle(port, mask);
+            }
+        }
+        default: {
+            break;
+        }
+    }
+
+    if ((g_GpioCoreService == NULL) || (g_GpioCoreService->Dispatch == NULL)) {
+        return HDF_ERR_NOT_SUPPORT;
+    }
+    return g_GpioCoreService->Dispatch(client, cmd, data, reply);
+}
+
+#if B91_GPIO_BENCHMARK
+/**
+ * @brief Toggles one configured output pin through the HDF per-pin path and through the port API.
+ * @param[in]  local      - local pin index, must be configured as output.
+ * @param[in]  iterations - toggles per path.
+ * @param[out] result     - toggles per second of both paths.
+ */
+int32_t B91GpioToggleBenchmark(uint16_t local, uint32_t iterations, struct B91GpioBenchResult *result)
+{
+    uint8_t port;
+    uint8_t bit;
+
+    if (result == NULL || iterations == 0) {
+        return HDF_ERR_INVALID_PARAM;
+    }
+
+    int32_t ret = B91GpioLocalToPortBit(local, &port, &bit);
+    if (ret != HDF_SUCCESS) {
+        return ret;
+    }
+
+    uint32_t start = stimer_get_tick();
+    for (uint32_t i = 0; i < iterations; ++i) {
+        (void)GpioWrite(local, (i & 1) ? GPIO_VAL_LOW : GPIO_VAL_HIGH);
+    }
+    uint32_t ticks = stimer_get_tick() - start;
+    result->perPinTogglesPerSec = (uint32_t)(((uint64_t)iterations * SYSTEM_TIMER_TICK_1S) / (ticks ? ticks : 1));
+
+    start = stimer_get_tick();
+    for (uint32_t i = 0; i < iterations; ++i) {
+        (void)B91GpioPortToggle(port, BIT(bit));
+    }
+    ticks = stimer_get_tick() - start;
+    result->portTogglesPerSec = (uint32_t)(((uint64_t)iterations * SYSTEM_TIMER_TICK_1S) / (ticks ? ticks : 1));
+
+    return HDF_SUCCESS;
+}
+#endif /* B91_GPIO_BENCHMARK */
+
 static int32_t GpioDriverBind(struct HdfDeviceObject *device)
 {
     (void)device;
@@ -360,21 +1041,23 @@ static int32_t GpioDevSetIrq(struct GpioCntlr *cntlr, uint16_t local, uint16_t m
     gpio_pin_e gpioPin = g_GpioIndexToActualPin[pB91GpioCntlr->pinReflectionMap[local]];
     HDF_LOGD("%s: %d", __func__, local);
 
+    gpio_irq_trigger_type_e trigger;
+
     switch (mode & 0x0F) {
         case GPIO_IRQ_TRIGGER_HIGH: {
-            gpio_set_irq(gpioPin, INTR_HIGH_LEVEL);
+            trigger = INTR_HIGH_LEVEL;
             break;
         }
         case GPIO_IRQ_TRIGGER_LOW: {
-            gpio_set_irq(gpioPin, INTR_LOW_LEVEL);
+            trigger = INTR_LOW_LEVEL;
             break;
         }
         case GPIO_IRQ_TRIGGER_RISING: {
-            gpio_set_irq(gpioPin, INTR_RISING_EDGE);
+            trigger = INTR_RISING_EDGE;
             break;
         }
         case GPIO_IRQ_TRIGGER_FALLING: {
-            gpio_set_irq(gpioPin, INTR_FALLING_EDGE);
+            trigger = INTR_FALLING_EDGE;
             break;
         }
         default: {
@@ -382,6 +1065,26 @@ static int32_t GpioDevSetIrq(struct GpioCntlr *cntlr, uint16_t local, uint16_t m
         }
     }
 
+    switch (pB91GpioCntlr->config[local].source) {
+        case GPIO_IRQ_SRC_RISC0: {
+            gpio_set_gpio2risc0_irq(gpioPin, trigger);
+            break;
+        }
+        case GPIO_IRQ_SRC_RISC1: {
+            gpio_set_gpio2risc1_irq(gpioPin, trigger);
+            break;
+        }
+        default: {
+            gpio_set_irq(gpioPin, trigger);
+            break;
+        }
+    }
+
+    unsigned int r = core_interrupt_disable();
+    pB91GpioCntlr->config[local].trigger = trigger;
+    GpioUpdateIrqMasks(pB91GpioCntlr);
+    core_restore_interrupt(r);
+
     return HDF_SUCCESS;
 }
 
@@ -405,9 +1108,25 @@ static int32_t GpioDevEnableIrq(struct GpioCntlr *cntlr, uint16_t local)
     gpio_pin_e gpioPin = g_GpioIndexToActualPin[pB91GpioCntlr->pinReflectionMap[local]];
     HDF_LOGD("%s: %d", __func__, local);
 
-    gpio_irq_en(gpioPin);
-
+    unsigned int r = core_interrupt_disable();
     pB91GpioCntlr->config[local].irq_enabled = true;
+    GpioUpdateIrqMasks(pB91GpioCntlr);
+    core_restore_interrupt(r);
+
+    switch (pB91GpioCntlr->config[local].source) {
+        case GPIO_IRQ_SRC_RISC0: {
+            gpio_gpio2risc0_irq_en(gpioPin);
+            break;
+        }
+        case GPIO_IRQ_SRC_RISC1: {
+            gpio_gpio2risc1_irq_en(gpioPin);
+            break;
+        }
+        default: {
+            gpio_irq_en(gpioPin);
+            break;
+        }
+    }
 
     return HDF_SUCCESS;
 }
@@ -422,9 +1141,25 @@ static int32_t GpioDevDisableIrq(struct GpioCntlr *cntlr, uint16_t local)
     gpio_pin_e gpioPin = g_GpioIndexToActualPin[pB91GpioCntlr->pinReflectionMap[local]];
     HDF_LOGD("%s: %d", __func__, local);
 
-    gpio_irq_dis(gpioPin);
+    switch (pB91GpioCntlr->config[local].source) {
+        case GPIO_IRQ_SRC_RISC0: {
+            gpio_gpio2risc0_irq_dis(gpioPin);
+            break;
+        }
+        case GPIO_IRQ_SRC_RISC1: {
+            gpio_gpio2risc1_irq_dis(gpioPin);
+            break;
+        }
+        default: {
+            gpio_irq_dis(gpioPin);
+            break;
+        }
+    }
 
+    unsigned int r = core_interrupt_disable();
     pB91GpioCntlr->config[local].irq_enabled = false;
+    GpioUpdateIrqMasks(pB91GpioCntlr);
+    core_restore_interrupt(r);
 
     return HDF_SUCCESS;
 }
@@ -0,0 +1,132 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+#ifndef GPIO_TELINK_H
+#define GPIO_TELINK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct B91GpioIrqStats {
+    uint32_t irqCount;      /* shared GPIO interrupts taken */
+    uint32_t callbacks;     /* pins dispatched from the shared GPIO interrupt */
+    uint32_t unresolved;    /* interrupts where no pin could be identified and edge pins were broadcast */
+    uint32_t riscIrqCount;  /* GPIO2RISC0/GPIO2RISC1 interrupts taken */
+    uint32_t maxTicks;      /* longest shared GPIO handler run, in stimer ticks */
+    uint32_t totalTicks;    /* sum of shared GPIO handler runs, in stimer ticks */
+    uint32_t filtered;      /* edges dropped by the event debounce/glitch filter */
+    uint32_t eventOverflow; /* accepted edges lost because the event queue was full */
+};
+
+#ifndef B91_GPIO_EVENT_QUEUE_LEN
+#define B91_GPIO_EVENT_QUEUE_LEN 32
+#endif
+
+struct B91GpioEvent {
+    uint32_t tick;  /* stimer tick captured on interrupt entry */
+    uint16_t local; /* local (HDF) pin index */
+    uint8_t level;  /* pin level seen by the interrupt handler */
+};
+
+/**
+ * @brief      Copies the GPIO interrupt dispatch statistics. Average ISR time per edge is
+ *             totalTicks / irqCount stimer ticks (SYSTEM_TIMER_TICK_1US per microsecond).
+ * @param[out] stats - destination.
+ * @return     none.
+ */
+void B91GpioGetIrqStats(struct B91GpioIrqStats *stats);
+
+/*
+ * GPIO event service. Once enabled for a pin, every edge accepted by the filter is queued with the stimer
+ * timestamp taken on interrupt entry and the HDF callback is called; rejected edges produce neither.
+ * The pin interrupt still has to be set up and enabled through GpioSetIrq()/GpioEnableIrq().
+ */
+int32_t B91GpioEventEnable(uint16_t local, uint32_t debounceUs);
+int32_t B91GpioEventDisable(uint16_t local);
+
+/**
+ * @brief      Takes the oldest event from the queue.
+ * @param[out] event     - destination.
+ * @param[in]  timeoutMs - time to wait for an event, OSAL_WAIT_FOREVER to block.
+ * @return     HDF_SUCCESS or HDF_ERR_TIMEOUT.
+ */
+int32_t B91GpioEventRead(struct B91GpioEvent *event, uint32_t timeoutMs);
+
+/**
+ * @brief      Moves the HDF callback of a pin out of interrupt context: the ISR only queues it to the
+ *             deferred work task (B91_DEFER_PRIO_HIGH), where it runs preemptibly and may block.
+ *             Event timestamps and filtering are still done in the ISR.
+ * @param[in]  local  - local (HDF) pin index.
+ * @param[in]  enable - true to defer, false to call the callback from the ISR (default).
+ * @return     HDF_SUCCESS or HDF_ERR_INVALID_PARAM.
+ */
+int32_t B91GpioSetDeferred(uint16_t local, bool enable);
+
+enum B91GpioPort {
+    B91_GPIO_PORT_A = 0,
+    B91_GPIO_PORT_B,
+    B91_GPIO_PORT_C,
+    B91_GPIO_PORT_D,
+    B91_GPIO_PORT_E,
+    B91_GPIO_PORT_F,
+};
+
+/*
+ * Commands served by the GPIO device service in addition to the GPIO core ones.
+ * Request payload (uint8 each): READ: port; WRITE: port, mask, value; SET/CLEAR/TOGGLE: port, mask.
+ * READ replies with the uint8 port level.
+ */
+enum B91GpioIoCmd {
+    B91_GPIO_IO_PORT_READ = 0x100,
+    B91_GPIO_IO_PORT_WRITE,
+    B91_GPIO_IO_PORT_SET,
+    B91_GPIO_IO_PORT_CLEAR,
+    B91_GPIO_IO_PORT_TOGGLE,
+};
+
+/*
+ * Port API. A mask selects pins of one port (bit n is Px<n>); only pins listed in the pinMap of the
+ * GPIO controller may be used, others make the call fail with HDF_ERR_INVALID_PARAM. Each call is a
+ * single register access, set/clear/toggle/write are atomic against interrupts.
+ */
+int32_t B91GpioPortRead(uint8_t port, uint8_t *value);
+int32_t B91GpioPortWrite(uint8_t port, uint8_t mask, uint8_t value);
+int32_t B91GpioPortSet(uint8_t port, uint8_t mask);
+int32_t B91GpioPortClear(uint8_t port, uint8_t mask);
+int32_t B91GpioPortToggle(uint8_t port, uint8_t mask);
+
+/**
+ * @brief      Translates a local (HDF) pin index into its port and bit.
+ * @return     HDF_SUCCESS or HDF_ERR_INVALID_PARAM.
+ */
+int32_t B91GpioLocalToPortBit(uint16_t local, uint8_t *port, uint8_t *bit);
+
+#ifndef B91_GPIO_BENCHMARK
+#define B91_GPIO_BENCHMARK 0
+#endif
+
+#if B91_GPIO_BENCHMARK
+struct B91GpioBenchResult {
+    uint32_t perPinTogglesPerSec;
+    uint32_t portTogglesPerSec;
+};
+
+int32_t B91GpioToggleBenchmark(uint16_t local, uint32_t iterations, struct B91GpioBenchResult *result);
+#endif /* B91_GPIO_BENCHMARK */
+
+#endif // GPIO_TELINK_H
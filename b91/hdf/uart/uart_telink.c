@@ -18,12 +18,15 @@
 
 #include <string.h>
 #include <B91/dma.h>
+#include <B91/stimer.h>
 #include "hdf_device_desc.h"
 #include "device_resource_if.h"
 #include "hdf_log.h"
 #include "uart/uart_core.h"
 #include "osal_mem.h"
 #include "uart_tlsr9518.h"
+#include "boot_b91.h"
+#include "energy_b91.h"
 #include "hdf_log_adapter_debug.h" // workaround for log print
 
 #define HDF_LOG_TAG uart_telink
@@ -83,6 +86,7 @@ static int32_t uart_device_attach(struct UartHost *host, struct HdfDeviceObject
         OsalMemFree(port);
         return HDF_FAILURE;
     }
+    uart_pm_init(port);
 
     host->priv = driver_data;
     host->num = port->num;
@@ -124,6 +128,7 @@ static int32_t uart_device_init(struct HdfDeviceObject *device)
     }
 
     host->method = &g_uartHostMethod;
+    B91BootMark((host->num == UART0) ? "hdf-uart0" : "hdf-uart1");
 
     return HDF_SUCCESS;
 }
@@ -145,6 +150,7 @@ static void uart_device_release(struct HdfDeviceObject *device)
 
     if (host->priv != NULL) {
         uart_driver_data_t *driver_data = (uart_driver_data_t *)host->priv;
+        B91PmDeviceUnregister(&driver_data->port->pm);
         OsalMemFree(driver_data->port);
         OsalMemFree(driver_data);
         host->priv = NULL;
@@ -319,8 +325,15 @@ static int32_t UartHostDevInit(struct UartHost *host)
     }
 
     uart_dma_init(driver_data);
+    if (!driver_data->port->enable) {
+        B91EnergyOn((driver_data->port->num == UART0) ? B91_ENERGY_UART0 : B91_ENERGY_UART1);
+    }
     driver_data->port->enable = 1;
 
+    if (B91PmDeviceRegister(&driver_data->port->pm) != LOS_OK) {
+        HDF_LOGW("%s: too many PM devices, port %u may be cut by sleep", __func__, driver_data->port->num);
+    }
+
     return HDF_SUCCESS;
 }
 
@@ -338,7 +351,11 @@ static int32_t UartHostDevDeinit(struct UartHost *host)
         return HDF_FAILURE;
     }
 
+    if (driver_data->port->enable) {
+        B91EnergyOff((driver_data->port->num == UART0) ? B91_ENERGY_UART0 : B91_ENERGY_UART1);
+    }
     driver_data->port->enable = 0;
+    B91PmDeviceUnregister(&driver_data->port->pm);
 
     return HDF_SUCCESS;
 }
@@ -353,8 +370,19 @@ static int32_t UartHostDevRead(struct UartHost *host, uint8_t *data, uint32_t si
 
 static int32_t UartHostDevWrite(struct UartHost *host, uint8_t *data, uint32_t size)
 {
+    uart_driver_data_t *driver_data = (uart_driver_data_t *)host->priv;
+
     uint8_t ret = uart_send_dma(host->num, data, size);
-    return (ret == 1) ? HDF_SUCCESS : HDF_FAILURE;
+    if (ret != 1) {
+        return HDF_FAILURE;
+    }
+
+    if (driver_data != NULL) {
+        B91PmDeviceBusyUntil(&driver_data->port->pm,
+                             stimer_get_tick() + uart_tx_time_ticks(driver_data, size));
+    }
+
+    return HDF_SUCCESS;
 }
 
 
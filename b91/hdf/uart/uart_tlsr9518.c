@@ -17,6 +17,8 @@
  *****************************************************************************/
 
 #include <B91/clock.h>
+#include <B91/stimer.h>
+#include <pm_governor_b91.h>
 #include "hdf_log_adapter_debug.h"
 #include "uart_tlsr9518.h"
 
@@ -93,3 +95,43 @@ void uart_dma_init(uart_driver_data_t *driver_data)
     dma_clr_irq_mask(DMA2, TC_MASK|ABT_MASK|ERR_MASK);
     uart_clr_tx_done(driver_data->port->num);
 }
+
+
+uint32_t uart_tx_time_ticks(const uart_driver_data_t *driver_data, uint32_t size)
+{
+    return (uint32_t)(((uint64_t)size * MAX_BITS_PER_BYTE * SYSTEM_TIMER_TICK_1S) / driver_data->baudrate);
+}
+
+
+static uint32_t uart_pm_prepare(B91PmDevice *dev, uint32_t mode)
+{
+    uart_port_t *port = (uart_port_t *)dev->priv;
+
+    return (port->enable && uart_tx_is_busy(port->num)) ? LOS_NOK : LOS_OK;
+}
+
+
+static void uart_pm_resume(B91PmDevice *dev, uint32_t mode)
+{
+    uart_port_t *port = (uart_port_t *)dev->priv;
+
+    if (!port->enable) {
+        return;
+    }
+
+    if (mode == B91_PM_MODE_SUSPEND) {
+        uart_clr_tx_index(port->num);
+        uart_clr_rx_index(port->num);
+    } else if ((mode == B91_PM_MODE_DEEP_RET) || (mode == B91_PM_CLOCK_CHANGE)) {
+        uart_dma_init(port->driver_data);
+    }
+}
+
+
+void uart_pm_init(uart_port_t *port)
+{
+    port->pm.name = (port->num == UART0) ? "hdf-uart0" : "hdf-uart1";
+    port->pm.priv = port;
+    port->pm.prepare = uart_pm_prepare;
+    port->pm.resume = uart_pm_resume;
+}
@@ -21,6 +21,7 @@
 
 
 #include <B91/uart.h>
+#include <pm_device_b91.h>
 #include "uart_if.h"
 
 
@@ -40,12 +41,15 @@ typedef struct _uart_port {
     uint32_t interrupt;
     uint32_t addr;
     uart_driver_data_t *driver_data;
+    B91PmDevice pm;
 } uart_port_t;
 
 
 uart_parity_e parity_from_uattr(struct UartAttribute uattr);
 uart_stop_bit_e stopbit_from_uattr(struct UartAttribute uattr);
 void uart_dma_init(uart_driver_data_t *driver_data);
+uint32_t uart_tx_time_ticks(const uart_driver_data_t *driver_data, uint32_t size);
+void uart_pm_init(uart_port_t *port);
 
 
 #endif // UART_TLSR9518_H
@@ -21,7 +21,79 @@
 
 #include <los_interrupt.h>
 
+#include <B91/plic.h>
+
+/*
+ * PLIC source priorities (IRQ_PRI_LEV1..IRQ_PRI_LEV3, higher wins). When several sources are pending the
+ * external interrupt handler serves them in priority order within one trap, up to B91_IRQ_DISPATCH_MAX.
+ * Handlers do not nest: the priority picks the next source to serve, it does not preempt a running handler.
+ */
+#define B91_IRQ_PRIO_DEFAULT IRQ_PRI_LEV1
+#define B91_IRQ_PRIO_TIMER   IRQ_PRI_LEV2
+#define B91_IRQ_PRIO_RADIO   IRQ_PRI_LEV3
+
+#ifndef B91_IRQ_DISPATCH_MAX
+#define B91_IRQ_DISPATCH_MAX 8
+#endif
+
+/**
+ * @brief      Installs the handler of a PLIC source, its priority is left unchanged.
+ * @return     LOS_OK or OS_ERRNO_HWI_NUM_INVALID.
+ */
 UINT32 B91IrqRegister(UINT32 irq_num, HWI_PROC_FUNC handler, HWI_ARG_T irqParam);
+
+/**
+ * @brief      Installs the handler of a PLIC source and sets its priority.
+ * @param[in]  prio - IRQ_PRI_LEV1..IRQ_PRI_LEV3.
+ * @return     LOS_OK, OS_ERRNO_HWI_NUM_INVALID or OS_ERRNO_HWI_PRIO_INVALID.
+ */
+UINT32 B91IrqRegisterPrio(UINT32 irq_num, HWI_PROC_FUNC handler, HWI_ARG_T irqParam, UINT32 prio);
+UINT32 B91IrqSetPriority(UINT32 irq_num, UINT32 prio);
+
+/**
+ * @brief      Masks the sources whose priority is not above prio, higher ones keep interrupting.
+ *             Unlike LOS_IntLock() this keeps radio and timer interrupts alive in a critical section.
+ * @param[in]  prio - threshold to raise to, a lower value than the current one is ignored.
+ * @return     previous threshold, to be passed to B91IrqRestoreThreshold().
+ */
+UINT32 B91IrqRaiseThreshold(UINT32 prio);
+VOID B91IrqRestoreThreshold(UINT32 prev);
+
+#ifndef B91_IRQ_PROFILE
+#define B91_IRQ_PROFILE 0
+#endif
+
+#if B91_IRQ_PROFILE
+/* Histogram bucket i counts handler runs shorter than B91_IRQ_HIST_BASE << i cycles, the last one the rest */
+#ifndef B91_IRQ_HIST_BASE
+#define B91_IRQ_HIST_BASE 64
+#endif
+#define B91_IRQ_HIST_BUCKETS 8
+
+typedef struct {
+    UINT32 count;                      /* handler runs */
+    UINT32 unhandled;                  /* claims that found no registered handler */
+    UINT32 minCycles;                  /* shortest handler run */
+    UINT32 maxCycles;                  /* longest handler run */
+    UINT64 totalCycles;                /* sum of handler runs, average is totalCycles / count */
+    UINT32 maxLatency;                 /* longest wait from first seen pending to handler call */
+    UINT32 hist[B91_IRQ_HIST_BUCKETS]; /* handler run time histogram */
+} B91IrqProfile;
+
+/**
+ * @brief      Copies the profile of one PLIC source.
+ * @return     LOS_OK or OS_ERRNO_HWI_NUM_INVALID.
+ */
+UINT32 B91IrqProfileGet(UINT32 irq_num, B91IrqProfile *profile);
+VOID B91IrqProfileReset(VOID);
+
+/**
+ * @brief      Prints one line per source seen since the last reset, also available as the "irqprof" shell
+ *             command ("irqprof reset" clears the counters).
+ */
+VOID B91IrqProfileDump(VOID);
+#endif /* B91_IRQ_PROFILE */
+
 VOID B91IrqInit(VOID);
 
 #endif  // _B91_IRQ_H
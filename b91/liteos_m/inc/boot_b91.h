@@ -0,0 +1,84 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+#ifndef _BOOT_B91_H
+#define _BOOT_B91_H
+
+#include <los_compiler.h>
+
+/*
+ * Boot profiling and late initialization.
+ *
+ * B91BootMark() stamps a boot stage with the stimer, which counts from power-up, so the first stamp already
+ * includes the ROM and startup code. The board marks its own stages and the HDF drivers mark the end of
+ * their Init; the first successful advertising enable through the stack is marked "adv", which gives the
+ * time to first advertisement. Applications mark their own milestones the same way.
+ *
+ * With B91_LAZY_INIT the HDF device manager starts in quick load mode: only drivers with preload = 0 are
+ * initialized before the scheduler starts, those with preload = 1 (see hcs/) are initialized by the late init
+ * task together with the littlefs mount, at a priority below the system init task, so that they run in the
+ * time the system init task, and the BLE stack brought up by it, is waiting. Without B91_LAZY_INIT all
+ * drivers are initialized by DeviceManagerStart() as before and the late init task only mounts littlefs.
+ */
+
+#ifndef B91_LAZY_INIT
+#define B91_LAZY_INIT 0
+#endif
+
+/* Print the boot stages once the late init is done */
+#ifndef B91_BOOT_PROFILE
+#define B91_BOOT_PROFILE 0
+#endif
+
+#ifndef B91_BOOT_MARK_MAX
+#define B91_BOOT_MARK_MAX 32
+#endif
+
+/**
+ * @brief      Records that a boot stage has been reached. Safe to call before the kernel is initialized and
+ *             from any task. Marks past B91_BOOT_MARK_MAX are counted and dropped.
+ * @param[in]  name - stage name, must stay valid, e.g. a string literal.
+ */
+VOID B91BootMark(const CHAR *name);
+
+/**
+ * @brief      Records a boot stage reached earlier, for stages which run before .bss is set up.
+ * @param[in]  tick - stimer when the stage was reached.
+ */
+VOID B91BootMarkAt(const CHAR *name, UINT32 tick);
+
+/**
+ * @brief      Creates the late init task which runs func and then marks the late init done.
+ * @return     LOS_OK or error code of task creation.
+ */
+UINT32 B91BootLateInit(VOID (*func)(VOID));
+
+/**
+ * @brief      Waits until the late init is done, for code which needs the file system or a deferred driver.
+ *             Returns at once when called from the late init task itself. Task context.
+ * @param[in]  timeout - in ticks, LOS_WAIT_FOREVER to wait without limit.
+ * @return     LOS_OK, or LOS_NOK on timeout.
+ */
+UINT32 B91BootWaitLateInit(UINT32 timeout);
+
+/**
+ * @brief      Prints the boot stages with their time since power-up and since the previous stage.
+ */
+VOID B91BootDump(VOID);
+
+#endif /* _BOOT_B91_H */
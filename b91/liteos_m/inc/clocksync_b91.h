@@ -0,0 +1,87 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+#ifndef _CLOCKSYNC_B91_H
+#define _CLOCKSYNC_B91_H
+
+#include <stdint.h>
+
+/*
+ * Keeps the OS machine timer (mtime) in step with the system timer (stimer) across sleeps. Pure arithmetic
+ * without hardware access, util/b91_clock_replay.c runs it on the host.
+ *
+ * - stimer spans are converted to mtime ticks with the division remainder carried to the next sleep, so
+ *   truncation never accumulates.
+ * - The 32k RC timer, which is what keeps time while asleep, is calibrated against the crystal driven
+ *   stimer over the active periods between sleeps. Once calibrated the sleep span is taken from the 32k
+ *   tick count instead of the stimer value the sleep code restored from its own, older calibration.
+ * - The time spent between sampling the stimer on wake-up and writing mtime is measured on every resync
+ *   and its running average is added as correction.
+ */
+
+/* 32k ticks of active time needed before a calibration sample is taken (one second) */
+#ifndef B91_CLOCK_SYNC_CAL_WINDOW
+#define B91_CLOCK_SYNC_CAL_WINDOW 32768
+#endif
+
+typedef struct {
+    uint32_t mtimeHz;
+    uint32_t stimerHz;
+    uint32_t remainder;       /* stimer ticks * mtimeHz not converted yet, below stimerHz */
+    uint32_t stimerPer32kQ16; /* stimer ticks per 32k tick in 16.16 fixed point, 0 until calibrated */
+    uint32_t correction;      /* resync overhead in stimer ticks, running average */
+    uint32_t calStimer;       /* active stimer ticks collected for the next calibration sample */
+    uint32_t cal32k;          /* active 32k ticks collected for the next calibration sample */
+    uint32_t calibrations;    /* calibration samples taken */
+    uint32_t resyncs;         /* sleeps accounted */
+    uint64_t sleptStimer;     /* total sleep time in stimer ticks, as used for mtime */
+    int64_t rcMinusStimer;    /* sum of 32k based minus restored stimer spans, the drift corrected so far */
+} B91ClockSync;
+
+void B91ClockSyncInit(B91ClockSync *cs, uint32_t mtimeHz, uint32_t stimerHz);
+
+/**
+ * @brief      Converts a stimer span to mtime ticks, carrying the remainder.
+ */
+uint32_t B91ClockSyncToMticks(B91ClockSync *cs, uint32_t stimerTicks);
+
+/**
+ * @brief      Accounts an active period (crystal running) for the 32k calibration.
+ * @param[in]  stimerTicks - stimer ticks elapsed.
+ * @param[in]  rcTicks     - 32k ticks elapsed over the same period.
+ */
+void B91ClockSyncActive(B91ClockSync *cs, uint32_t stimerTicks, uint32_t rcTicks);
+
+/**
+ * @brief      Drops the collected calibration data, e.g. after the 32k RC was trimmed again.
+ */
+void B91ClockSyncRestartCalibration(B91ClockSync *cs);
+
+/**
+ * @brief      Computes the length of a sleep in stimer ticks, correction included.
+ * @param[in]  stimerTicks - stimer span as restored by the sleep code.
+ * @param[in]  rcTicks     - 32k ticks elapsed over the sleep.
+ */
+uint32_t B91ClockSyncSleepSpan(B91ClockSync *cs, uint32_t stimerTicks, uint32_t rcTicks);
+
+/**
+ * @brief      Feeds one measurement of the time between sampling the stimer on wake-up and writing mtime.
+ */
+void B91ClockSyncTuneCorrection(B91ClockSync *cs, uint32_t overheadTicks);
+
+#endif /* _CLOCKSYNC_B91_H */
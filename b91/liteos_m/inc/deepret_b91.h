@@ -0,0 +1,77 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+#ifndef _DEEPRET_B91_H
+#define _DEEPRET_B91_H
+
+#include <los_compiler.h>
+
+#include <B91/pm.h>
+
+/*
+ * Deep sleep with SRAM retention for LiteOS idle.
+ *
+ * Only the low B91_PM_DEEP_RET_WINDOW bytes of ILM keep their content, the rest of the SRAM and the core and
+ * peripheral registers are lost. With deep retention built in, liteos.ld ends the LOS heap at the window and
+ * leaves the ILM above it unused. Before sleeping the DLM that LiteOS uses (.data, .bss, interrupt stacks and
+ * the newlib sbrk heap above _end) is copied into the .deepret_save area inside the window, together with the
+ * CPU context. On wake-up the reset vector calls B91DeepRetResume(), which copies the RAM back and returns into
+ * the idle task as if the sleep call had returned; BoardConfig and main() are skipped. The GPIO, the UARTs and
+ * the other peripherals are set up again by their resume hooks (see pm_device_b91.h).
+ *
+ * liteos.ld sizes .deepret_save from the DLM layout plus B91_PM_DEEP_RET_SBRK_SAVE bytes of sbrk heap and fails
+ * the link when the window has no room left for the heap. A sleep is skipped while the sbrk heap is larger
+ * than its reserve.
+ */
+
+#ifndef B91_PM_DEEP_RET
+#define B91_PM_DEEP_RET 0
+#endif
+
+#ifndef B91_PM_DEEP_RET_MODE
+#define B91_PM_DEEP_RET_MODE DEEPSLEEP_MODE_RET_SRAM_LOW64K
+#endif
+
+#if B91_PM_DEEP_RET_MODE == DEEPSLEEP_MODE_RET_SRAM_LOW32K
+#define B91_PM_DEEP_RET_WINDOW (32 * 1024)
+#else
+#define B91_PM_DEEP_RET_WINDOW (64 * 1024)
+#endif
+
+#ifndef B91_PM_DEEP_RET_SBRK_SAVE
+#define B91_PM_DEEP_RET_SBRK_SAVE 1024
+#endif
+
+/**
+ * @brief      Tells whether the current memory layout can be kept across deep retention.
+ */
+BOOL B91DeepRetAvailable(VOID);
+
+/**
+ * @brief      Enters deep sleep with SRAM retention. Must be called with interrupts locked.
+ *             On return the clocks and the PLIC are set up again; the caller restores the machine timer
+ *             and the other peripherals (see pm_device_b91.h).
+ * @param[in]  wakeTick - stimer tick to wake up at.
+ * @return     TRUE after a wake-up, FALSE if the chip did not go to sleep.
+ */
+BOOL B91DeepRetSleep(UINT32 wakeTick);
+
+/* Called from the reset vector on a retained stack, returns only on a cold boot */
+VOID B91DeepRetResume(VOID);
+
+#endif /* _DEEPRET_B91_H */
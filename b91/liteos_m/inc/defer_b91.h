@@ -0,0 +1,72 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+#ifndef _DEFER_B91_H
+#define _DEFER_B91_H
+
+#include <los_compiler.h>
+
+/*
+ * Deferred interrupt work. An interrupt handler posts a small work item and returns; the work task runs it
+ * later in task context, where it can be preempted and may block. Items of B91_DEFER_PRIO_HIGH always run
+ * before pending B91_DEFER_PRIO_LOW ones, items of one priority run in posting order.
+ */
+
+/* Slots per priority queue, must be a power of two */
+#ifndef B91_DEFER_QUEUE_LEN
+#define B91_DEFER_QUEUE_LEN 32
+#endif
+
+#ifndef B91_DEFER_TASK_PRIO
+#define B91_DEFER_TASK_PRIO 2
+#endif
+
+#ifndef B91_DEFER_TASK_STACKSIZE
+#define B91_DEFER_TASK_STACKSIZE 2048
+#endif
+
+typedef enum {
+    B91_DEFER_PRIO_HIGH = 0,
+    B91_DEFER_PRIO_LOW,
+    B91_DEFER_PRIO_NUM,
+} B91DeferPrio;
+
+typedef VOID (*B91DeferFunc)(VOID *arg, UINT32 data);
+
+typedef struct {
+    UINT32 posted[B91_DEFER_PRIO_NUM];   /* items accepted */
+    UINT32 dropped[B91_DEFER_PRIO_NUM];  /* items rejected because the queue was full */
+    UINT32 maxDepth[B91_DEFER_PRIO_NUM]; /* queue high-water mark seen by the work task */
+} B91DeferStats;
+
+/**
+ * @brief      Creates the task which runs deferred work. Items posted before are run once it starts.
+ * @return     LOS_OK or error code of task creation.
+ */
+UINT32 B91DeferInit(VOID);
+
+/**
+ * @brief      Queues func(arg, data) to run in the work task. Lock-free, safe to call from any ISR or task.
+ * @param[in]  prio - B91_DEFER_PRIO_HIGH or B91_DEFER_PRIO_LOW.
+ * @return     LOS_OK, or LOS_NOK if the queue is full or prio is invalid (the item is counted as dropped).
+ */
+UINT32 B91DeferPost(UINT32 prio, B91DeferFunc func, VOID *arg, UINT32 data);
+
+VOID B91DeferGetStats(B91DeferStats *stats);
+
+#endif /* _DEFER_B91_H */
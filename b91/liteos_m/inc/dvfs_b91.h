@@ -0,0 +1,93 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+#ifndef _DVFS_B91_H
+#define _DVFS_B91_H
+
+#include <los_compiler.h>
+
+#include <dvfs_governor_b91.h>
+
+/*
+ * Runtime CPU frequency scaling.
+ *
+ * The levels are the clock_init() settings between B91_DVFS_MIN_MHZ and B91_DVFS_MAX_MHZ, all from the
+ * 192 MHz PLL with the flash clock unchanged. The idle code measures the load of every B91_DVFS_WINDOW_US
+ * window, the window is closed on idle entry or from the OS tick, and the governor in dvfs_governor_b91.c
+ * picks the level. The new level is set on idle entry, or by the defer task (defer_b91.h) when the tick
+ * closed the window of a CPU that does not go idle; the tick interrupt itself never changes clocks. Code
+ * whose speed follows the CPU clock (PKE, AES) brackets it with B91DvfsBoost()/B91DvfsUnboost(); flash
+ * program and erase run from the MSPI clock, which no level changes, and gain nothing from a boost.
+ *
+ * Clocks are only changed while no PM device (pm_device_b91.h) is busy and none vetoes B91_PM_CLOCK_CHANGE,
+ * devices then get B91_PM_CLOCK_CHANGE in their resume callback to recompute dividers from sys_clk. A
+ * change that cannot be done is retried on the next tick or idle entry. The stimer and the machine timer do not
+ * run from CCLK, so the OS tick and the sleep code are not affected.
+ *
+ * Only the frequency is scaled, the core supply is left as sys_init() set it.
+ */
+
+#ifndef B91_DVFS
+#define B91_DVFS 0
+#endif
+
+#ifndef B91_DVFS_MIN_MHZ
+#define B91_DVFS_MIN_MHZ 24
+#endif
+
+#ifndef B91_DVFS_MAX_MHZ
+#define B91_DVFS_MAX_MHZ 96
+#endif
+
+#ifndef B91_DVFS_WINDOW_US
+#define B91_DVFS_WINDOW_US 20000
+#endif
+
+/**
+ * @brief      Builds the level table, starts at the level matching the boot clock and hooks the OS tick.
+ *             Called before LOS_Start().
+ */
+VOID B91DvfsInit(VOID);
+
+/**
+ * @brief      Switches to the top level until the matching B91DvfsUnboost(). Boosts nest. Task context.
+ */
+VOID B91DvfsBoost(VOID);
+
+VOID B91DvfsUnboost(VOID);
+
+/**
+ * @brief      Called by the idle code with interrupts locked around each idle period. The window load
+ *             is evaluated and a pending level change is done on entry.
+ */
+VOID B91DvfsIdleEnter(VOID);
+VOID B91DvfsIdleExit(VOID);
+
+/**
+ * @brief      Sets the clocks of the current level again after SystemInit() reset them to the boot ones.
+ */
+VOID B91DvfsRestore(VOID);
+
+VOID B91DvfsGetGovernor(B91DvfsGovernor *gov);
+
+/**
+ * @brief      Prints per-level residency and load, the number of switches and of postponed switches.
+ */
+VOID B91DvfsDumpStats(VOID);
+
+#endif /* _DVFS_B91_H */
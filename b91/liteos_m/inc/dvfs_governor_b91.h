@@ -0,0 +1,90 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+#ifndef _DVFS_GOVERNOR_B91_H
+#define _DVFS_GOVERNOR_B91_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * CPU frequency governor. Pure decision logic without hardware access, so that util/b91_dvfs_replay.c can
+ * run it on the host against recorded load traces.
+ *
+ * Once per window the work done, busy time times the current frequency, is compared against what each
+ * level can do at targetPct utilization and the lowest level that keeps up is wanted, the top one after a
+ * window without idle time. Higher levels are taken at once, lower ones only after downHold windows in a
+ * row asked for less. While a boost is held the top level is used.
+ */
+
+#define B91_DVFS_LEVEL_MAX 6
+
+#ifndef B91_DVFS_TARGET_PCT
+#define B91_DVFS_TARGET_PCT 70
+#endif
+
+#ifndef B91_DVFS_DOWN_HOLD
+#define B91_DVFS_DOWN_HOLD 3
+#endif
+
+typedef struct {
+    uint32_t levelNum;
+    uint32_t freqMhz[B91_DVFS_LEVEL_MAX]; /* ascending */
+    uint32_t targetPct;
+    uint32_t downHold;
+
+    uint32_t level;      /* level in use */
+    uint32_t lowWindows; /* windows in a row that wanted a lower level */
+    uint32_t boosts;     /* boosts held */
+
+    uint32_t switches;                       /* level changes */
+    uint64_t residencyUs[B91_DVFS_LEVEL_MAX]; /* time spent at each level */
+    uint64_t busyUs[B91_DVFS_LEVEL_MAX];      /* time not idle at each level */
+} B91DvfsGovernor;
+
+/**
+ * @brief      Sets up the levels and clears the statistics.
+ * @param[in]  freqMhz  - level frequencies in ascending order.
+ * @param[in]  levelNum - number of levels, up to B91_DVFS_LEVEL_MAX.
+ * @param[in]  level    - level in use now.
+ */
+void B91DvfsGovernorInit(B91DvfsGovernor *gov, const uint32_t *freqMhz, uint32_t levelNum, uint32_t level);
+
+/**
+ * @brief      Picks the level for the next window from the load of the one that just ended.
+ * @param[in]  windowUs - window length.
+ * @param[in]  busyUs   - time not spent idle in the window.
+ * @return     the wanted level, the current one if no change is due.
+ */
+uint32_t B91DvfsGovernorWindow(B91DvfsGovernor *gov, uint32_t windowUs, uint32_t busyUs);
+
+/**
+ * @brief      Takes or releases a boost.
+ * @return     the wanted level.
+ */
+uint32_t B91DvfsGovernorBoost(B91DvfsGovernor *gov, bool hold);
+
+/**
+ * @brief      Accounts time spent at the current level and moves to a new one.
+ * @param[in]  level     - level in use from now on, may be the current one.
+ * @param[in]  elapsedUs - time since the last call.
+ * @param[in]  busyUs    - part of elapsedUs not spent idle.
+ */
+void B91DvfsGovernorSetLevel(B91DvfsGovernor *gov, uint32_t level, uint32_t elapsedUs, uint32_t busyUs);
+
+#endif /* _DVFS_GOVERNOR_B91_H */
@@ -0,0 +1,120 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+#ifndef _ENERGY_B91_H
+#define _ENERGY_B91_H
+
+#include <los_compiler.h>
+
+#include <pm_governor_b91.h>
+
+/*
+ * Charge accounting.
+ *
+ * Time is measured in stimer ticks and turned into charge with a table of typical currents:
+ * - CPU: running time at each clock, I = B91_ENERGY_CPU_BASE_UA + MHz * B91_ENERGY_CPU_UA_PER_MHZ, split
+ *   per task only when the product enables LOSCFG_DEBUG_HOOK (task switch hook), which the B91 configs
+ *   leave off; without it the report has no task rows;
+ * - idle: the residency and charge of each sleep mode as kept by the idle governor (B91_PM_CURRENT_*);
+ * - consumers: time between B91EnergyOn() and B91EnergyOff() of the radio, flash program and erase and
+ *   the UARTs, not counting time the chip spent in suspend or deep retention. The radio is bracketed by the
+ *   RF PA switch callback (blc_rf_pa_cb), which the link layer calls on every TX, RX and off transition;
+ *   the accounting chains it in front of the board PA handler and puts it back on idle entry if a later
+ *   rf_pa_init() replaced it. Until the callback or a B91EnergyOn(B91_ENERGY_RADIO) is seen the radio row
+ *   is reported as unavailable.
+ *
+ * Currents are typical values at 3.3 V, calibrate them per board with B91EnergySetCurrent() and
+ * B91EnergySetCpuCurrent().
+ */
+
+#ifndef B91_ENERGY_CPU_BASE_UA
+#define B91_ENERGY_CPU_BASE_UA 1000
+#endif
+#ifndef B91_ENERGY_CPU_UA_PER_MHZ
+#define B91_ENERGY_CPU_UA_PER_MHZ 40
+#endif
+#ifndef B91_ENERGY_CURRENT_RADIO_UA
+#define B91_ENERGY_CURRENT_RADIO_UA 5000
+#endif
+#ifndef B91_ENERGY_CURRENT_FLASH_PROGRAM_UA
+#define B91_ENERGY_CURRENT_FLASH_PROGRAM_UA 8000
+#endif
+#ifndef B91_ENERGY_CURRENT_FLASH_ERASE_UA
+#define B91_ENERGY_CURRENT_FLASH_ERASE_UA 8000
+#endif
+#ifndef B91_ENERGY_CURRENT_UART_UA
+#define B91_ENERGY_CURRENT_UART_UA 150
+#endif
+
+typedef enum {
+    B91_ENERGY_RADIO = 0,     /* transceiver in TX or RX */
+    B91_ENERGY_FLASH_PROGRAM, /* flash page program */
+    B91_ENERGY_FLASH_ERASE,   /* flash sector erase */
+    B91_ENERGY_UART0,         /* UART0 enabled */
+    B91_ENERGY_UART1,         /* UART1 enabled */
+    B91_ENERGY_CONSUMER_NUM,
+} B91EnergyConsumer;
+
+/* Receives the report one line at a time, line is NUL terminated and len excludes the NUL */
+typedef VOID (*B91EnergyWriteFunc)(VOID *arg, const CHAR *line, UINT32 len);
+
+/**
+ * @brief      Starts accounting and installs the task switch hook and the RF PA callback.
+ */
+VOID B91EnergyInit(VOID);
+
+/**
+ * @brief      Marks a consumer on and off. Calls nest. Safe to call from an ISR.
+ */
+VOID B91EnergyOn(B91EnergyConsumer consumer);
+VOID B91EnergyOff(B91EnergyConsumer consumer);
+
+VOID B91EnergySetCurrent(B91EnergyConsumer consumer, UINT32 ua);
+VOID B91EnergySetCpuCurrent(UINT32 baseUa, UINT32 uaPerMhz);
+
+/**
+ * @brief      Tells the accounting that the CPU clock changed, called after sys_clk is updated.
+ */
+VOID B91EnergyCpuClock(UINT32 mhz);
+
+/**
+ * @brief      Called by the idle code with interrupts locked: the CPU time of the idle task stops on entry
+ *             and resumes on exit, the idle time itself is accounted by the idle governor.
+ * @param[in]  sleptTicks - on exit, stimer ticks spent in suspend or deep retention, 0 after WFI.
+ */
+VOID B91EnergyIdleEnter(VOID);
+VOID B91EnergyIdleExit(UINT32 sleptTicks);
+
+/**
+ * @brief      Writes the report: total, per subsystem and per task, time and charge in uAh.
+ * @param[in]  write - line sink, e.g. the debug UART or the USB debug channel.
+ * @param[in]  csv   - TRUE for comma separated lines, FALSE for a table.
+ */
+VOID B91EnergyReport(B91EnergyWriteFunc write, VOID *arg, BOOL csv);
+
+/**
+ * @brief      Prints the report as a table to the debug UART.
+ */
+VOID B91EnergyDump(VOID);
+
+/**
+ * @brief      Clears all counters, the idle governor statistics are not touched.
+ */
+VOID B91EnergyReset(VOID);
+
+#endif /* _ENERGY_B91_H */
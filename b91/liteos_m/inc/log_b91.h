@@ -0,0 +1,98 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+#ifndef _LOG_B91_H
+#define _LOG_B91_H
+
+#include <los_compiler.h>
+
+#include <B91/uart.h>
+
+/* Ring capacity in bytes, must be a power of two */
+#ifndef B91_LOG_RING_SIZE
+#define B91_LOG_RING_SIZE 4096
+#endif
+
+/* Size of the DMA staging buffer, also the largest record accepted */
+#ifndef B91_LOG_STAGE_SIZE
+#define B91_LOG_STAGE_SIZE 512
+#endif
+
+#ifndef B91_LOG_TASK_PRIO
+#define B91_LOG_TASK_PRIO 25
+#endif
+
+#ifndef B91_LOG_TASK_STACKSIZE
+#define B91_LOG_TASK_STACKSIZE 1024
+#endif
+
+typedef struct {
+    UINT32 records;      /* records committed to the ring */
+    UINT32 bytes;        /* payload bytes committed to the ring */
+    UINT32 dropped;      /* records rejected because the ring was full */
+    UINT32 droppedBytes; /* payload bytes of the rejected records */
+    UINT32 maxUsed;      /* ring high-water mark in bytes */
+} B91LogStats;
+
+/**
+ * @brief      Binds the log pipeline to the debug UART and configures its TX DMA channel.
+ *             Records may be queued before this call, they are sent once the drain task runs.
+ * @param[in]  port     - debug UART.
+ * @param[in]  chn      - DMA channel reserved for log output.
+ * @param[in]  baudrate - UART baudrate, used to estimate transfer time.
+ * @return     none.
+ */
+VOID B91LogOutputInit(uart_num_e port, dma_chn_e chn, UINT32 baudrate);
+
+/**
+ * @brief      Creates the low-priority task which drains the ring over UART DMA.
+ * @return     LOS_OK or error code of task creation.
+ */
+UINT32 B91LogTaskInit(VOID);
+
+/**
+ * @brief      Reserves space for a record of up to maxLen bytes. Safe to call from any task or ISR.
+ * @param[in]  maxLen - largest payload the caller is going to write.
+ * @return     pointer to the payload area or NULL if the ring is full (the record is counted as dropped).
+ */
+VOID *B91LogReserve(UINT32 maxLen);
+
+/**
+ * @brief      Publishes a record obtained from B91LogReserve().
+ * @param[in]  payload - pointer returned by B91LogReserve().
+ * @param[in]  len     - actual payload length, not greater than the reserved one. The unused rest of the
+ *                        reservation goes back to the ring unless another record was reserved after it.
+ * @return     none.
+ */
+VOID B91LogCommit(VOID *payload, UINT32 len);
+
+/**
+ * @brief      Copies data into the ring, splitting it into several records if needed.
+ * @return     number of bytes accepted.
+ */
+UINT32 B91LogWrite(const VOID *data, UINT32 len);
+
+/**
+ * @brief      Synchronously sends everything committed so far. Intended for panic and assert paths.
+ * @return     none.
+ */
+VOID B91LogFlush(VOID);
+
+VOID B91LogGetStats(B91LogStats *stats);
+
+#endif /* _LOG_B91_H */
@@ -0,0 +1,74 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+#ifndef _LOG_TOKEN_B91_H
+#define _LOG_TOKEN_B91_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <los_compiler.h>
+
+/*
+ * Tokenized logging.
+ *
+ * With B91_LOG_TOKENIZED the format string of B91_LOGT() is placed into the ".b91_log_tokens" section, which
+ * liteos.ld links as a non-allocated (INFO) section starting at address 0: it stays in the ELF but is not
+ * part of the flashed image. The string offset in that section is the 32-bit token. Only a frame made of
+ * the token and the raw 32-bit arguments goes to the debug UART, util/b91_log_detokenize.py restores the
+ * text from the ELF.
+ *
+ * Frame: B91_LOG_TOKEN_MAGIC, argument count, token (LE32), arguments (LE32 each).
+ *
+ * Only arguments that fit into 32 bits are supported (integers, characters, pointers); "%s" is shown
+ * as the pointer value. Up to B91_LOG_TOKEN_ARGS_MAX arguments.
+ */
+
+#ifndef B91_LOG_TOKENIZED
+#define B91_LOG_TOKENIZED 0
+#endif
+
+#define B91_LOG_TOKEN_MAGIC    0xFE
+#define B91_LOG_TOKEN_ARGS_MAX 8
+
+#define B91_LOG_NARGS(...)                                         B91_LOG_NARGS_(0, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define B91_LOG_NARGS_(_0, _1, _2, _3, _4, _5, _6, _7, _8, N, ...) N
+
+#if B91_LOG_TOKENIZED
+
+#define B91_LOGT(fmt, ...)                                                                                            \
+    do {                                                                                                              \
+        static const char _b91LogFmt[] __attribute__((section(".b91_log_tokens"), used)) = fmt;                      \
+        B91LogTokenEmit((UINT32)(uintptr_t)_b91LogFmt, B91_LOG_NARGS(__VA_ARGS__), ##__VA_ARGS__);                   \
+    } while (0)
+
+#else /* B91_LOG_TOKENIZED */
+
+#define B91_LOGT(fmt, ...) printf(fmt, ##__VA_ARGS__)
+
+#endif /* B91_LOG_TOKENIZED */
+
+/**
+ * @brief      Queues a tokenized frame into the log ring. Use B91_LOGT() instead of calling it directly.
+ * @param[in]  token - offset of the format string in the token section.
+ * @param[in]  argc  - number of 32-bit arguments that follow.
+ * @return     none.
+ */
+VOID B91LogTokenEmit(UINT32 token, UINT32 argc, ...);
+
+#endif /* _LOG_TOKEN_B91_H */
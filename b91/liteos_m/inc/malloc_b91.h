@@ -0,0 +1,65 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+#ifndef _MALLOC_B91_H
+#define _MALLOC_B91_H
+
+#include <los_compiler.h>
+
+#include <slab_b91.h>
+
+/*
+ * libc malloc, calloc, realloc and free, wrapped by the linker, so that mbedtls and everything else calling
+ * libc ends up here. With B91_SLAB blocks up to B91_SLAB_MAX_SIZE come from the size class allocator of
+ * slab_b91.h, whose pages are a static region of B91_SLAB_REGION_SIZE bytes; larger blocks, and small ones
+ * once the region is used up, come from the system heap. The slab is off by default: on the recorded ECDH
+ * trace it is no faster than the heap and leaves most of its pages unused, so it only pays where a trace of
+ * the application shows heap fragmentation from small blocks.
+ * realloc keeps a block where it is while it fits its size class or the heap can grow it, and moves it
+ * otherwise.
+ *
+ * With B91_MALLOC_TRACE every call is logged as "a <ptr> <size>" or "f <ptr>", a realloc as both, the input
+ * of util/b91_slab_bench.c.
+ * With B91_MEM_TELEMETRY every block gets an 8 byte header for the per task accounting of memstat_b91.h.
+ * free and realloc check it, and leave a block with a broken header alone rather than hand the heap a
+ * pointer it did not return.
+ */
+
+#ifndef B91_SLAB
+#define B91_SLAB 0
+#endif
+
+#ifndef B91_MALLOC_TRACE
+#define B91_MALLOC_TRACE 0
+#endif
+
+typedef struct {
+    B91SlabClassStats slab[B91_SLAB_CLASS_NUM];
+    UINT32 heapAllocs; /* blocks taken from the system heap directly, slab pages excluded */
+    UINT32 heapFrees;
+    UINT32 heapFails;
+} B91MallocStats;
+
+VOID B91MallocGetStats(B91MallocStats *stats);
+
+/**
+ * @brief      Prints the size class and heap statistics.
+ */
+VOID B91MallocDumpStats(VOID);
+
+#endif /* _MALLOC_B91_H */
@@ -0,0 +1,84 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+#ifndef _MEMSTAT_B91_H
+#define _MEMSTAT_B91_H
+
+#include <los_compiler.h>
+
+/*
+ * Memory telemetry, built with B91_MEM_TELEMETRY.
+ *
+ * A low priority task samples the system heap every B91_MEM_SAMPLE_MS: free bytes, largest free block and
+ * free block count, kept as low-water marks and as a short history of the last B91_MEM_HISTORY samples, so
+ * that fragmentation growing over days shows before an allocation fails. A warning is logged when the
+ * largest free block first drops below B91_MEM_WARN_LARGEST.
+ *
+ * malloc, calloc and realloc blocks carry a small header with their size and a tag, the ID of the task that
+ * allocated them, so that the bytes in use, the peak and the failures are known per task, which on this
+ * system is per module. A realloc keeps the tag of the block.
+ * The usage of the BLE stack myHeap is reported when it is linked in.
+ */
+
+#ifndef B91_MEM_TELEMETRY
+#define B91_MEM_TELEMETRY 0
+#endif
+
+#ifndef B91_MEM_SAMPLE_MS
+#define B91_MEM_SAMPLE_MS 10000
+#endif
+
+#ifndef B91_MEM_HISTORY
+#define B91_MEM_HISTORY 16
+#endif
+
+#ifndef B91_MEM_WARN_LARGEST
+#define B91_MEM_WARN_LARGEST 2048
+#endif
+
+#ifndef B91_MEM_TASK_PRIO
+#define B91_MEM_TASK_PRIO 24
+#endif
+
+/* The warning goes through printf when the log is not tokenized, which needs well over 1 KB of stack */
+#ifndef B91_MEM_TASK_STACKSIZE
+#define B91_MEM_TASK_STACKSIZE 2048
+#endif
+
+/**
+ * @brief      Starts the sampling task, does nothing without B91_MEM_TELEMETRY.
+ * @return     LOS_OK or error code of task creation.
+ */
+UINT32 B91MemTelemetryInit(VOID);
+
+/**
+ * @brief      Accounting hooks of the malloc wrappers, with B91_MEM_TELEMETRY only.
+ * @param[in]  size - bytes requested, without the block header.
+ */
+UINT32 B91MemTagCurrent(VOID);
+VOID B91MemTagAlloc(UINT32 tag, UINT32 size);
+VOID B91MemTagFree(UINT32 tag, UINT32 size);
+VOID B91MemTagFail(UINT32 tag);
+
+/**
+ * @brief      Takes a sample now and prints the heap state, its history, the per task totals and the free
+ *             block histogram of the kernel.
+ */
+VOID B91MemTelemetryDump(VOID);
+
+#endif /* _MEMSTAT_B91_H */
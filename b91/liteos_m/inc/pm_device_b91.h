@@ -0,0 +1,114 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+#ifndef _PM_DEVICE_B91_H
+#define _PM_DEVICE_B91_H
+
+#include <los_compiler.h>
+
+/*
+ * Drivers taking part in idle power management.
+ *
+ * A driver registers a B91PmDevice and reports when it has work in flight, either with the stimer tick it
+ * expects to be done at (e.g. the end of a DMA transfer) or as busy until further notice. While any device
+ * is busy only WFI is used; with a known end the core sleeps in WFI until that tick and the idle governor
+ * picks a mode again for the rest of the idle time.
+ *
+ * Before suspend or deep retention every prepare callback is called, in registration order, and may veto
+ * the mode; afterwards the resume callbacks are called in reverse order with the mode that was actually
+ * entered, B91_PM_MODE_WFI if the chip did not go to sleep. Both run with interrupts locked and must not
+ * block. Neither is called for WFI.
+ *
+ * The same pair is used around CPU and bus clock changes with B91_PM_CLOCK_CHANGE as the mode, resume then
+ * recomputes what depends on sys_clk (baud rate dividers, SPI clocks).
+ */
+
+#ifndef B91_PM_DEVICE_MAX
+#define B91_PM_DEVICE_MAX 8
+#endif
+
+/* Mode passed to prepare/resume around a clock change, next to B91_PM_MODE_* */
+#define B91_PM_CLOCK_CHANGE 0x100
+
+/* Returned by B91PmDevicesBusyFor() while a device is busy without a known end */
+#define B91_PM_BUSY_FOREVER U32_MAX
+
+typedef struct B91PmDevice B91PmDevice;
+
+struct B91PmDevice {
+    const CHAR *name;
+    VOID *priv;
+    /* Optional. Returns LOS_OK to allow mode (B91_PM_MODE_* or B91_PM_CLOCK_CHANGE), anything else vetoes it */
+    UINT32 (*prepare)(B91PmDevice *dev, UINT32 mode);
+    /* Optional. mode is the one entered, restore what it does not keep or adapt to the new clocks */
+    VOID (*resume)(B91PmDevice *dev, UINT32 mode);
+
+    /* Owned by the PM code */
+    UINT32 state;
+    UINT32 busyUntil;
+    UINT32 vetoes;
+};
+
+/**
+ * @brief      Adds a device to the idle power management. Registering a device twice has no effect.
+ * @return     LOS_OK, or LOS_NOK if B91_PM_DEVICE_MAX devices are already registered.
+ */
+UINT32 B91PmDeviceRegister(B91PmDevice *dev);
+
+VOID B91PmDeviceUnregister(B91PmDevice *dev);
+
+/**
+ * @brief      Marks the device busy until the given stimer tick, replacing the previous hint. Sleeping
+ *             deeper than WFI is allowed again once the tick has passed. Safe to call from an ISR.
+ */
+VOID B91PmDeviceBusyUntil(B91PmDevice *dev, UINT32 stimerTick);
+
+/**
+ * @brief      Marks the device busy until B91PmDeviceIdle() is called. Safe to call from an ISR.
+ */
+VOID B91PmDeviceBusy(B91PmDevice *dev);
+
+VOID B91PmDeviceIdle(B91PmDevice *dev);
+
+/**
+ * @brief      Tells how long registered devices stay busy. Called by the idle code.
+ * @param[in]  now - current stimer tick.
+ * @return     stimer ticks until the last busy device is done, 0 if none is busy, B91_PM_BUSY_FOREVER if
+ *             a device is busy without a known end.
+ */
+UINT32 B91PmDevicesBusyFor(UINT32 now);
+
+/**
+ * @brief      Calls the prepare callbacks before entering mode. Interrupts must be locked.
+ * @return     LOS_OK, or LOS_NOK if a device vetoed; the devices prepared so far have then been resumed
+ *             with B91_PM_MODE_WFI.
+ */
+UINT32 B91PmDevicesPrepare(UINT32 mode);
+
+/**
+ * @brief      Calls the resume callbacks after a successful B91PmDevicesPrepare(). Interrupts must be locked.
+ * @param[in]  mode - mode actually entered, B91_PM_MODE_WFI if the sleep was not entered.
+ */
+VOID B91PmDevicesResume(UINT32 mode);
+
+/**
+ * @brief      Prints the registered devices with their busy state and veto counts.
+ */
+VOID B91PmDevicesDump(VOID);
+
+#endif /* _PM_DEVICE_B91_H */
@@ -0,0 +1,105 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+#ifndef _PM_GOVERNOR_B91_H
+#define _PM_GOVERNOR_B91_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Idle state governor. Pure decision logic without hardware access, so that util/b91_pm_replay.c can run
+ * it on the host against recorded idle traces.
+ *
+ * Among the enabled and allowed modes the one with the lowest estimated charge over the predicted idle time
+ * is chosen, counting the active current paid during its measured wake-up cost. A mode is only considered
+ * if the prediction covers its static minimum residency and twice its wake-up cost. The prediction is the
+ * time to the next OS timer event scaled by how much of the expected idle time was actually spent asleep
+ * recently, since interrupts wake the system early.
+ */
+
+typedef enum {
+    B91_PM_MODE_WFI = 0,  /* core clock gated, everything else running */
+    B91_PM_MODE_SUSPEND,  /* suspend, SRAM and registers kept */
+    B91_PM_MODE_DEEP_RET, /* deep sleep with SRAM retention */
+    B91_PM_MODE_NUM,
+} B91PmMode;
+
+#define B91_PM_MODE_MASK(mode) (1U << (mode))
+#define B91_PM_MODE_MASK_ALL   ((1U << B91_PM_MODE_NUM) - 1)
+
+/* Typical supply currents used for the energy estimate, calibrate per board */
+#ifndef B91_PM_CURRENT_ACTIVE_UA
+#define B91_PM_CURRENT_ACTIVE_UA 3000
+#endif
+#ifndef B91_PM_CURRENT_WFI_UA
+#define B91_PM_CURRENT_WFI_UA 1500
+#endif
+#ifndef B91_PM_CURRENT_SUSPEND_UA
+#define B91_PM_CURRENT_SUSPEND_UA 40
+#endif
+#ifndef B91_PM_CURRENT_DEEP_RET_UA
+#define B91_PM_CURRENT_DEEP_RET_UA 3
+#endif
+
+/* Fixed point scale of the prediction accuracy */
+#define B91_PM_ACCURACY_ONE 1024
+
+typedef struct {
+    bool enabled;
+    uint32_t minResidencyUs; /* static floor of the target residency */
+    uint32_t exitLatencyUs;  /* wake-up cost, running average of the measured values */
+    uint32_t currentUa;      /* supply current while in the mode */
+} B91PmModeParam;
+
+typedef struct {
+    uint32_t entries;      /* times the mode was entered */
+    uint32_t earlyWakeups; /* entries that ended before half of the expected idle time */
+    uint64_t residencyUs;  /* time spent in the mode */
+    uint64_t chargeUaUs;   /* estimated charge in uA*us including wake-up cost, times supply voltage is energy */
+} B91PmModeStats;
+
+typedef struct {
+    B91PmModeParam param[B91_PM_MODE_NUM];
+    B91PmModeStats stats[B91_PM_MODE_NUM];
+    uint32_t accuracy; /* running average of actual / expected idle time, B91_PM_ACCURACY_ONE is exact */
+} B91PmGovernor;
+
+/**
+ * @brief      Sets the default mode parameters, deep retention starts disabled. Clears the statistics.
+ */
+void B91PmGovernorInit(B91PmGovernor *gov);
+
+/**
+ * @brief      Picks the idle mode.
+ * @param[in]  idleUs  - time to the next OS timer event.
+ * @param[in]  allowed - B91_PM_MODE_MASK() of the modes currently allowed, WFI is always allowed.
+ * @return     the mode to enter.
+ */
+B91PmMode B91PmGovernorSelect(const B91PmGovernor *gov, uint32_t idleUs, uint32_t allowed);
+
+/**
+ * @brief      Accounts one idle period and updates the predictor.
+ * @param[in]  expectedUs    - idle time passed to B91PmGovernorSelect().
+ * @param[in]  actualUs      - time actually spent in the mode.
+ * @param[in]  exitLatencyUs - measured wake-up cost, 0 if not measured.
+ */
+void B91PmGovernorUpdate(B91PmGovernor *gov, B91PmMode mode, uint32_t expectedUs, uint32_t actualUs,
+                         uint32_t exitLatencyUs);
+
+#endif /* _PM_GOVERNOR_B91_H */
@@ -21,6 +21,23 @@
 
 #include <los_compiler.h>
 
+#include <pm_governor_b91.h>
+
+/* Log every idle period the governor decides as "<expected_us> <actual_us>", the input of util/b91_pm_replay.c */
+#ifndef B91_PM_TRACE
+#define B91_PM_TRACE 0
+#endif
+
 VOID B91SuspendSleepInit(VOID);
 
+/**
+ * @brief      Copies the idle governor state: per-mode parameters, residency and energy counters.
+ */
+VOID B91PmGetGovernor(B91PmGovernor *gov);
+
+/**
+ * @brief      Prints per-mode entries, early wake-ups, residency, estimated charge and wake-up cost.
+ */
+VOID B91PmDumpStats(VOID);
+
 #endif /* _POWER_B91_H */
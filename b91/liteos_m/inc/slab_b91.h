@@ -0,0 +1,116 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+#ifndef _SLAB_B91_H
+#define _SLAB_B91_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Size class allocator for small blocks. Pure logic without OS calls, so that util/b91_slab_bench.c can run
+ * it on the host against recorded allocation traces; the pages come from callbacks and the caller locks.
+ *
+ * Requests up to B91_SLAB_MAX_SIZE are rounded up to a size class and served from pages of
+ * B91_SLAB_PAGE_SIZE bytes, aligned to their size, each holding objects of one class behind a small header.
+ * A page keeps its own free list and the pages of a class with free objects are linked, so that allocation
+ * and free are a few pointer operations. A page that becomes empty is given back unless it is the only page
+ * with free objects of its class, which keeps alternating alloc/free at a page boundary from paging.
+ *
+ * Whether a pointer belongs to a slab page is looked up in a map with one entry per page of the region the
+ * pages are carved from, so free never reads memory it does not own.
+ */
+
+#ifndef B91_SLAB_PAGE_SIZE
+#define B91_SLAB_PAGE_SIZE 1024
+#endif
+
+/* Largest region the page map covers, B91_SLAB_PAGE_SIZE * B91_SLAB_MAP_MAX bytes */
+#ifndef B91_SLAB_MAP_MAX
+#define B91_SLAB_MAP_MAX 64
+#endif
+
+/* Static region malloc_b91.c takes the pages from, the peak of an ECDH exchange */
+#ifndef B91_SLAB_REGION_SIZE
+#define B91_SLAB_REGION_SIZE (8 * B91_SLAB_PAGE_SIZE)
+#endif
+
+#if B91_SLAB_REGION_SIZE > B91_SLAB_PAGE_SIZE * B91_SLAB_MAP_MAX
+#error "B91_SLAB_REGION_SIZE is beyond the page map"
+#endif
+
+#define B91_SLAB_CLASS_NUM 9
+#define B91_SLAB_MAX_SIZE  256
+
+typedef struct B91SlabPage B91SlabPage;
+
+typedef struct {
+    uint32_t size;      /* object size */
+    uint32_t allocs;    /* objects handed out */
+    uint32_t frees;     /* objects given back */
+    uint32_t noPage;    /* allocations failed for want of a page */
+    uint32_t inUse;     /* objects in use now */
+    uint32_t peakInUse; /* most objects in use at once */
+    uint32_t pages;     /* pages held now */
+    uint32_t peakPages; /* most pages held at once */
+    uint64_t requested; /* sum of the requested sizes, against allocs * size it gives the rounding waste */
+} B91SlabClassStats;
+
+typedef void *(*B91SlabPageAlloc)(void *ctx);
+typedef void (*B91SlabPageFree)(void *ctx, void *page);
+
+typedef struct {
+    B91SlabPageAlloc pageAlloc; /* returns B91_SLAB_PAGE_SIZE bytes aligned to B91_SLAB_PAGE_SIZE, or NULL */
+    B91SlabPageFree pageFree;
+    void *ctx;
+
+    uintptr_t base;                    /* region the pages come from, aligned to B91_SLAB_PAGE_SIZE */
+    uint32_t pageNum;                  /* pages in the region */
+    uint8_t pageMap[B91_SLAB_MAP_MAX]; /* per page of the region: 0 if not a slab page, else class + 1 */
+
+    B91SlabPage *partial[B91_SLAB_CLASS_NUM]; /* pages with free objects */
+    B91SlabClassStats stats[B91_SLAB_CLASS_NUM];
+} B91Slab;
+
+/**
+ * @brief      Sets up an empty allocator.
+ * @param[in]  base - start of the region pageAlloc carves pages from, rounded down to a page here.
+ * @param[in]  size - size of the region, the part beyond B91_SLAB_MAP_MAX pages is not used for slabs.
+ */
+void B91SlabInit(B91Slab *slab, uintptr_t base, uint32_t size, B91SlabPageAlloc pageAlloc,
+                 B91SlabPageFree pageFree, void *ctx);
+
+/**
+ * @brief      Allocates an object of the smallest class holding size bytes, 8 byte aligned.
+ * @return     the object, or NULL if size is 0 or above B91_SLAB_MAX_SIZE, or no page could be had.
+ */
+void *B91SlabAlloc(B91Slab *slab, uint32_t size);
+
+/**
+ * @brief      Frees an object if it comes from a slab page.
+ * @return     true if it did, false if ptr is not a slab object and must be freed elsewhere.
+ */
+bool B91SlabFree(B91Slab *slab, void *ptr);
+
+/**
+ * @brief      Usable size of a slab object.
+ * @return     the class size, 0 if ptr is not a slab object.
+ */
+uint32_t B91SlabObjectSize(const B91Slab *slab, const void *ptr);
+
+#endif /* _SLAB_B91_H */
@@ -21,8 +21,11 @@
 #include <nds_intrinsic.h>
 #include <stdint.h>
 
+#include <B91/stimer.h>
 #include <B91/sys.h>
 
+#include <boot_b91.h>
+
 #define MCACHE_CTL_ICACHE 1
 #define MCACHE_CTL_DCACHE 2
 
@@ -48,33 +51,87 @@ extern InitFunc __fini_array_end[] __attribute__((weak));
 
 #define STACK_MAGIC UINT32_C(0xDEADBEEF)
 
-STATIC VOID BoardConfigInnerSafe(VOID);
+/* Paint the interrupt stack so that its depth can be read with a debugger, costs a pass over it at boot */
+#ifndef B91_STACK_PAINT
+#ifdef LOSCFG_COMPILE_DEBUG
+#define B91_STACK_PAINT 1
+#else
+#define B91_STACK_PAINT 0
+#endif
+#endif
+
+/* Words moved per unrolled step of the startup copy */
+#define COPY_BLOCK_WORDS 8
+
+STATIC VOID BoardConfigInnerSafe(UINT32 startTick);
 
 #ifdef __GNUC__
 #pragma GCC push_options
 #pragma GCC optimize("-fno-stack-protector")
 #endif /* __GNUC__ */
 
+/*
+ * The sources are read through the flash cache, a block of loads ahead of the stores lets each cache line
+ * fill serve eight words instead of stalling the store after every load.
+ */
 __attribute__((noinline)) STATIC VOID CopyBuf32(UINT32 *dst, const UINT32 *dstEnd, const UINT32 *src)
 {
+    while ((dstEnd - dst) >= COPY_BLOCK_WORDS) {
+        UINT32 w0 = src[0];
+        UINT32 w1 = src[1];
+        UINT32 w2 = src[2];
+        UINT32 w3 = src[3];
+        UINT32 w4 = src[4];
+        UINT32 w5 = src[5];
+        UINT32 w6 = src[6];
+        UINT32 w7 = src[7];
+        dst[0] = w0;
+        dst[1] = w1;
+        dst[2] = w2;
+        dst[3] = w3;
+        dst[4] = w4;
+        dst[5] = w5;
+        dst[6] = w6;
+        dst[7] = w7;
+        dst += COPY_BLOCK_WORDS;
+        src += COPY_BLOCK_WORDS;
+    }
     while (dst < dstEnd) {
         *dst++ = *src++;
     }
 }
 
+__attribute__((noinline)) STATIC VOID FillBuf32(UINT32 *dst, const UINT32 *dstEnd, UINT32 value)
+{
+    while ((dstEnd - dst) >= COPY_BLOCK_WORDS) {
+        dst[0] = value;
+        dst[1] = value;
+        dst[2] = value;
+        dst[3] = value;
+        dst[4] = value;
+        dst[5] = value;
+        dst[6] = value;
+        dst[7] = value;
+        dst += COPY_BLOCK_WORDS;
+    }
+    while (dst < dstEnd) {
+        *dst++ = value;
+    }
+}
+
 #define COPY_SEGMENT(_SEGNAME_) CopyBuf32((_SEGNAME_##_VMA_START), (_SEGNAME_##_VMA_END), (_SEGNAME_##_LMA_START))
 
 __attribute__((used)) static void BoardConfigInner(void)
 {
-    for (UINT32 *p = SEG_BSS_VMA_START; p < SEG_BSS_VMA_END; ++p) {
-        *p = 0;
-    }
+    UINT32 startTick = stimer_get_tick();
+
+    FillBuf32(SEG_BSS_VMA_START, SEG_BSS_VMA_END, 0);
 
     COPY_SEGMENT(SEG_RETENTION_DATA);
     COPY_SEGMENT(SEG_RAMCODE);
     COPY_SEGMENT(SEG_DATA);
 
-    BoardConfigInnerSafe();
+    BoardConfigInnerSafe(startTick);
 }
 
 /*
@@ -96,9 +153,11 @@ __attribute__((naked)) void BoardConfig(void)
     __builtin_riscv_csrw(mcacheCtl, NDS_MCACHE_CTL);
     __asm__ volatile("fence.i");
 
+#if B91_STACK_PAINT
     for (UINT32 *p = __int_stack_start; p < __int_stack_end; ++p) {
         *p = STACK_MAGIC;
     }
+#endif
 
     __asm__ volatile("j BoardConfigInner");
 }
@@ -109,9 +168,13 @@ __attribute__((naked)) void BoardConfig(void)
 
 /**
  * @brief BoardConfigInnerSafe is safe part of BoardConfig without disabled stack protection
+ * @param startTick stimer when the segments started to be set up, stamped now that .bss can be written
  */
-STATIC VOID BoardConfigInnerSafe(VOID)
+STATIC VOID BoardConfigInnerSafe(UINT32 startTick)
 {
+    B91BootMarkAt("startup", startTick);
+    B91BootMark("segments");
+
     for (InitFunc *f = __preinit_array_start; f < __preinit_array_end; ++f) {
         (*f)();
     }
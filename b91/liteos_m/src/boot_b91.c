@@ -0,0 +1,178 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+
+#include <los_event.h>
+#include <los_interrupt.h>
+#include <los_task.h>
+#ifdef LOSCFG_SHELL
+#include <shcmd.h>
+#endif
+
+#include <B91/stimer.h>
+
+#include <stack/ble/ble.h>
+
+#include <boot_b91.h>
+
+#define B91_LATE_INIT_TASK_STACKSIZE (1024 * 8)
+#define B91_LATE_INIT_TASK_PRIO      8
+#define B91_LATE_INIT_TASK_NAME      "B91LateInit"
+
+#define BOOT_EVENT_LATE_INIT_DONE 0x1
+
+typedef struct {
+    const CHAR *name;
+    UINT32 tick;
+} BootMark;
+
+STATIC BootMark g_bootMarks[B91_BOOT_MARK_MAX];
+STATIC UINT32 g_bootMarkNum;
+STATIC UINT32 g_bootMarksDropped;
+
+STATIC EVENT_CB_S g_bootEvent;
+STATIC BOOL g_bootLateInitStarted;
+STATIC UINT32 g_bootLateInitTaskId;
+STATIC BOOL g_bootAdvMarked;
+STATIC VOID (*g_bootLateInitFunc)(VOID);
+
+VOID B91BootMarkAt(const CHAR *name, UINT32 tick)
+{
+    UINT32 intSave = LOS_IntLock();
+    if (g_bootMarkNum < B91_BOOT_MARK_MAX) {
+        g_bootMarks[g_bootMarkNum].name = name;
+        g_bootMarks[g_bootMarkNum].tick = tick;
+        g_bootMarkNum++;
+    } else {
+        g_bootMarksDropped++;
+    }
+    LOS_IntRestore(intSave);
+}
+
+VOID B91BootMark(const CHAR *name)
+{
+    B91BootMarkAt(name, stimer_get_tick());
+}
+
+/* The application enables advertising through the stack, liteos_m/BUILD.gn wraps the calls to mark it */
+STATIC VOID B91BootMarkAdv(adv_en_t enable, ble_sts_t ret)
+{
+    if ((enable == BLC_ADV_ENABLE) && (ret == BLE_SUCCESS) && !g_bootAdvMarked) {
+        g_bootAdvMarked = TRUE;
+        B91BootMark("adv");
+    }
+}
+
+ble_sts_t __real_blc_ll_setAdvEnable(adv_en_t adv_enable);
+ble_sts_t __real_blc_ll_setExtAdvEnable(adv_en_t enable, u8 adv_handle, u16 duration, u8 max_extAdvEvt);
+
+ble_sts_t __wrap_blc_ll_setAdvEnable(adv_en_t adv_enable)
+{
+    ble_sts_t ret = __real_blc_ll_setAdvEnable(adv_enable);
+    B91BootMarkAdv(adv_enable, ret);
+    return ret;
+}
+
+ble_sts_t __wrap_blc_ll_setExtAdvEnable(adv_en_t enable, u8 adv_handle, u16 duration, u8 max_extAdvEvt)
+{
+    ble_sts_t ret = __real_blc_ll_setExtAdvEnable(enable, adv_handle, duration, max_extAdvEvt);
+    B91BootMarkAdv(enable, ret);
+    return ret;
+}
+
+VOID B91BootDump(VOID)
+{
+    UINT32 intSave = LOS_IntLock();
+    UINT32 num = g_bootMarkNum;
+    UINT32 dropped = g_bootMarksDropped;
+    LOS_IntRestore(intSave);
+
+    printf("boot stage             at(us)     +(us)\r\n");
+    UINT32 prev = 0;
+    for (UINT32 i = 0; i < num; i++) {
+        UINT32 tick = g_bootMarks[i].tick;
+        printf("%-16s %12u %9u\r\n", g_bootMarks[i].name, tick / SYSTEM_TIMER_TICK_1US,
+               (tick - prev) / SYSTEM_TIMER_TICK_1US);
+        prev = tick;
+    }
+    if (dropped != 0) {
+        printf("%u marks dropped, raise B91_BOOT_MARK_MAX\r\n", dropped);
+    }
+}
+
+STATIC VOID B91BootLateInitTask(VOID)
+{
+    if (g_bootLateInitFunc != NULL) {
+        g_bootLateInitFunc();
+    }
+    B91BootMark("late-init");
+    (VOID)LOS_EventWrite(&g_bootEvent, BOOT_EVENT_LATE_INIT_DONE);
+
+#if B91_BOOT_PROFILE
+    B91BootDump();
+#endif
+}
+
+#ifdef LOSCFG_SHELL
+STATIC UINT32 BootProfileShellCmd(UINT32 argc, const CHAR **argv)
+{
+    (VOID)argc;
+    (VOID)argv;
+
+    B91BootDump();
+    return LOS_OK;
+}
+#endif /* LOSCFG_SHELL */
+
+UINT32 B91BootLateInit(VOID (*func)(VOID))
+{
+    UINT32 ret = LOS_EventInit(&g_bootEvent);
+    if (ret != LOS_OK) {
+        return ret;
+    }
+
+#ifdef LOSCFG_SHELL
+    (VOID)osCmdReg(CMD_TYPE_EX, "bootprof", XARGS, (CmdCallBackFunc)BootProfileShellCmd);
+#endif
+
+    TSK_INIT_PARAM_S task = {0};
+
+    g_bootLateInitFunc = func;
+    task.pfnTaskEntry = (TSK_ENTRY_FUNC)B91BootLateInitTask;
+    task.uwStackSize = B91_LATE_INIT_TASK_STACKSIZE;
+    task.pcName = B91_LATE_INIT_TASK_NAME;
+    task.usTaskPrio = B91_LATE_INIT_TASK_PRIO;
+    ret = LOS_TaskCreate(&g_bootLateInitTaskId, &task);
+    if (ret == LOS_OK) {
+        g_bootLateInitStarted = TRUE;
+    }
+    return ret;
+}
+
+UINT32 B91BootWaitLateInit(UINT32 timeout)
+{
+    /* The late init function itself may reach the callers, e.g. a driver opening a file */
+    if (!g_bootLateInitStarted || (LOS_CurTaskIDGet() == g_bootLateInitTaskId)) {
+        return LOS_OK;
+    }
+
+    /* The event is not cleared, every waiter sees it */
+    UINT32 ret = LOS_EventRead(&g_bootEvent, BOOT_EVENT_LATE_INIT_DONE, LOS_WAITMODE_OR, timeout);
+    return (ret & BOOT_EVENT_LATE_INIT_DONE) ? LOS_OK : LOS_NOK;
+}
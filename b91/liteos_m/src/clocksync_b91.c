@@ -0,0 +1,91 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+#include <string.h>
+
+#include <clocksync_b91.h>
+
+#define CS_EWMA_SHIFT 3
+#define CS_Q16_SHIFT  16
+
+static inline uint32_t CsEwma(uint32_t avg, uint32_t sample)
+{
+    return (uint32_t)((int32_t)avg + (((int32_t)sample - (int32_t)avg) >> CS_EWMA_SHIFT));
+}
+
+void B91ClockSyncInit(B91ClockSync *cs, uint32_t mtimeHz, uint32_t stimerHz)
+{
+    (void)memset(cs, 0, sizeof(*cs));
+    cs->mtimeHz = mtimeHz;
+    cs->stimerHz = stimerHz;
+}
+
+uint32_t B91ClockSyncToMticks(B91ClockSync *cs, uint32_t stimerTicks)
+{
+    uint64_t scaled = (uint64_t)stimerTicks * cs->mtimeHz + cs->remainder;
+
+    cs->remainder = (uint32_t)(scaled % cs->stimerHz);
+    return (uint32_t)(scaled / cs->stimerHz);
+}
+
+void B91ClockSyncActive(B91ClockSync *cs, uint32_t stimerTicks, uint32_t rcTicks)
+{
+    /* Both sums have to stay below 2^32 stimer ticks (268 s) */
+    if ((stimerTicks > UINT32_MAX - cs->calStimer) || (rcTicks == 0)) {
+        B91ClockSyncRestartCalibration(cs);
+        return;
+    }
+
+    cs->calStimer += stimerTicks;
+    cs->cal32k += rcTicks;
+    if (cs->cal32k < B91_CLOCK_SYNC_CAL_WINDOW) {
+        return;
+    }
+
+    uint32_t ratio = (uint32_t)(((uint64_t)cs->calStimer << CS_Q16_SHIFT) / cs->cal32k);
+    cs->stimerPer32kQ16 = (cs->stimerPer32kQ16 == 0) ? ratio : CsEwma(cs->stimerPer32kQ16, ratio);
+    cs->calibrations++;
+    cs->calStimer = 0;
+    cs->cal32k = 0;
+}
+
+void B91ClockSyncRestartCalibration(B91ClockSync *cs)
+{
+    cs->calStimer = 0;
+    cs->cal32k = 0;
+}
+
+uint32_t B91ClockSyncSleepSpan(B91ClockSync *cs, uint32_t stimerTicks, uint32_t rcTicks)
+{
+    uint32_t span = stimerTicks;
+
+    if (cs->stimerPer32kQ16 != 0) {
+        span = (uint32_t)(((uint64_t)rcTicks * cs->stimerPer32kQ16) >> CS_Q16_SHIFT);
+        cs->rcMinusStimer += (int64_t)span - (int64_t)stimerTicks;
+    }
+
+    span += cs->correction;
+    cs->resyncs++;
+    cs->sleptStimer += span;
+    return span;
+}
+
+void B91ClockSyncTuneCorrection(B91ClockSync *cs, uint32_t overheadTicks)
+{
+    cs->correction = (cs->resyncs <= 1) ? overheadTicks : CsEwma(cs->correction, overheadTicks);
+}
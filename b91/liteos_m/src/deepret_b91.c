@@ -0,0 +1,228 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include <los_compiler.h>
+
+#include <B91/plic.h>
+#include <B91/pm.h>
+
+#include <B91/ext_driver/ext_pm.h>
+
+#include <deepret_b91.h>
+#include <system_b91.h>
+
+#define DEEP_RET_MAGIC      0x44524554 /* "DRET" */
+#define DEEP_RET_CTX_WORDS  (22 + 12)
+#define DEEP_RET_STACK_SIZE 256 /* also in reset_vector.S */
+#define PLIC_SRC_NUM        64
+
+/* Everything below lives in the retention window and is not touched by BoardConfig */
+#define RETENTION_BSS __attribute__((section(".retention_bss"), aligned(8)))
+
+UINT8 g_b91DeepRetStack[DEEP_RET_STACK_SIZE] RETENTION_BSS;
+
+STATIC UINT32 g_deepRetMagic[2] RETENTION_BSS;
+
+#if B91_PM_DEEP_RET
+#define DEEP_RET_STR(x)  #x
+#define DEEP_RET_XSTR(x) DEEP_RET_STR(x)
+
+/* Tells liteos.ld to size .deepret_save and to keep the LOS heap inside the window */
+__asm__(".globl __deepret_window_end\n"
+        ".set __deepret_window_end, " DEEP_RET_XSTR(B91_PM_DEEP_RET_WINDOW) "\n"
+        ".globl __deepret_sbrk_save\n"
+        ".set __deepret_sbrk_save, " DEEP_RET_XSTR(B91_PM_DEEP_RET_SBRK_SAVE));
+
+extern UINT32 SEG_DATA_VMA_START[], _end[];
+extern UINT32 SEG_RAMCODE_VMA_END[], __retention_bss_end[];
+extern UINT32 __deepret_save_start[], __deepret_save_end[];
+extern UINT8 __los_heap_addr_end__[];
+extern VOID *_sbrk(ptrdiff_t incr);
+
+UINT32 B91DeepRetSave(UINT32 *ctx) __attribute__((returns_twice));
+VOID B91DeepRetRestore(const UINT32 *ctx) __attribute__((noreturn));
+
+STATIC UINT32 g_deepRetCtx[DEEP_RET_CTX_WORDS] RETENTION_BSS;
+
+typedef struct {
+    UINT32 *start;
+    UINT32 *end;
+} DeepRetRegion;
+
+STATIC DeepRetRegion g_deepRetRegions[2] RETENTION_BSS;
+
+STATIC struct {
+    UINT32 src[2];
+    UINT32 prio[PLIC_SRC_NUM];
+    UINT32 threshold;
+    UINT32 feature;
+} g_deepRetPlic;
+
+STATIC BOOL g_deepRetAvailable = FALSE;
+STATIC BOOL g_deepRetChecked = FALSE;
+
+BOOL B91DeepRetAvailable(VOID)
+{
+    if (g_deepRetChecked) {
+        return g_deepRetAvailable;
+    }
+
+    /* liteos.ld already refuses a layout whose save area and heap do not fit, this only reports it */
+    BOOL windowFits = ((UINTPTR)SEG_RAMCODE_VMA_END <= B91_PM_DEEP_RET_WINDOW) &&
+                      ((UINTPTR)__retention_bss_end <= B91_PM_DEEP_RET_WINDOW) &&
+                      ((UINTPTR)__los_heap_addr_end__ < B91_PM_DEEP_RET_WINDOW);
+    g_deepRetAvailable = windowFits && ((UINTPTR)__deepret_save_end > (UINTPTR)__deepret_save_start);
+    g_deepRetChecked = TRUE;
+
+    if (!g_deepRetAvailable) {
+        printf("deep retention disabled: RAM layout does not keep the heap in the %u byte window\r\n",
+               (UINT32)B91_PM_DEEP_RET_WINDOW);
+    }
+    return g_deepRetAvailable;
+}
+
+/* .data, .bss, .noinit and the interrupt stacks in DLM, then the sbrk heap up to its break */
+STATIC BOOL DeepRetRegionsInit(VOID)
+{
+    UINT32 *brk = (UINT32 *)(((UINTPTR)_sbrk(0) + sizeof(UINT32) - 1) & ~(UINTPTR)(sizeof(UINT32) - 1));
+
+    g_deepRetRegions[0].start = SEG_DATA_VMA_START;
+    g_deepRetRegions[0].end = _end;
+    g_deepRetRegions[1].start = _end;
+    g_deepRetRegions[1].end = (brk > _end) ? brk : _end;
+
+    UINT32 words = 0;
+    for (UINT32 i = 0; i < sizeof(g_deepRetRegions) / sizeof(g_deepRetRegions[0]); i++) {
+        words += g_deepRetRegions[i].end - g_deepRetRegions[i].start;
+    }
+    return words <= (UINT32)(__deepret_save_end - __deepret_save_start);
+}
+
+STATIC VOID DeepRetCopyOut(VOID)
+{
+    UINT32 *dst = __deepret_save_start;
+    for (UINT32 i = 0; i < sizeof(g_deepRetRegions) / sizeof(g_deepRetRegions[0]); i++) {
+        for (UINT32 *src = g_deepRetRegions[i].start; src < g_deepRetRegions[i].end; src++) {
+            *dst++ = *src;
+        }
+    }
+}
+
+STATIC VOID DeepRetPlicSave(VOID)
+{
+    g_deepRetPlic.src[0] = reg_irq_src0;
+    g_deepRetPlic.src[1] = reg_irq_src1;
+    for (UINT32 i = 1; i < PLIC_SRC_NUM; i++) {
+        g_deepRetPlic.prio[i] = reg_irq_src_priority(i);
+    }
+    g_deepRetPlic.threshold = reg_irq_threshold;
+    g_deepRetPlic.feature = reg_irq_feature;
+}
+
+STATIC VOID DeepRetPlicRestore(VOID)
+{
+    reg_irq_feature = g_deepRetPlic.feature;
+    reg_irq_threshold = g_deepRetPlic.threshold;
+    for (UINT32 i = 1; i < PLIC_SRC_NUM; i++) {
+        reg_irq_src_priority(i) = g_deepRetPlic.prio[i];
+    }
+    reg_irq_src0 = g_deepRetPlic.src[0];
+    reg_irq_src1 = g_deepRetPlic.src[1];
+}
+
+BOOL B91DeepRetSleep(UINT32 wakeTick)
+{
+    if (!B91DeepRetAvailable()) {
+        return FALSE;
+    }
+    if (!DeepRetRegionsInit()) {
+        /* The sbrk heap grew beyond B91_PM_DEEP_RET_SBRK_SAVE, stay in suspend */
+        return FALSE;
+    }
+
+    DeepRetPlicSave();
+
+    if (B91DeepRetSave(g_deepRetCtx) == 0) {
+        /* Copied after the context so that the stack seen on resume is the one at this point */
+        DeepRetCopyOut();
+        g_deepRetMagic[0] = DEEP_RET_MAGIC;
+        g_deepRetMagic[1] = ~DEEP_RET_MAGIC;
+
+        cpu_sleep_wakeup_32k_rc(B91_PM_DEEP_RET_MODE, PM_WAKEUP_TIMER | PM_WAKEUP_PAD, wakeTick);
+
+        /* Only returns if the sleep was not entered, e.g. a wake-up pad was already active */
+        g_deepRetMagic[0] = 0;
+        return FALSE;
+    }
+
+    /* Back from B91DeepRetResume(): RAM and CPU context are as they were, the hardware is not */
+    SystemInit();
+    DeepRetPlicRestore();
+
+    return TRUE;
+}
+
+/*
+ * Runs before BoardConfig on the retained stack: .data and .bss are not valid yet, so only the retention
+ * variables may be used. The magic is checked first, analog_read_reg8() is ram_code and is only valid
+ * after a retention wake-up.
+ */
+VOID B91DeepRetResume(VOID)
+{
+    if ((g_deepRetMagic[0] != DEEP_RET_MAGIC) || (g_deepRetMagic[1] != ~DEEP_RET_MAGIC)) {
+        return;
+    }
+    g_deepRetMagic[0] = 0;
+
+    if (!pm_get_deep_retention_flag()) {
+        return;
+    }
+
+    const UINT32 *src = __deepret_save_start;
+    for (UINT32 i = 0; i < sizeof(g_deepRetRegions) / sizeof(g_deepRetRegions[0]); i++) {
+        for (UINT32 *dst = g_deepRetRegions[i].start; dst < g_deepRetRegions[i].end; dst++) {
+            *dst = *src++;
+        }
+    }
+
+    B91DeepRetRestore(g_deepRetCtx);
+}
+
+#else /* B91_PM_DEEP_RET */
+
+BOOL B91DeepRetAvailable(VOID)
+{
+    return FALSE;
+}
+
+BOOL B91DeepRetSleep(UINT32 wakeTick)
+{
+    (VOID)wakeTick;
+    return FALSE;
+}
+
+VOID B91DeepRetResume(VOID)
+{
+    /* Nothing is saved when the feature is off, clear a magic left by an image that had it on */
+    g_deepRetMagic[0] = 0;
+}
+
+#endif /* B91_PM_DEEP_RET */
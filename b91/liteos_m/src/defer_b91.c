@@ -0,0 +1,178 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+#include <los_event.h>
+#include <los_interrupt.h>
+#include <los_task.h>
+
+#include <compiler.h>
+
+#include <defer_b91.h>
+
+/*
+ * Bounded multi-producer single-consumer queue, one per priority.
+ *
+ * Each slot carries a sequence number relative to the start of the lap its position belongs to, so a
+ * zeroed queue is empty and items can be posted before B91DeferInit(). A free slot for position pos holds
+ * seq == DEFER_LAP(pos); a producer claims it by advancing head with a CAS, fills it and publishes it with
+ * seq = DEFER_LAP(pos) + 1. The work task consumes the slot at tail once it is published and hands it to
+ * the next lap with seq = DEFER_LAP(tail) + B91_DEFER_QUEUE_LEN. A producer preempted between claim and
+ * publish only delays the items behind it, nothing is lost.
+ */
+
+#define DEFER_QUEUE_MASK (B91_DEFER_QUEUE_LEN - 1)
+#define DEFER_LAP(pos)   ((pos) & ~DEFER_QUEUE_MASK)
+#define DEFER_EVENT_WORK 0x1U
+
+#if (B91_DEFER_QUEUE_LEN & DEFER_QUEUE_MASK) != 0
+#error B91_DEFER_QUEUE_LEN must be a power of two
+#endif
+
+typedef struct {
+    UINT32 seq;
+    B91DeferFunc func;
+    VOID *arg;
+    UINT32 data;
+} DeferSlot;
+
+typedef struct {
+    UINT32 head;
+    UINT32 tail;
+    DeferSlot slots[B91_DEFER_QUEUE_LEN];
+} DeferQueue;
+
+STATIC DeferQueue g_deferQueue[B91_DEFER_PRIO_NUM];
+STATIC B91DeferStats g_deferStats;
+STATIC EVENT_CB_S g_deferEvent;
+STATIC BOOL g_deferTaskReady = FALSE;
+
+_attribute_ram_code_ UINT32 B91DeferPost(UINT32 prio, B91DeferFunc func, VOID *arg, UINT32 data)
+{
+    if ((prio >= B91_DEFER_PRIO_NUM) || (func == NULL)) {
+        return LOS_NOK;
+    }
+
+    DeferQueue *queue = &g_deferQueue[prio];
+    UINT32 pos = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+    DeferSlot *slot;
+
+    for (;;) {
+        slot = &queue->slots[pos & DEFER_QUEUE_MASK];
+        INT32 diff = (INT32)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - DEFER_LAP(pos));
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&queue->head, &pos, pos + 1, TRUE, __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            __atomic_fetch_add(&g_deferStats.dropped[prio], 1, __ATOMIC_RELAXED);
+            return LOS_NOK;
+        } else {
+            pos = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    slot->func = func;
+    slot->arg = arg;
+    slot->data = data;
+    __atomic_store_n(&slot->seq, DEFER_LAP(pos) + 1, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&g_deferStats.posted[prio], 1, __ATOMIC_RELAXED);
+
+    if (g_deferTaskReady) {
+        (VOID)LOS_EventWrite(&g_deferEvent, DEFER_EVENT_WORK);
+    }
+
+    return LOS_OK;
+}
+
+/**
+ * @brief      Runs the oldest item of the queue, called from the work task only.
+ * @return     TRUE if an item was run, FALSE if the queue was empty.
+ */
+STATIC BOOL DeferRunOne(UINT32 prio)
+{
+    DeferQueue *queue = &g_deferQueue[prio];
+    UINT32 pos = queue->tail;
+    DeferSlot *slot = &queue->slots[pos & DEFER_QUEUE_MASK];
+
+    if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != DEFER_LAP(pos) + 1) {
+        return FALSE;
+    }
+
+    UINT32 depth = __atomic_load_n(&queue->head, __ATOMIC_RELAXED) - pos;
+    if (depth > g_deferStats.maxDepth[prio]) {
+        g_deferStats.maxDepth[prio] = depth;
+    }
+
+    B91DeferFunc func = slot->func;
+    VOID *arg = slot->arg;
+    UINT32 data = slot->data;
+
+    __atomic_store_n(&slot->seq, DEFER_LAP(pos) + B91_DEFER_QUEUE_LEN, __ATOMIC_RELEASE);
+    queue->tail = pos + 1;
+
+    func(arg, data);
+    return TRUE;
+}
+
+STATIC VOID DeferTask(VOID)
+{
+    for (;;) {
+        /* Re-check the high priority queue before every low priority item */
+        while (DeferRunOne(B91_DEFER_PRIO_HIGH) || DeferRunOne(B91_DEFER_PRIO_LOW)) {
+        }
+
+        (VOID)LOS_EventRead(&g_deferEvent, DEFER_EVENT_WORK, LOS_WAITMODE_OR | LOS_WAITMODE_CLR,
+                            LOS_WAIT_FOREVER);
+    }
+}
+
+VOID B91DeferGetStats(B91DeferStats *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+
+    UINT32 intSave = LOS_IntLock();
+    *stats = g_deferStats;
+    LOS_IntRestore(intSave);
+}
+
+UINT32 B91DeferInit(VOID)
+{
+    UINT32 ret = LOS_EventInit(&g_deferEvent);
+    if (ret != LOS_OK) {
+        return ret;
+    }
+
+    UINT32 taskId;
+    TSK_INIT_PARAM_S task = {0};
+    task.pfnTaskEntry = (TSK_ENTRY_FUNC)DeferTask;
+    task.uwStackSize = B91_DEFER_TASK_STACKSIZE;
+    task.pcName = "B91Defer";
+    task.usTaskPrio = B91_DEFER_TASK_PRIO;
+    ret = LOS_TaskCreate(&taskId, &task);
+    if (ret != LOS_OK) {
+        return ret;
+    }
+
+    g_deferTaskReady = TRUE;
+    (VOID)LOS_EventWrite(&g_deferEvent, DEFER_EVENT_WORK);
+
+    return LOS_OK;
+}
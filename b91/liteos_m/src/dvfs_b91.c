@@ -0,0 +1,298 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+
+#include <los_interrupt.h>
+#include <los_tick.h>
+
+#include <B91/clock.h>
+#include <B91/stimer.h>
+#include <B91/sys.h>
+
+#include <defer_b91.h>
+#include <dvfs_b91.h>
+#include <energy_b91.h>
+#include <pm_device_b91.h>
+
+#if B91_DVFS
+
+#define DVFS_REG_CCLK_SEL 0x1401e8
+#define DVFS_CCLK_DIV_MASK 0x0f
+
+typedef struct {
+    UINT32 mhz;
+    sys_pll_div_to_cclk_e cclkDiv;
+    sys_cclk_div_to_hclk_e hclkDiv;
+    sys_hclk_div_to_pclk_e pclkDiv;
+} DvfsOpp;
+
+/* The settings of the CCLK_xM_HCLK_xM_PCLK_xM macros, PLL at 192 MHz and flash clock at PLL / 4 */
+STATIC const DvfsOpp g_dvfsOpps[] = {
+    {16, PLL_DIV12_TO_CCLK, CCLK_DIV1_TO_HCLK, HCLK_DIV1_TO_PCLK},
+    {24, PLL_DIV8_TO_CCLK, CCLK_DIV1_TO_HCLK, HCLK_DIV1_TO_PCLK},
+    {32, PLL_DIV6_TO_CCLK, CCLK_DIV1_TO_HCLK, HCLK_DIV2_TO_PCLK},
+    {48, PLL_DIV4_TO_CCLK, CCLK_DIV1_TO_HCLK, HCLK_DIV2_TO_PCLK},
+    {64, PLL_DIV3_TO_CCLK, CCLK_DIV2_TO_HCLK, HCLK_DIV2_TO_PCLK},
+    {96, PLL_DIV2_TO_CCLK, CCLK_DIV2_TO_HCLK, HCLK_DIV2_TO_PCLK},
+};
+
+STATIC B91DvfsGovernor g_dvfsGov;
+STATIC const DvfsOpp *g_dvfsLevelOpp[B91_DVFS_LEVEL_MAX];
+STATIC UINT32 g_dvfsWant;
+STATIC UINT32 g_dvfsPostponed;
+STATIC BOOL g_dvfsSwitchPosted;
+
+/* Current window and time since the last residency update, with the idle time inside each */
+STATIC UINT32 g_dvfsWindowStart;
+STATIC UINT32 g_dvfsWindowIdle;
+STATIC UINT32 g_dvfsAccountStart;
+STATIC UINT32 g_dvfsAccountIdle;
+STATIC UINT32 g_dvfsIdleStart;
+
+/**
+ * @brief      Programs the clocks of an operating point. clock_init() sets hclk and pclk ahead of cclk,
+ *             which keeps them within limits when speeding up; when slowing down the new cclk divider is
+ *             written first for the same reason.
+ */
+_attribute_ram_code_sec_noinline_ STATIC VOID DvfsApply(const DvfsOpp *opp)
+{
+    if (opp->mhz < sys_clk.cclk) {
+        write_reg8(DVFS_REG_CCLK_SEL, (read_reg8(DVFS_REG_CCLK_SEL) & ~DVFS_CCLK_DIV_MASK) | opp->cclkDiv);
+    }
+    clock_init(PLL_CLK_192M, PAD_PLL_DIV, opp->cclkDiv, opp->hclkDiv, opp->pclkDiv, PLL_DIV4_TO_MSPI_CLK);
+}
+
+STATIC VOID DvfsAccount(UINT32 level, UINT32 now)
+{
+    UINT32 elapsed = now - g_dvfsAccountStart;
+    UINT32 busy = elapsed - g_dvfsAccountIdle;
+
+    B91DvfsGovernorSetLevel(&g_dvfsGov, level, elapsed / SYSTEM_TIMER_TICK_1US, busy / SYSTEM_TIMER_TICK_1US);
+    g_dvfsAccountStart = now;
+    g_dvfsAccountIdle = 0;
+}
+
+/* Interrupts locked */
+STATIC BOOL DvfsClockChange(const DvfsOpp *opp, UINT32 now)
+{
+    if ((B91PmDevicesBusyFor(now) != 0) || (B91PmDevicesPrepare(B91_PM_CLOCK_CHANGE) != LOS_OK)) {
+        g_dvfsPostponed++;
+        return FALSE;
+    }
+
+    DvfsApply(opp);
+    B91EnergyCpuClock(sys_clk.cclk);
+    B91PmDevicesResume(B91_PM_CLOCK_CHANGE);
+    return TRUE;
+}
+
+STATIC VOID DvfsSwitch(UINT32 level, UINT32 now)
+{
+    if ((level == g_dvfsGov.level) || (level >= g_dvfsGov.levelNum)) {
+        return;
+    }
+
+    if (DvfsClockChange(g_dvfsLevelOpp[level], now)) {
+        DvfsAccount(level, now);
+    }
+}
+
+/* Interrupts locked. Evaluates the load of the current window once it is long enough */
+STATIC VOID DvfsWindowClose(UINT32 now)
+{
+    UINT32 elapsed = now - g_dvfsWindowStart;
+    if (elapsed >= (B91_DVFS_WINDOW_US * SYSTEM_TIMER_TICK_1US)) {
+        UINT32 busy = elapsed - g_dvfsWindowIdle;
+        g_dvfsWant = B91DvfsGovernorWindow(&g_dvfsGov, elapsed / SYSTEM_TIMER_TICK_1US,
+                                           busy / SYSTEM_TIMER_TICK_1US);
+        g_dvfsWindowStart = now;
+        g_dvfsWindowIdle = 0;
+    }
+}
+
+/* Defer task: the clock switch and the device resume callbacks do not belong in the tick interrupt */
+STATIC VOID DvfsSwitchWork(VOID *arg, UINT32 data)
+{
+    (VOID)arg;
+    (VOID)data;
+
+    UINT32 intSave = LOS_IntLock();
+    g_dvfsSwitchPosted = FALSE;
+    DvfsSwitch(g_dvfsWant, stimer_get_tick());
+    LOS_IntRestore(intSave);
+}
+
+/* A CPU that never goes idle still has its windows closed from the OS tick, the switch is left to a task */
+STATIC VOID DvfsTickHandler(VOID)
+{
+    OsTickHandler();
+
+    DvfsWindowClose(stimer_get_tick());
+    if ((g_dvfsWant != g_dvfsGov.level) && !g_dvfsSwitchPosted) {
+        g_dvfsSwitchPosted = (B91DeferPost(B91_DEFER_PRIO_LOW, DvfsSwitchWork, NULL, 0) == LOS_OK);
+    }
+}
+
+VOID B91DvfsInit(VOID)
+{
+    UINT32 freq[B91_DVFS_LEVEL_MAX];
+    UINT32 num = 0;
+    UINT32 level = 0;
+
+    for (UINT32 i = 0; i < sizeof(g_dvfsOpps) / sizeof(g_dvfsOpps[0]); i++) {
+        if ((g_dvfsOpps[i].mhz < B91_DVFS_MIN_MHZ) || (g_dvfsOpps[i].mhz > B91_DVFS_MAX_MHZ)) {
+            continue;
+        }
+        if (g_dvfsOpps[i].mhz <= sys_clk.cclk) {
+            level = num;
+        }
+        g_dvfsLevelOpp[num] = &g_dvfsOpps[i];
+        freq[num++] = g_dvfsOpps[i].mhz;
+    }
+    if (num == 0) {
+        printf("dvfs: no level between %u and %u MHz\r\n", B91_DVFS_MIN_MHZ, B91_DVFS_MAX_MHZ);
+        return;
+    }
+
+    UINT32 intSave = LOS_IntLock();
+    B91DvfsGovernorInit(&g_dvfsGov, freq, num, level);
+    g_dvfsWant = level;
+    g_dvfsWindowStart = stimer_get_tick();
+    g_dvfsAccountStart = g_dvfsWindowStart;
+    /* The boot clock may be outside the range or between levels; if a device is busy now, the first switch fixes it */
+    if (g_dvfsLevelOpp[level]->mhz != sys_clk.cclk) {
+        (VOID)DvfsClockChange(g_dvfsLevelOpp[level], g_dvfsWindowStart);
+    }
+    LOS_IntRestore(intSave);
+
+    /* Only possible before LOS_Start() starts the tick timer */
+    if (LOS_TickTimerRegister(NULL, (HWI_PROC_FUNC)DvfsTickHandler) != LOS_OK) {
+        printf("dvfs: tick handler not registered, windows close on idle entry only\r\n");
+    }
+}
+
+VOID B91DvfsBoost(VOID)
+{
+    UINT32 intSave = LOS_IntLock();
+    if (g_dvfsGov.levelNum != 0) {
+        g_dvfsWant = B91DvfsGovernorBoost(&g_dvfsGov, TRUE);
+        DvfsSwitch(g_dvfsWant, stimer_get_tick());
+    }
+    LOS_IntRestore(intSave);
+}
+
+VOID B91DvfsUnboost(VOID)
+{
+    UINT32 intSave = LOS_IntLock();
+    if (g_dvfsGov.levelNum != 0) {
+        g_dvfsWant = B91DvfsGovernorBoost(&g_dvfsGov, FALSE);
+    }
+    LOS_IntRestore(intSave);
+}
+
+VOID B91DvfsIdleEnter(VOID)
+{
+    if (g_dvfsGov.levelNum == 0) {
+        return;
+    }
+
+    UINT32 now = stimer_get_tick();
+    g_dvfsIdleStart = now;
+
+    DvfsWindowClose(now);
+    DvfsSwitch(g_dvfsWant, now);
+}
+
+VOID B91DvfsIdleExit(VOID)
+{
+    if (g_dvfsGov.levelNum == 0) {
+        return;
+    }
+
+    UINT32 idle = stimer_get_tick() - g_dvfsIdleStart;
+    g_dvfsWindowIdle += idle;
+    g_dvfsAccountIdle += idle;
+}
+
+VOID B91DvfsRestore(VOID)
+{
+    if ((g_dvfsGov.levelNum != 0) && (g_dvfsLevelOpp[g_dvfsGov.level]->mhz != sys_clk.cclk)) {
+        DvfsApply(g_dvfsLevelOpp[g_dvfsGov.level]);
+    }
+}
+
+VOID B91DvfsGetGovernor(B91DvfsGovernor *gov)
+{
+    UINT32 intSave = LOS_IntLock();
+    DvfsAccount(g_dvfsGov.level, stimer_get_tick());
+    *gov = g_dvfsGov;
+    LOS_IntRestore(intSave);
+}
+
+VOID B91DvfsDumpStats(VOID)
+{
+    B91DvfsGovernor gov;
+
+    B91DvfsGetGovernor(&gov);
+    printf("cpu MHz  residency(ms)  load(%%)\r\n");
+    for (UINT32 i = 0; i < gov.levelNum; i++) {
+        UINT32 load = (gov.residencyUs[i] != 0) ? (UINT32)((gov.busyUs[i] * 100) / gov.residencyUs[i]) : 0;
+        printf("%7u %14u %8u%s\r\n", gov.freqMhz[i], (UINT32)(gov.residencyUs[i] / 1000), load,
+               (i == gov.level) ? " *" : "");
+    }
+    printf("dvfs: %u switches, %u postponed by busy devices, %u boosts held\r\n", gov.switches, g_dvfsPostponed,
+           gov.boosts);
+}
+
+#else /* B91_DVFS */
+
+VOID B91DvfsInit(VOID)
+{
+}
+
+VOID B91DvfsBoost(VOID)
+{
+}
+
+VOID B91DvfsUnboost(VOID)
+{
+}
+
+VOID B91DvfsIdleEnter(VOID)
+{
+}
+
+VOID B91DvfsIdleExit(VOID)
+{
+}
+
+VOID B91DvfsRestore(VOID)
+{
+}
+
+VOID B91DvfsGetGovernor(B91DvfsGovernor *gov)
+{
+    (VOID)gov;
+}
+
+VOID B91DvfsDumpStats(VOID)
+{
+}
+
+#endif /* B91_DVFS */
@@ -0,0 +1,99 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+#include <string.h>
+
+#include <dvfs_governor_b91.h>
+
+#define DVFS_PCT 100
+
+void B91DvfsGovernorInit(B91DvfsGovernor *gov, const uint32_t *freqMhz, uint32_t levelNum, uint32_t level)
+{
+    (void)memset(gov, 0, sizeof(*gov));
+
+    if (levelNum > B91_DVFS_LEVEL_MAX) {
+        levelNum = B91_DVFS_LEVEL_MAX;
+    }
+    (void)memcpy(gov->freqMhz, freqMhz, levelNum * sizeof(freqMhz[0]));
+    gov->levelNum = levelNum;
+    gov->level = (level < levelNum) ? level : (levelNum - 1);
+    gov->targetPct = B91_DVFS_TARGET_PCT;
+    gov->downHold = B91_DVFS_DOWN_HOLD;
+}
+
+uint32_t B91DvfsGovernorWindow(B91DvfsGovernor *gov, uint32_t windowUs, uint32_t busyUs)
+{
+    uint32_t top = gov->levelNum - 1;
+
+    if (gov->boosts != 0) {
+        gov->lowWindows = 0;
+        return top;
+    }
+    if (windowUs == 0) {
+        return gov->level;
+    }
+    /* A saturated window says nothing about how much more was wanted */
+    if (busyUs >= windowUs) {
+        gov->lowWindows = 0;
+        return top;
+    }
+
+    /* Work in MHz*us, compared against what a level does at the target utilization */
+    uint64_t work = (uint64_t)busyUs * gov->freqMhz[gov->level] * DVFS_PCT;
+    uint32_t want = top;
+    for (uint32_t i = 0; i < top; i++) {
+        if ((uint64_t)windowUs * gov->freqMhz[i] * gov->targetPct >= work) {
+            want = i;
+            break;
+        }
+    }
+
+    if (want >= gov->level) {
+        gov->lowWindows = 0;
+        return want;
+    }
+
+    if (++gov->lowWindows < gov->downHold) {
+        return gov->level;
+    }
+    gov->lowWindows = 0;
+    return want;
+}
+
+uint32_t B91DvfsGovernorBoost(B91DvfsGovernor *gov, bool hold)
+{
+    if (hold) {
+        gov->boosts++;
+    } else if (gov->boosts != 0) {
+        gov->boosts--;
+    }
+
+    /* Without a boost the next window decides, nothing measured yet says the top level is too much */
+    return (gov->boosts != 0) ? (gov->levelNum - 1) : gov->level;
+}
+
+void B91DvfsGovernorSetLevel(B91DvfsGovernor *gov, uint32_t level, uint32_t elapsedUs, uint32_t busyUs)
+{
+    gov->residencyUs[gov->level] += elapsedUs;
+    gov->busyUs[gov->level] += (busyUs < elapsedUs) ? busyUs : elapsedUs;
+
+    if ((level < gov->levelNum) && (level != gov->level)) {
+        gov->level = level;
+        gov->switches++;
+    }
+}
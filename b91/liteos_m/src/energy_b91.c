@@ -0,0 +1,480 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <los_interrupt.h>
+#include <los_task.h>
+#if (LOSCFG_DEBUG_HOOK == 1)
+#include <los_hook.h>
+#endif
+#ifdef LOSCFG_SHELL
+#include <shcmd.h>
+#endif
+
+#include <B91/clock.h>
+#include <B91/ext_driver/software_pa.h>
+#include <B91/stimer.h>
+
+#include <energy_b91.h>
+#include <power_b91.h>
+
+/* The split per task needs the task switch hook */
+#define ENERGY_PER_TASK  (LOSCFG_DEBUG_HOOK == 1)
+#define ENERGY_TASK_MAX  (LOSCFG_BASE_CORE_TSK_LIMIT + 1)
+#define ENERGY_TASK_NONE ENERGY_TASK_MAX /* CPU time while no task is known, before the first switch */
+#define ENERGY_LINE_MAX  96
+#define ENERGY_MS_TICKS  (SYSTEM_TIMER_TICK_1S / 1000)
+/* Charge is kept in uA * stimer ticks */
+#define ENERGY_NAH_DIV ((UINT64)SYSTEM_TIMER_TICK_1S * 3600 / 1000)
+#define ENERGY_US_NAH_DIV (3600ULL * 1000)
+
+typedef struct {
+    UINT64 ticks;
+    UINT64 charge;
+} EnergyAcc;
+
+typedef struct {
+    UINT32 count;
+    UINT32 start;
+    UINT32 ua;
+    UINT64 ticks;
+} EnergyConsumer;
+
+STATIC const UINT32 g_energyClockMhz[] = {16, 24, 32, 48, 64, 96};
+#define ENERGY_CLOCK_NUM (sizeof(g_energyClockMhz) / sizeof(g_energyClockMhz[0]))
+
+STATIC const CHAR *const g_energyConsumerNames[B91_ENERGY_CONSUMER_NUM] = {
+    "radio", "flash-program", "flash-erase", "uart0", "uart1",
+};
+
+STATIC const CHAR *const g_energyModeNames[B91_PM_MODE_NUM] = {"idle-wfi", "idle-suspend", "idle-deep-ret"};
+
+STATIC struct {
+    BOOL ready;
+    UINT32 last;     /* last checkpoint, stimer */
+    UINT64 elapsed;  /* ticks since the last reset */
+    UINT32 idleEnter;
+
+    UINT32 cpuBaseUa;
+    UINT32 cpuUaPerMhz;
+    UINT32 cpuUa;
+    UINT32 clock; /* index into g_energyClockMhz, ENERGY_CLOCK_NUM if unknown */
+    UINT32 sliceStart;
+
+    EnergyAcc cpu[ENERGY_CLOCK_NUM + 1];
+#if ENERGY_PER_TASK
+    UINT32 task;
+    EnergyAcc tasks[ENERGY_TASK_MAX + 1];
+#endif
+    EnergyConsumer consumers[B91_ENERGY_CONSUMER_NUM];
+    B91PmModeStats idleBase[B91_PM_MODE_NUM];
+} g_energy;
+
+STATIC BOOL g_energyRadioOn;
+STATIC BOOL g_energyRadioSeen; /* the radio row has a source, see energy_b91.h */
+STATIC rf_pa_callback_t g_energyPaNext; /* board PA switch the radio hook chains to */
+
+STATIC VOID EnergyCloseSlice(UINT32 now)
+{
+    UINT32 dt = now - g_energy.sliceStart;
+    UINT64 charge = (UINT64)dt * g_energy.cpuUa;
+
+    g_energy.cpu[g_energy.clock].ticks += dt;
+    g_energy.cpu[g_energy.clock].charge += charge;
+#if ENERGY_PER_TASK
+    g_energy.tasks[g_energy.task].ticks += dt;
+    g_energy.tasks[g_energy.task].charge += charge;
+#endif
+    g_energy.sliceStart = now;
+}
+
+/* Folds running spans into the counters so that no span outlives a stimer wrap */
+STATIC VOID EnergyCheckpoint(UINT32 now)
+{
+    g_energy.elapsed += now - g_energy.last;
+    g_energy.last = now;
+
+    for (UINT32 i = 0; i < B91_ENERGY_CONSUMER_NUM; i++) {
+        EnergyConsumer *c = &g_energy.consumers[i];
+        if (c->count != 0) {
+            c->ticks += now - c->start;
+            c->start = now;
+        }
+    }
+}
+
+#if ENERGY_PER_TASK
+STATIC VOID EnergyTaskSwitch(const LosTaskCB *newTask, const LosTaskCB *runTask)
+{
+    (VOID)runTask;
+
+    if (!g_energy.ready) {
+        return;
+    }
+    EnergyCloseSlice(stimer_get_tick());
+    g_energy.task = (newTask->taskID < ENERGY_TASK_MAX) ? newTask->taskID : ENERGY_TASK_NONE;
+}
+#endif
+
+/* The link layer calls the PA switch each time it turns the transceiver to TX, to RX and off */
+_attribute_ram_code_ STATIC VOID EnergyRadioPa(int type)
+{
+    if (g_energyPaNext != NULL) {
+        g_energyPaNext(type);
+    }
+
+    BOOL on = (type != PA_TYPE_OFF);
+    if (on != g_energyRadioOn) {
+        g_energyRadioOn = on;
+        if (on) {
+            B91EnergyOn(B91_ENERGY_RADIO);
+        } else {
+            B91EnergyOff(B91_ENERGY_RADIO);
+        }
+    }
+}
+
+/* Called locked; a later rf_pa_init() replaces the callback, it is put back in front on the next idle entry */
+STATIC VOID EnergyRadioHook(VOID)
+{
+    if (blc_rf_pa_cb != EnergyRadioPa) {
+        g_energyPaNext = blc_rf_pa_cb;
+        blc_rf_pa_cb = EnergyRadioPa;
+    }
+}
+
+STATIC UINT32 EnergyClockIndex(UINT32 mhz)
+{
+    for (UINT32 i = 0; i < ENERGY_CLOCK_NUM; i++) {
+        if (g_energyClockMhz[i] == mhz) {
+            return i;
+        }
+    }
+    return ENERGY_CLOCK_NUM;
+}
+
+VOID B91EnergyCpuClock(UINT32 mhz)
+{
+    UINT32 intSave = LOS_IntLock();
+    if (g_energy.ready) {
+        EnergyCloseSlice(stimer_get_tick());
+    }
+    g_energy.clock = EnergyClockIndex(mhz);
+    g_energy.cpuUa = g_energy.cpuBaseUa + mhz * g_energy.cpuUaPerMhz;
+    LOS_IntRestore(intSave);
+}
+
+VOID B91EnergySetCpuCurrent(UINT32 baseUa, UINT32 uaPerMhz)
+{
+    g_energy.cpuBaseUa = baseUa;
+    g_energy.cpuUaPerMhz = uaPerMhz;
+    B91EnergyCpuClock(sys_clk.cclk);
+}
+
+VOID B91EnergySetCurrent(B91EnergyConsumer consumer, UINT32 ua)
+{
+    if (consumer < B91_ENERGY_CONSUMER_NUM) {
+        g_energy.consumers[consumer].ua = ua;
+    }
+}
+
+VOID B91EnergyOn(B91EnergyConsumer consumer)
+{
+    if (consumer >= B91_ENERGY_CONSUMER_NUM) {
+        return;
+    }
+
+    UINT32 intSave = LOS_IntLock();
+    if (consumer == B91_ENERGY_RADIO) {
+        g_energyRadioSeen = TRUE;
+    }
+    EnergyConsumer *c = &g_energy.consumers[consumer];
+    if (c->count++ == 0) {
+        c->start = stimer_get_tick();
+    }
+    LOS_IntRestore(intSave);
+}
+
+VOID B91EnergyOff(B91EnergyConsumer consumer)
+{
+    if (consumer >= B91_ENERGY_CONSUMER_NUM) {
+        return;
+    }
+
+    UINT32 intSave = LOS_IntLock();
+    EnergyConsumer *c = &g_energy.consumers[consumer];
+    if ((c->count != 0) && (--c->count == 0)) {
+        c->ticks += stimer_get_tick() - c->start;
+    }
+    LOS_IntRestore(intSave);
+}
+
+VOID B91EnergyIdleEnter(VOID)
+{
+    if (!g_energy.ready) {
+        return;
+    }
+
+    UINT32 now = stimer_get_tick();
+    EnergyCloseSlice(now);
+    EnergyCheckpoint(now);
+    g_energy.idleEnter = now;
+    EnergyRadioHook();
+}
+
+VOID B91EnergyIdleExit(UINT32 sleptTicks)
+{
+    if (!g_energy.ready) {
+        return;
+    }
+
+    UINT32 now = stimer_get_tick();
+    g_energy.elapsed += now - g_energy.last;
+    g_energy.last = now;
+
+    /* Consumers on since before the sleep do not count it, those switched on after waking up do */
+    for (UINT32 i = 0; i < B91_ENERGY_CONSUMER_NUM; i++) {
+        EnergyConsumer *c = &g_energy.consumers[i];
+        if (c->count == 0) {
+            continue;
+        }
+        UINT32 on = now - c->start;
+        if (c->start == g_energy.idleEnter) {
+            on = (on > sleptTicks) ? (on - sleptTicks) : 0;
+        }
+        c->ticks += on;
+        c->start = now;
+    }
+
+    g_energy.sliceStart = now;
+}
+
+STATIC VOID EnergyResetLocked(VOID)
+{
+    B91PmGovernor gov;
+    UINT32 now = stimer_get_tick();
+
+    B91PmGetGovernor(&gov);
+    (VOID)memcpy(g_energy.idleBase, gov.stats, sizeof(g_energy.idleBase));
+    (VOID)memset(g_energy.cpu, 0, sizeof(g_energy.cpu));
+#if ENERGY_PER_TASK
+    (VOID)memset(g_energy.tasks, 0, sizeof(g_energy.tasks));
+#endif
+    for (UINT32 i = 0; i < B91_ENERGY_CONSUMER_NUM; i++) {
+        g_energy.consumers[i].ticks = 0;
+        g_energy.consumers[i].start = now;
+    }
+    g_energy.elapsed = 0;
+    g_energy.last = now;
+    g_energy.sliceStart = now;
+}
+
+VOID B91EnergyReset(VOID)
+{
+    UINT32 intSave = LOS_IntLock();
+    EnergyResetLocked();
+    LOS_IntRestore(intSave);
+}
+
+STATIC VOID EnergyPrint(VOID *arg, const CHAR *line, UINT32 len)
+{
+    (VOID)arg;
+    (VOID)len;
+    printf("%s", line);
+}
+
+#ifdef LOSCFG_SHELL
+STATIC UINT32 EnergyShellCmd(UINT32 argc, const CHAR **argv)
+{
+    if ((argc > 0) && (strcmp(argv[0], "reset") == 0)) {
+        B91EnergyReset();
+    } else {
+        B91EnergyReport(EnergyPrint, NULL, (argc > 0) && (strcmp(argv[0], "csv") == 0));
+    }
+    return LOS_OK;
+}
+#endif /* LOSCFG_SHELL */
+
+VOID B91EnergyInit(VOID)
+{
+    STATIC const UINT32 defaultUa[B91_ENERGY_CONSUMER_NUM] = {
+        B91_ENERGY_CURRENT_RADIO_UA, B91_ENERGY_CURRENT_FLASH_PROGRAM_UA, B91_ENERGY_CURRENT_FLASH_ERASE_UA,
+        B91_ENERGY_CURRENT_UART_UA,  B91_ENERGY_CURRENT_UART_UA,
+    };
+
+    UINT32 intSave = LOS_IntLock();
+    for (UINT32 i = 0; i < B91_ENERGY_CONSUMER_NUM; i++) {
+        if (g_energy.consumers[i].ua == 0) {
+            g_energy.consumers[i].ua = defaultUa[i];
+        }
+    }
+    g_energy.cpuBaseUa = B91_ENERGY_CPU_BASE_UA;
+    g_energy.cpuUaPerMhz = B91_ENERGY_CPU_UA_PER_MHZ;
+    g_energy.clock = EnergyClockIndex(sys_clk.cclk);
+    g_energy.cpuUa = g_energy.cpuBaseUa + sys_clk.cclk * g_energy.cpuUaPerMhz;
+#if ENERGY_PER_TASK
+    g_energy.task = ENERGY_TASK_NONE;
+#endif
+    EnergyResetLocked();
+    g_energy.ready = TRUE;
+    LOS_IntRestore(intSave);
+
+#if ENERGY_PER_TASK
+    (VOID)LOS_HookReg(LOS_HOOK_TYPE_TASK_SWITCHEDIN, EnergyTaskSwitch);
+#endif
+#ifdef LOSCFG_SHELL
+    (VOID)osCmdReg(CMD_TYPE_EX, "energy", XARGS, (CmdCallBackFunc)EnergyShellCmd);
+#endif
+
+    intSave = LOS_IntLock();
+    EnergyRadioHook();
+    LOS_IntRestore(intSave);
+}
+
+STATIC VOID EnergyLine(B91EnergyWriteFunc write, VOID *arg, BOOL csv, const CHAR *kind, const CHAR *name,
+                       UINT64 ticks, UINT64 nah)
+{
+    CHAR line[ENERGY_LINE_MAX];
+    UINT32 ms = (UINT32)(ticks / ENERGY_MS_TICKS);
+    INT32 len;
+
+    if (csv) {
+        len = snprintf(line, sizeof(line), "%s,%s,%u,%llu\r\n", kind, name, ms, (unsigned long long)nah);
+    } else {
+        len = snprintf(line, sizeof(line), "%-16s %10u %10llu.%03u\r\n", name, ms,
+                       (unsigned long long)(nah / 1000), (UINT32)(nah % 1000));
+    }
+    if (len > 0) {
+        write(arg, line, ((UINT32)len < sizeof(line)) ? (UINT32)len : (sizeof(line) - 1));
+    }
+}
+
+STATIC VOID EnergyLineUnavailable(B91EnergyWriteFunc write, VOID *arg, BOOL csv, const CHAR *kind,
+                                  const CHAR *name)
+{
+    CHAR line[ENERGY_LINE_MAX];
+    INT32 len = csv ? snprintf(line, sizeof(line), "%s,%s,,\r\n", kind, name)
+                    : snprintf(line, sizeof(line), "%-16s %10s %14s\r\n", name, "n/a", "n/a");
+
+    if (len > 0) {
+        write(arg, line, ((UINT32)len < sizeof(line)) ? (UINT32)len : (sizeof(line) - 1));
+    }
+}
+
+VOID B91EnergyReport(B91EnergyWriteFunc write, VOID *arg, BOOL csv)
+{
+#if ENERGY_PER_TASK
+    STATIC EnergyAcc tasks[ENERGY_TASK_MAX + 1];
+#endif
+    EnergyAcc cpu[ENERGY_CLOCK_NUM + 1];
+    EnergyConsumer consumers[B91_ENERGY_CONSUMER_NUM];
+    B91PmModeStats idleBase[B91_PM_MODE_NUM];
+    B91PmGovernor gov;
+    UINT64 elapsed;
+    CHAR name[24];
+    CHAR line[ENERGY_LINE_MAX];
+
+    if ((write == NULL) || !g_energy.ready) {
+        return;
+    }
+
+    UINT32 intSave = LOS_IntLock();
+    UINT32 now = stimer_get_tick();
+    EnergyCloseSlice(now);
+    EnergyCheckpoint(now);
+    elapsed = g_energy.elapsed;
+    (VOID)memcpy(cpu, g_energy.cpu, sizeof(cpu));
+#if ENERGY_PER_TASK
+    (VOID)memcpy(tasks, g_energy.tasks, sizeof(tasks));
+#endif
+    (VOID)memcpy(consumers, g_energy.consumers, sizeof(consumers));
+    (VOID)memcpy(idleBase, g_energy.idleBase, sizeof(idleBase));
+    LOS_IntRestore(intSave);
+    B91PmGetGovernor(&gov);
+
+    UINT64 totalNah = 0;
+    UINT64 cpuNah[ENERGY_CLOCK_NUM + 1];
+    UINT64 idleNah[B91_PM_MODE_NUM];
+    UINT64 consumerNah[B91_ENERGY_CONSUMER_NUM];
+    for (UINT32 i = 0; i <= ENERGY_CLOCK_NUM; i++) {
+        cpuNah[i] = cpu[i].charge / ENERGY_NAH_DIV;
+        totalNah += cpuNah[i];
+    }
+    for (UINT32 i = 0; i < B91_PM_MODE_NUM; i++) {
+        idleNah[i] = (gov.stats[i].chargeUaUs - idleBase[i].chargeUaUs) / ENERGY_US_NAH_DIV;
+        totalNah += idleNah[i];
+    }
+    for (UINT32 i = 0; i < B91_ENERGY_CONSUMER_NUM; i++) {
+        consumerNah[i] = (consumers[i].ticks * consumers[i].ua) / ENERGY_NAH_DIV;
+        totalNah += consumerNah[i];
+    }
+
+    INT32 len = csv ? snprintf(line, sizeof(line), "kind,name,time_ms,charge_nah\r\n")
+                    : snprintf(line, sizeof(line), "%-16s %10s %14s\r\n", "subsystem", "time(ms)", "charge(uAh)");
+    write(arg, line, (UINT32)len);
+    EnergyLine(write, arg, csv, "total", "total", elapsed, totalNah);
+
+    for (UINT32 i = 0; i <= ENERGY_CLOCK_NUM; i++) {
+        if (cpu[i].ticks == 0) {
+            continue;
+        }
+        if (i < ENERGY_CLOCK_NUM) {
+            (VOID)snprintf(name, sizeof(name), "cpu-%uMHz", g_energyClockMhz[i]);
+        } else {
+            (VOID)snprintf(name, sizeof(name), "cpu-other");
+        }
+        EnergyLine(write, arg, csv, "cpu", name, cpu[i].ticks, cpuNah[i]);
+    }
+    for (UINT32 i = 0; i < B91_PM_MODE_NUM; i++) {
+        UINT64 us = gov.stats[i].residencyUs - idleBase[i].residencyUs;
+        EnergyLine(write, arg, csv, "idle", g_energyModeNames[i], us * SYSTEM_TIMER_TICK_1US, idleNah[i]);
+    }
+    for (UINT32 i = 0; i < B91_ENERGY_CONSUMER_NUM; i++) {
+        if ((i == B91_ENERGY_RADIO) && !g_energyRadioSeen) {
+            EnergyLineUnavailable(write, arg, csv, "consumer", g_energyConsumerNames[i]);
+            continue;
+        }
+        EnergyLine(write, arg, csv, "consumer", g_energyConsumerNames[i], consumers[i].ticks, consumerNah[i]);
+    }
+
+#if ENERGY_PER_TASK
+    if (!csv) {
+        len = snprintf(line, sizeof(line), "%-16s %10s %14s\r\n", "task", "cpu(ms)", "charge(uAh)");
+        write(arg, line, (UINT32)len);
+    }
+    for (UINT32 i = 0; i <= ENERGY_TASK_MAX; i++) {
+        if (tasks[i].ticks == 0) {
+            continue;
+        }
+        TSK_INFO_S info;
+        if ((i < ENERGY_TASK_MAX) && (LOS_TaskInfoGet(i, &info) == LOS_OK)) {
+            (VOID)snprintf(name, sizeof(name), "%s", info.acName);
+        } else {
+            (VOID)snprintf(name, sizeof(name), (i < ENERGY_TASK_MAX) ? "task-%u" : "unattributed", i);
+        }
+        EnergyLine(write, arg, csv, "task", name, tasks[i].ticks, tasks[i].charge / ENERGY_NAH_DIV);
+    }
+#endif
+}
+
+VOID B91EnergyDump(VOID)
+{
+    B91EnergyReport(EnergyPrint, NULL, FALSE);
+}
@@ -24,6 +24,8 @@
 
 #include <B91/flash.h>
 
+#include <energy_b91.h>
+
 #define LITTLEFS_PATH "/littlefs/"
 
 #define LITTLEFS_PHYS_ADDR (1024 * 1024)
@@ -52,7 +54,9 @@ int littlefs_block_write(const struct lfs_config *cfg, lfs_block_t block, lfs_of
 {
     uint32_t addr = block * (cfg->block_size) + off;
 
+    B91EnergyOn(B91_ENERGY_FLASH_PROGRAM);
     flash_write_page(LITTLEFS_PHYS_ADDR + addr, size, (unsigned char *)buffer);
+    B91EnergyOff(B91_ENERGY_FLASH_PROGRAM);
 
     return LFS_ERR_OK;
 }
@@ -61,7 +65,9 @@ int littlefs_block_erase(const struct lfs_config *cfg, lfs_block_t block)
 {
     uint32_t addr = block * (cfg->block_size);
 
+    B91EnergyOn(B91_ENERGY_FLASH_ERASE);
     flash_erase_sector(LITTLEFS_PHYS_ADDR + addr);
+    B91EnergyOff(B91_ENERGY_FLASH_ERASE);
 
     return LFS_ERR_OK;
 }
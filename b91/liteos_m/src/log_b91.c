@@ -0,0 +1,382 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+#include <stdarg.h>
+#include <string.h>
+
+#include <los_event.h>
+#include <los_exchook.h>
+#include <los_interrupt.h>
+#include <los_task.h>
+
+#include <B91/stimer.h>
+#include <B91/uart.h>
+
+#include <log_b91.h>
+#include <log_token_b91.h>
+#include <pm_device_b91.h>
+
+/*
+ * Multi-producer single-consumer byte ring.
+ *
+ * Producers reserve space by advancing head with a CAS, fill the payload and publish the record by
+ * storing a non-zero size into its header. The drain task walks committed records from tail, copies
+ * them into the staging buffer, zeroes the consumed bytes and only then advances tail. Zeroed memory
+ * is what lets the consumer tell a reserved-but-unfinished header (size == 0) from a committed one.
+ * A record never wraps: if it does not fit before the end of the ring a padding record is emitted.
+ */
+
+#define LOG_RING_MASK      (B91_LOG_RING_SIZE - 1)
+#define LOG_ALIGN(x)       (((x) + 3U) & ~3U)
+#define LOG_EVENT_DATA     0x1U
+#define LOG_BITS_PER_BYTE  10U
+#define LOG_TOKEN_HDR_SIZE 6U /* magic, argc, token */
+#define MS_IN_S            1000U
+
+#define LOG_STAGE_IDLE    0
+#define LOG_STAGE_FILLED  1
+#define LOG_STAGE_SENDING 2
+
+#if (B91_LOG_RING_SIZE & LOG_RING_MASK) != 0
+#error B91_LOG_RING_SIZE must be a power of two
+#endif
+
+typedef struct {
+    UINT16 len;  /* payload length, holds the reserved length until commit */
+    UINT16 size; /* bytes occupied in the ring including header, 0 until commit */
+} LogHdr;
+
+STATIC struct {
+    UINT32 head;
+    UINT32 tail;
+    UINT8 buf[B91_LOG_RING_SIZE] __attribute__((aligned(4)));
+} g_logRing;
+
+STATIC UINT8 g_logStage[B91_LOG_STAGE_SIZE] __attribute__((aligned(4)));
+STATIC volatile UINT32 g_logStageLen;
+STATIC volatile UINT32 g_logStageState = LOG_STAGE_IDLE;
+
+STATIC B91LogStats g_logStats;
+STATIC EVENT_CB_S g_logEvent;
+STATIC BOOL g_logTaskReady = FALSE;
+
+STATIC uart_num_e g_logPort = UART0;
+STATIC UINT32 g_logBaudrate = 115200;
+
+/* Keeps the idle code from sleeping while a staged transfer is on the wire */
+STATIC B91PmDevice g_logPm = {
+    .name = "log-dma",
+};
+
+STATIC VOID LogAccountDrop(UINT32 len)
+{
+    __atomic_fetch_add(&g_logStats.dropped, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&g_logStats.droppedBytes, len, __ATOMIC_RELAXED);
+}
+
+STATIC VOID LogUpdateMaxUsed(UINT32 used)
+{
+    UINT32 prev = __atomic_load_n(&g_logStats.maxUsed, __ATOMIC_RELAXED);
+    while (used > prev) {
+        if (__atomic_compare_exchange_n(&g_logStats.maxUsed, &prev, used, TRUE, __ATOMIC_RELAXED,
+                                        __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+}
+
+_attribute_ram_code_ VOID *B91LogReserve(UINT32 maxLen)
+{
+    if ((maxLen == 0) || (maxLen > B91_LOG_STAGE_SIZE)) {
+        LogAccountDrop(maxLen);
+        return NULL;
+    }
+
+    UINT32 size = LOG_ALIGN(sizeof(LogHdr) + maxLen);
+    UINT32 head = __atomic_load_n(&g_logRing.head, __ATOMIC_RELAXED);
+    UINT32 pad;
+    UINT32 need;
+
+    do {
+        UINT32 off = head & LOG_RING_MASK;
+        pad = ((off + size) > B91_LOG_RING_SIZE) ? (B91_LOG_RING_SIZE - off) : 0;
+        need = pad + size;
+
+        UINT32 used = head - __atomic_load_n(&g_logRing.tail, __ATOMIC_ACQUIRE);
+        if ((B91_LOG_RING_SIZE - used) < need) {
+            LogAccountDrop(maxLen);
+            return NULL;
+        }
+    } while (!__atomic_compare_exchange_n(&g_logRing.head, &head, head + need, TRUE, __ATOMIC_ACQ_REL,
+                                          __ATOMIC_RELAXED));
+
+    LogUpdateMaxUsed(head + need - __atomic_load_n(&g_logRing.tail, __ATOMIC_RELAXED));
+
+    if (pad != 0) {
+        LogHdr *padHdr = (LogHdr *)&g_logRing.buf[head & LOG_RING_MASK];
+        padHdr->len = 0;
+        __atomic_store_n(&padHdr->size, (UINT16)pad, __ATOMIC_RELEASE);
+    }
+
+    LogHdr *hdr = (LogHdr *)&g_logRing.buf[(head + pad) & LOG_RING_MASK];
+    hdr->len = (UINT16)maxLen;
+    return hdr + 1;
+}
+
+_attribute_ram_code_ VOID B91LogCommit(VOID *payload, UINT32 len)
+{
+    LogHdr *hdr = (LogHdr *)payload - 1;
+    UINT16 size = (UINT16)LOG_ALIGN(sizeof(LogHdr) + hdr->len);
+
+    if (len > hdr->len) {
+        len = hdr->len;
+    }
+    hdr->len = (UINT16)len;
+
+    /*
+     * Give the unused end of the reservation back while no record was reserved after it, i.e. head
+     * still ends this record (the ring can not hold a whole lap more). The bytes go back zeroed, as
+     * the consumer leaves them, before head lets another producer have them.
+     */
+    UINT16 used = (UINT16)LOG_ALIGN(sizeof(LogHdr) + len);
+    UINT32 end = (UINT32)((UINT8 *)hdr - g_logRing.buf) + size;
+    UINT32 head = __atomic_load_n(&g_logRing.head, __ATOMIC_RELAXED);
+    if ((used < size) && (((head ^ end) & LOG_RING_MASK) == 0)) {
+        (VOID)memset((UINT8 *)hdr + used, 0, size - used);
+        if (__atomic_compare_exchange_n(&g_logRing.head, &head, head - (size - used), FALSE, __ATOMIC_RELEASE,
+                                        __ATOMIC_RELAXED)) {
+            size = used;
+        }
+    }
+
+    __atomic_fetch_add(&g_logStats.records, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&g_logStats.bytes, len, __ATOMIC_RELAXED);
+    __atomic_store_n(&hdr->size, size, __ATOMIC_RELEASE);
+
+    if (g_logTaskReady) {
+        (VOID)LOS_EventWrite(&g_logEvent, LOG_EVENT_DATA);
+    }
+}
+
+UINT32 B91LogWrite(const VOID *data, UINT32 len)
+{
+    const UINT8 *src = (const UINT8 *)data;
+    UINT32 done = 0;
+
+    while (done < len) {
+        UINT32 chunk = len - done;
+        if (chunk > B91_LOG_STAGE_SIZE) {
+            chunk = B91_LOG_STAGE_SIZE;
+        }
+
+        VOID *dst = B91LogReserve(chunk);
+        if (dst == NULL) {
+            if ((len - done) > chunk) {
+                LogAccountDrop(len - done - chunk);
+            }
+            break;
+        }
+        (VOID)memcpy(dst, src + done, chunk);
+        B91LogCommit(dst, chunk);
+        done += chunk;
+    }
+
+    return done;
+}
+
+/**
+ * @brief      Moves committed records into the staging buffer. Must only be called by the consumer.
+ * @return     number of bytes placed into the staging buffer.
+ */
+STATIC UINT32 LogCollect(VOID)
+{
+    UINT32 tail = g_logRing.tail;
+    UINT32 head = __atomic_load_n(&g_logRing.head, __ATOMIC_ACQUIRE);
+    UINT32 n = 0;
+
+    while (tail != head) {
+        LogHdr *hdr = (LogHdr *)&g_logRing.buf[tail & LOG_RING_MASK];
+        UINT16 size = __atomic_load_n(&hdr->size, __ATOMIC_ACQUIRE);
+        if (size == 0) {
+            break; /* reserved, but the producer has not committed it yet */
+        }
+        if ((n + hdr->len) > B91_LOG_STAGE_SIZE) {
+            break;
+        }
+
+        (VOID)memcpy(&g_logStage[n], hdr + 1, hdr->len);
+        n += hdr->len;
+        (VOID)memset(hdr, 0, size);
+        tail += size;
+    }
+
+    __atomic_store_n(&g_logRing.tail, tail, __ATOMIC_RELEASE);
+    return n;
+}
+
+STATIC VOID LogWaitTxDone(BOOL mayBlock)
+{
+    if (g_logStageState != LOG_STAGE_SENDING) {
+        return;
+    }
+
+    if (mayBlock) {
+        UINT32 ms = (g_logStageLen * LOG_BITS_PER_BYTE * MS_IN_S) / g_logBaudrate;
+        if (ms != 0) {
+            LOS_Msleep(ms);
+        }
+        while (uart_tx_is_busy(g_logPort)) {
+            LOS_Msleep(1);
+        }
+    } else {
+        while (uart_tx_is_busy(g_logPort)) {
+        }
+    }
+
+    g_logStageLen = 0;
+    g_logStageState = LOG_STAGE_IDLE;
+    B91PmDeviceIdle(&g_logPm);
+}
+
+STATIC VOID LogKickTx(VOID)
+{
+    UINT64 ticks = ((UINT64)g_logStageLen * LOG_BITS_PER_BYTE * SYSTEM_TIMER_TICK_1S) / g_logBaudrate;
+    B91PmDeviceBusyUntil(&g_logPm, stimer_get_tick() + (UINT32)ticks);
+
+    g_logStageState = LOG_STAGE_SENDING;
+    (VOID)uart_send_dma(g_logPort, g_logStage, g_logStageLen);
+}
+
+STATIC VOID LogDrainTask(VOID)
+{
+    UINT32 n;
+
+    while (1) {
+        (VOID)LOS_EventRead(&g_logEvent, LOG_EVENT_DATA, LOS_WAITMODE_OR | LOS_WAITMODE_CLR, LOS_WAIT_FOREVER);
+
+        while ((n = LogCollect()) != 0) {
+            g_logStageLen = n;
+            g_logStageState = LOG_STAGE_FILLED;
+            LogKickTx();
+            LogWaitTxDone(TRUE);
+        }
+    }
+}
+
+VOID B91LogFlush(VOID)
+{
+    UINT32 intSave = LOS_IntLock();
+
+    /* A transfer started by the drain task is left to finish, a filled but not started one is sent here */
+    LogWaitTxDone(FALSE);
+    if (g_logStageState == LOG_STAGE_FILLED) {
+        LogKickTx();
+        LogWaitTxDone(FALSE);
+    }
+
+    UINT32 n;
+    while ((n = LogCollect()) != 0) {
+        g_logStageLen = n;
+        LogKickTx();
+        LogWaitTxDone(FALSE);
+    }
+
+    LOS_IntRestore(intSave);
+}
+
+STATIC VOID LogExcHook(EXC_TYPE excType)
+{
+    (VOID)excType;
+    B91LogFlush();
+}
+
+VOID B91LogGetStats(B91LogStats *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+
+    UINT32 intSave = LOS_IntLock();
+    *stats = g_logStats;
+    LOS_IntRestore(intSave);
+}
+
+VOID B91LogOutputInit(uart_num_e port, dma_chn_e chn, UINT32 baudrate)
+{
+    g_logPort = port;
+    g_logBaudrate = baudrate;
+
+    uart_set_tx_dma_config(port, chn);
+    dma_clr_irq_mask(chn, TC_MASK | ABT_MASK | ERR_MASK);
+}
+
+UINT32 B91LogTaskInit(VOID)
+{
+    UINT32 ret = LOS_EventInit(&g_logEvent);
+    if (ret != LOS_OK) {
+        return ret;
+    }
+
+    UINT32 taskId;
+    TSK_INIT_PARAM_S task = {0};
+    task.pfnTaskEntry = (TSK_ENTRY_FUNC)LogDrainTask;
+    task.uwStackSize = B91_LOG_TASK_STACKSIZE;
+    task.pcName = "B91LogDrain";
+    task.usTaskPrio = B91_LOG_TASK_PRIO;
+    ret = LOS_TaskCreate(&taskId, &task);
+    if (ret != LOS_OK) {
+        return ret;
+    }
+
+    (VOID)B91PmDeviceRegister(&g_logPm);
+    (VOID)OsExcHookRegister(EXC_PANIC, LogExcHook);
+    (VOID)OsExcHookRegister(EXC_INTERRUPT, LogExcHook);
+
+    g_logTaskReady = TRUE;
+    /* Records queued during early boot */
+    (VOID)LOS_EventWrite(&g_logEvent, LOG_EVENT_DATA);
+
+    return LOS_OK;
+}
+
+VOID B91LogTokenEmit(UINT32 token, UINT32 argc, ...)
+{
+    if (argc > B91_LOG_TOKEN_ARGS_MAX) {
+        argc = B91_LOG_TOKEN_ARGS_MAX;
+    }
+
+    UINT32 len = LOG_TOKEN_HDR_SIZE + argc * sizeof(UINT32);
+    UINT8 *dst = B91LogReserve(len);
+    if (dst == NULL) {
+        return;
+    }
+
+    dst[0] = B91_LOG_TOKEN_MAGIC;
+    dst[1] = (UINT8)argc;
+    (VOID)memcpy(&dst[LOG_TOKEN_HDR_SIZE - sizeof(token)], &token, sizeof(token));
+
+    va_list ap;
+    va_start(ap, argc);
+    for (UINT32 i = 0; i < argc; ++i) {
+        UINT32 arg = va_arg(ap, UINT32);
+        (VOID)memcpy(&dst[LOG_TOKEN_HDR_SIZE + i * sizeof(arg)], &arg, sizeof(arg));
+    }
+    va_end(ap);
+
+    B91LogCommit(dst, len);
+}
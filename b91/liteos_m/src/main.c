@@ -26,7 +26,6 @@
 #include <unistd.h>
 
 #include <los_task.h>
-#include <los_memory.h>
 
 #include <devmgr_service_start.h>
 #include <gpio_if.h>
@@ -37,6 +36,14 @@
 #include <board_config.h>
 
 #include <b91_irq.h>
+#include <boot_b91.h>
+#include <defer_b91.h>
+#include <dvfs_b91.h>
+#include <energy_b91.h>
+#include <log_b91.h>
+#include <memstat_b91.h>
+#include <pm_device_b91.h>
+#include <pm_governor_b91.h>
 #include <system_b91.h>
 #include <power_b91.h>
 
@@ -58,6 +65,9 @@
 #define DEBUG_UART_PARITY    UART_PARITY_NONE
 #define DEBUG_UART_STOP_BITS UART_STOP_BIT_ONE
 #define DEBUG_UART_BAUDRATE  921600
+#define DEBUG_UART_DMA_CHN   DMA3
+
+#define HILOG_LINE_MAX 400
 
 #define B91_SYSTEM_INIT_TASK_STACKSIZE (1024 * 32)
 #define B91_SYSTEM_INIT_TASK_PRIO      7
@@ -65,22 +75,6 @@
 
 extern UserErrFunc g_userErrFunc;
 
-void *__wrap_malloc(size_t s)
-{
-    if (s == 0) {
-        return NULL;
-    }
-    return LOS_MemAlloc(OS_SYS_MEM_ADDR, s);
-}
-
-void __wrap_free(void *ptr)
-{
-    if (ptr == NULL) {
-        return;
-    }
-    return LOS_MemFree(OS_SYS_MEM_ADDR, ptr);
-}
-
 void OHOS_SystemInit(void);
 struct PartitionCfg *LittlefsConfigGet(void);
 
@@ -119,7 +113,21 @@ VOID IoTWatchDogKick(VOID)
 STATIC VOID B91SystemInit(VOID)
 {
     OHOS_SystemInit();
+    B91BootMark("ohos-init");
+}
+
+/* Runs below B91SystemInit, in the time the system services and the BLE stack are waiting */
+STATIC VOID B91LateInit(VOID)
+{
+#if B91_LAZY_INIT
+    if (DeviceManagerStartStep2()) {
+        printf("DeviceManagerStartStep2 failed!\r\n");
+    }
+    B91BootMark("hdf-step2");
+#endif
+
     LittlefsInit();
+    B91BootMark("littlefs");
 }
 
 UINT32 LosAppInit(VOID)
@@ -128,6 +136,21 @@ UINT32 LosAppInit(VOID)
 
     B91IrqInit();
 
+    ret = B91LogTaskInit();
+    if (ret != LOS_OK) {
+        printf("B91LogTaskInit failed! ERROR: 0x%x\r\n", ret);
+    }
+
+    ret = B91DeferInit();
+    if (ret != LOS_OK) {
+        printf("B91DeferInit failed! ERROR: 0x%x\r\n", ret);
+    }
+
+    ret = B91MemTelemetryInit();
+    if (ret != LOS_OK) {
+        printf("B91MemTelemetryInit failed! ERROR: 0x%x\r\n", ret);
+    }
+
     unsigned int taskID_ohos;
     TSK_INIT_PARAM_S task_ohos = {0};
 
@@ -138,6 +161,12 @@ UINT32 LosAppInit(VOID)
     ret = LOS_TaskCreate(&taskID_ohos, &task_ohos);
     if (ret != LOS_OK) {
         printf("Create Task failed! ERROR: 0x%x\r\n", ret);
+        return ret;
+    }
+
+    ret = B91BootLateInit(B91LateInit);
+    if (ret != LOS_OK) {
+        printf("B91BootLateInit failed! ERROR: 0x%x\r\n", ret);
     }
 
     return ret;
@@ -167,8 +196,37 @@ VOID UsartInit(VOID)
     uart_cal_div_and_bwpc(DEBUG_UART_BAUDRATE, sys_clk.pclk * HZ_IN_MHZ, &div, &bwpc);
     uart_init(DEBUG_UART_PORT, div, bwpc, DEBUG_UART_PARITY, DEBUG_UART_STOP_BITS);
     uart_rx_irq_trig_level(DEBUG_UART_PORT, 1);
+
+    B91LogOutputInit(DEBUG_UART_PORT, DEBUG_UART_DMA_CHN, DEBUG_UART_BAUDRATE);
+}
+
+STATIC UINT32 DebugUartPmPrepare(B91PmDevice *dev, UINT32 mode)
+{
+    (VOID)dev;
+    (VOID)mode;
+
+    /* Bytes written without DMA give no busy hint */
+    return uart_tx_is_busy(DEBUG_UART_PORT) ? LOS_NOK : LOS_OK;
+}
+
+STATIC VOID DebugUartPmResume(B91PmDevice *dev, UINT32 mode)
+{
+    (VOID)dev;
+
+    if (mode == B91_PM_MODE_SUSPEND) {
+        uart_clr_tx_index(DEBUG_UART_PORT);
+        uart_clr_rx_index(DEBUG_UART_PORT);
+    } else if ((mode == B91_PM_MODE_DEEP_RET) || (mode == B91_PM_CLOCK_CHANGE)) {
+        UsartInit();
+    }
 }
 
+STATIC B91PmDevice g_debugUartPm = {
+    .name = "debug-uart",
+    .prepare = DebugUartPmPrepare,
+    .resume = DebugUartPmResume,
+};
+
 int _write(int handle, char *data, int size)
 {
     UNUSED(handle);
@@ -180,9 +238,7 @@ int _write(int handle, char *data, int size)
     switch (handle) {
         case STDOUT_FILENO:
         case STDERR_FILENO: {
-            uart_send(DEBUG_UART_PORT, (unsigned char *)data, size);
-            while (uart_tx_is_busy(DEBUG_UART_PORT)) {
-            }
+            (VOID)B91LogWrite(data, size);
             ret = size;
             break;
         }
@@ -197,9 +253,12 @@ int _write(int handle, char *data, int size)
 static boolean hilog(const HiLogContent *hilogContent, uint32 len)
 {
     UNUSED(len);
-    static char buf[400];
-    int32 bytes = LogContentFmt(buf, sizeof(buf), (const uint8 *)hilogContent);
-    _write(STDOUT_FILENO, buf, bytes);
+    char *buf = B91LogReserve(HILOG_LINE_MAX);
+    if (buf == NULL) {
+        return TRUE;
+    }
+    int32 bytes = LogContentFmt(buf, HILOG_LINE_MAX, (const uint8 *)hilogContent);
+    B91LogCommit(buf, (bytes > 0) ? bytes : 0);
     return TRUE;
 }
 
@@ -207,6 +266,7 @@ __attribute__((noreturn)) void __assert_func(const char *file, int line, const c
 {
     printf("Assertion failed: %s (%s: %s: %d)\r\n", expr, file, func, line);
     fflush(NULL);
+    B91LogFlush();
     abort();
 }
 
@@ -230,8 +290,10 @@ STATIC INT32 SafeMain(VOID)
 {
     UINT32 ret;
 
+    B91BootMark("main");
     HardwareInit();
     UsartInit();
+    B91BootMark("hw-init");
 
     printf("\r\n OHOS start \r\n");
 
@@ -243,10 +305,16 @@ STATIC INT32 SafeMain(VOID)
         printf("Liteos kernel init failed! ERROR: 0x%x\r\n", ret);
         goto START_FAILED;
     }
+    B91BootMark("kernel");
 
+#if B91_LAZY_INIT
+    /* Drivers with preload = 1 are left to B91LateInit() */
+    DeviceManagerSetQuickLoad(DEV_MGR_QUICK_LOAD);
+#endif
     if (DeviceManagerStart()) {
         printf("DeviceManagerStart failed!\r\n");
     }
+    B91BootMark("hdf");
 
     ret = LosAppInit();
     if (ret != LOS_OK) {
@@ -254,10 +322,16 @@ STATIC INT32 SafeMain(VOID)
         goto START_FAILED;
     }
 
+    (VOID)B91PmDeviceRegister(&g_debugUartPm);
+    B91EnergyInit();
+    B91EnergyOn((DEBUG_UART_PORT == UART0) ? B91_ENERGY_UART0 : B91_ENERGY_UART1);
+    B91DvfsInit();
     B91SuspendSleepInit();
+    B91BootMark("start");
     LOS_Start();
 
 START_FAILED:
+    B91LogFlush();
     while (1) {
         __asm__ volatile("wfi");
     }
@@ -0,0 +1,361 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <los_config.h>
+#include <los_interrupt.h>
+#include <los_memory.h>
+
+#include <log_b91.h>
+#include <log_token_b91.h>
+#include <malloc_b91.h>
+#include <memstat_b91.h>
+
+#define MALLOC_TRACE_LINE_MAX 24
+
+#if B91_MEM_TELEMETRY
+#define MALLOC_TAG_MAGIC 0xB91AU
+
+/* In front of every block, 8 bytes to keep the alignment */
+typedef struct {
+    UINT32 size;
+    UINT16 tag;
+    UINT16 magic;
+} MallocHeader;
+
+STATIC UINT32 g_badHeaders;
+#endif
+
+#if B91_SLAB
+STATIC B91Slab g_slab;
+STATIC BOOL g_slabReady;
+/* Pages never come from the heap: an aligned TLSF block costs twice its size and lands anywhere */
+STATIC UINT8 g_slabRegion[B91_SLAB_REGION_SIZE] __attribute__((aligned(B91_SLAB_PAGE_SIZE)));
+STATIC VOID *g_slabFreePages; /* region pages held by no size class, linked through their first word */
+#endif
+STATIC UINT32 g_heapAllocs;
+STATIC UINT32 g_heapFrees;
+STATIC UINT32 g_heapFails;
+
+#if B91_MALLOC_TRACE && B91_LOG_TOKENIZED
+/* One 12 or 16 byte frame per call, formatted on the host */
+STATIC VOID MallocTrace(CHAR op, const VOID *ptr, size_t size)
+{
+    if (op == 'a') {
+        B91_LOGT("a %08x %u\n", (UINT32)(UINTPTR)ptr, (UINT32)size);
+    } else {
+        B91_LOGT("f %08x\n", (UINT32)(UINTPTR)ptr);
+    }
+}
+#elif B91_MALLOC_TRACE
+/* Straight to the log ring, printf could allocate */
+STATIC VOID MallocTrace(CHAR op, const VOID *ptr, size_t size)
+{
+    CHAR line[MALLOC_TRACE_LINE_MAX];
+    INT32 len;
+
+    if (op == 'a') {
+        len = snprintf(line, sizeof(line), "a %08x %u\n", (UINT32)(UINTPTR)ptr, (UINT32)size);
+    } else {
+        len = snprintf(line, sizeof(line), "f %08x\n", (UINT32)(UINTPTR)ptr);
+    }
+    if (len > 0) {
+        (VOID)B91LogWrite(line, (UINT32)len);
+    }
+}
+#else
+#define MallocTrace(op, ptr, size)
+#endif
+
+#if B91_SLAB
+/* The slab core calls these locked */
+STATIC VOID *SlabPageAlloc(VOID *ctx)
+{
+    VOID *page = g_slabFreePages;
+
+    (VOID)ctx;
+    if (page != NULL) {
+        g_slabFreePages = *(VOID **)page;
+    }
+    return page;
+}
+
+STATIC VOID SlabPageFree(VOID *ctx, VOID *page)
+{
+    (VOID)ctx;
+    *(VOID **)page = g_slabFreePages;
+    g_slabFreePages = page;
+}
+
+/* Called locked */
+STATIC VOID SlabReady(VOID)
+{
+    if (g_slabReady) {
+        return;
+    }
+
+    B91SlabInit(&g_slab, (UINTPTR)g_slabRegion, sizeof(g_slabRegion), SlabPageAlloc, SlabPageFree, NULL);
+    for (UINT32 i = sizeof(g_slabRegion) / B91_SLAB_PAGE_SIZE; i > 0; i--) {
+        SlabPageFree(NULL, &g_slabRegion[(i - 1) * B91_SLAB_PAGE_SIZE]);
+    }
+    g_slabReady = TRUE;
+}
+
+/* Usable size of a slab object, 0 for a heap block */
+STATIC UINT32 SlabObjectSize(const VOID *raw)
+{
+    UINT32 intSave = LOS_IntLock();
+    UINT32 size = g_slabReady ? B91SlabObjectSize(&g_slab, raw) : 0;
+    LOS_IntRestore(intSave);
+    return size;
+}
+#endif
+
+/* Blocks as the slab and the heap see them, the telemetry header included */
+STATIC VOID *BlockAlloc(size_t s)
+{
+    VOID *raw = NULL;
+
+#if B91_SLAB
+    if (s <= B91_SLAB_MAX_SIZE) {
+        UINT32 intSave = LOS_IntLock();
+        SlabReady();
+        raw = B91SlabAlloc(&g_slab, (UINT32)s);
+        LOS_IntRestore(intSave);
+    }
+#endif
+
+    /* Larger blocks, or no page left for the size class */
+    if (raw == NULL) {
+        raw = LOS_MemAlloc(OS_SYS_MEM_ADDR, s);
+        UINT32 intSave = LOS_IntLock();
+        if (raw != NULL) {
+            g_heapAllocs++;
+        } else {
+            g_heapFails++;
+        }
+        LOS_IntRestore(intSave);
+    }
+    return raw;
+}
+
+STATIC VOID BlockFree(VOID *raw)
+{
+#if B91_SLAB
+    UINT32 intSave = LOS_IntLock();
+    BOOL done = g_slabReady && B91SlabFree(&g_slab, raw);
+    if (!done) {
+        g_heapFrees++;
+    }
+    LOS_IntRestore(intSave);
+    if (done) {
+        return;
+    }
+#else
+    UINT32 intSave = LOS_IntLock();
+    g_heapFrees++;
+    LOS_IntRestore(intSave);
+#endif
+
+    (VOID)LOS_MemFree(OS_SYS_MEM_ADDR, raw);
+}
+
+/* Resizes in place where it can, the old block stays valid on failure */
+STATIC VOID *BlockRealloc(VOID *raw, size_t s)
+{
+#if B91_SLAB
+    UINT32 objSize = SlabObjectSize(raw);
+    if (objSize != 0) {
+        if (s <= objSize) {
+            return raw;
+        }
+        VOID *newRaw = BlockAlloc(s);
+        if (newRaw != NULL) {
+            (VOID)memcpy(newRaw, raw, objSize);
+            BlockFree(raw);
+        }
+        return newRaw;
+    }
+#endif
+
+    /* A heap block stays on the heap, also when it shrinks to a slab size */
+    VOID *newRaw = LOS_MemRealloc(OS_SYS_MEM_ADDR, raw, s);
+    if (newRaw == NULL) {
+        UINT32 intSave = LOS_IntLock();
+        g_heapFails++;
+        LOS_IntRestore(intSave);
+    }
+    return newRaw;
+}
+
+#if B91_MEM_TELEMETRY
+STATIC VOID *BlockTag(VOID *raw, size_t size, UINT32 tag)
+{
+    if (raw == NULL) {
+        B91MemTagFail(tag);
+        return NULL;
+    }
+
+    MallocHeader *hdr = (MallocHeader *)raw;
+    hdr->size = (UINT32)size;
+    hdr->tag = (UINT16)tag;
+    hdr->magic = MALLOC_TAG_MAGIC;
+    B91MemTagAlloc(tag, (UINT32)size);
+    return hdr + 1;
+}
+
+/* Returns the block behind ptr, or NULL if its header is not intact */
+STATIC MallocHeader *BlockHeader(VOID *ptr)
+{
+    MallocHeader *hdr = (MallocHeader *)ptr - 1;
+    if (hdr->magic != MALLOC_TAG_MAGIC) {
+        UINT32 intSave = LOS_IntLock();
+        g_badHeaders++;
+        LOS_IntRestore(intSave);
+        return NULL;
+    }
+    return hdr;
+}
+#endif
+
+void *__wrap_malloc(size_t size)
+{
+    if (size == 0) {
+        return NULL;
+    }
+
+#if B91_MEM_TELEMETRY
+    VOID *ptr = BlockTag(BlockAlloc(size + sizeof(MallocHeader)), size, B91MemTagCurrent());
+#else
+    VOID *ptr = BlockAlloc(size);
+#endif
+
+    MallocTrace('a', ptr, size);
+    return ptr;
+}
+
+void __wrap_free(void *ptr)
+{
+    if (ptr == NULL) {
+        return;
+    }
+
+    MallocTrace('f', ptr, 0);
+
+#if B91_MEM_TELEMETRY
+    MallocHeader *hdr = BlockHeader(ptr);
+    if (hdr == NULL) {
+        /* Not from malloc, or freed twice: leaked rather than handed to the heap */
+        return;
+    }
+    hdr->magic = 0;
+    B91MemTagFree(hdr->tag, hdr->size);
+    ptr = hdr;
+#endif
+
+    BlockFree(ptr);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+    if ((size != 0) && (nmemb > SIZE_MAX / size)) {
+        return NULL;
+    }
+
+    VOID *ptr = __wrap_malloc(nmemb * size);
+    if (ptr != NULL) {
+        (VOID)memset(ptr, 0, nmemb * size);
+    }
+    return ptr;
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    if (ptr == NULL) {
+        return __wrap_malloc(size);
+    }
+    if (size == 0) {
+        __wrap_free(ptr);
+        return NULL;
+    }
+
+#if B91_MEM_TELEMETRY
+    MallocHeader *hdr = BlockHeader(ptr);
+    if (hdr == NULL) {
+        /* Not from malloc: the heap must not see a pointer into someone else's block */
+        return NULL;
+    }
+    UINT32 tag = hdr->tag;
+    UINT32 oldSize = hdr->size;
+    MallocHeader *newHdr = (MallocHeader *)BlockRealloc(hdr, size + sizeof(MallocHeader));
+    if (newHdr == NULL) {
+        B91MemTagFail(tag);
+        return NULL;
+    }
+    /* The block keeps the tag of the task that allocated it */
+    B91MemTagFree(tag, oldSize);
+    VOID *newPtr = BlockTag(newHdr, size, tag);
+#else
+    VOID *newPtr = BlockRealloc(ptr, size);
+    if (newPtr == NULL) {
+        return NULL;
+    }
+#endif
+
+    MallocTrace('f', ptr, 0);
+    MallocTrace('a', newPtr, size);
+    return newPtr;
+}
+
+VOID B91MallocGetStats(B91MallocStats *stats)
+{
+    (VOID)memset(stats, 0, sizeof(*stats));
+
+    UINT32 intSave = LOS_IntLock();
+#if B91_SLAB
+    (VOID)memcpy(stats->slab, g_slab.stats, sizeof(stats->slab));
+#endif
+    stats->heapAllocs = g_heapAllocs;
+    stats->heapFrees = g_heapFrees;
+    stats->heapFails = g_heapFails;
+    LOS_IntRestore(intSave);
+}
+
+VOID B91MallocDumpStats(VOID)
+{
+    B91MallocStats stats;
+    B91MallocGetStats(&stats);
+
+#if B91_SLAB
+    printf("size    allocs     frees  in-use  peak  pages  peak  no-page  waste(%%)\r\n");
+    for (UINT32 i = 0; i < B91_SLAB_CLASS_NUM; i++) {
+        const B91SlabClassStats *st = &stats.slab[i];
+        UINT64 handed = (UINT64)st->allocs * st->size;
+        UINT32 waste = (handed != 0) ? (UINT32)(((handed - st->requested) * 100) / handed) : 0;
+        printf("%4u %9u %9u %7u %5u %6u %5u %8u %9u\r\n", st->size, st->allocs, st->frees, st->inUse,
+               st->peakInUse, st->pages, st->peakPages, st->noPage, waste);
+    }
+#endif
+    printf("heap: %u allocs, %u frees, %u failed\r\n", stats.heapAllocs, stats.heapFrees, stats.heapFails);
+#if B91_MEM_TELEMETRY
+    printf("bad block headers on free or realloc: %u\r\n", g_badHeaders);
+#endif
+}
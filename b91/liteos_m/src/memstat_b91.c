@@ -0,0 +1,263 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <los_config.h>
+#include <los_interrupt.h>
+#include <los_memory.h>
+#include <los_task.h>
+#include <los_tick.h>
+#ifdef LOSCFG_SHELL
+#include <shcmd.h>
+#endif
+
+#include <B91/stimer.h>
+
+#include <log_token_b91.h>
+#include <malloc_b91.h>
+#include <memstat_b91.h>
+
+/* Time base of the BLE buffer pool leak ages (myBuf.c): the 64 bit OS tick does not wrap like the stimer */
+UINT32 myBufDiagTimeMs(VOID)
+{
+    return (UINT32)((LOS_TickCountGet() * 1000) / LOSCFG_BASE_CORE_TICK_PER_SECOND);
+}
+
+#if B91_MEM_TELEMETRY
+
+#define MEM_TAG_NUM  (LOSCFG_BASE_CORE_TSK_LIMIT + 2)
+#define MEM_TAG_NONE (LOSCFG_BASE_CORE_TSK_LIMIT + 1)
+
+typedef struct {
+    UINT32 inUse; /* bytes */
+    UINT32 peak;
+    UINT32 allocs;
+    UINT32 frees;
+    UINT32 fails;
+} MemTag;
+
+typedef struct {
+    UINT32 seconds;
+    UINT32 freeSize;
+    UINT32 maxFreeNode;
+    UINT32 freeNodes;
+    UINT32 usedNodes;
+} MemSample;
+
+/* The BLE stack buffer heap, when linked in */
+extern unsigned int myHeapCountUsed(VOID) __attribute__((weak));
+extern unsigned int myHeapCountAvailable(VOID) __attribute__((weak));
+
+STATIC MemTag g_memTags[MEM_TAG_NUM];
+
+STATIC MemSample g_memHistory[B91_MEM_HISTORY];
+STATIC UINT32 g_memSamples;
+STATIC UINT32 g_memSeconds; /* stimer wraps, so the sample time is kept by adding up the periods */
+STATIC UINT32 g_memLastTick;
+STATIC MemSample g_memLow; /* lowest free size, largest free block, highest free block count */
+STATIC BOOL g_memWarned;
+
+UINT32 B91MemTagCurrent(VOID)
+{
+    UINT32 id = LOS_CurTaskIDGet();
+    return (id < MEM_TAG_NONE) ? id : MEM_TAG_NONE;
+}
+
+VOID B91MemTagAlloc(UINT32 tag, UINT32 size)
+{
+    UINT32 intSave = LOS_IntLock();
+    MemTag *t = &g_memTags[(tag < MEM_TAG_NUM) ? tag : MEM_TAG_NONE];
+    t->allocs++;
+    t->inUse += size;
+    if (t->inUse > t->peak) {
+        t->peak = t->inUse;
+    }
+    LOS_IntRestore(intSave);
+}
+
+VOID B91MemTagFree(UINT32 tag, UINT32 size)
+{
+    UINT32 intSave = LOS_IntLock();
+    MemTag *t = &g_memTags[(tag < MEM_TAG_NUM) ? tag : MEM_TAG_NONE];
+    t->frees++;
+    t->inUse -= (size < t->inUse) ? size : t->inUse;
+    LOS_IntRestore(intSave);
+}
+
+VOID B91MemTagFail(UINT32 tag)
+{
+    UINT32 intSave = LOS_IntLock();
+    g_memTags[(tag < MEM_TAG_NUM) ? tag : MEM_TAG_NONE].fails++;
+    LOS_IntRestore(intSave);
+}
+
+STATIC VOID MemSampleTake(MemSample *sample)
+{
+    LOS_MEM_POOL_STATUS status = {0};
+    (VOID)LOS_MemInfoGet(OS_SYS_MEM_ADDR, &status);
+
+    UINT32 intSave = LOS_IntLock();
+    UINT32 now = stimer_get_tick();
+    g_memSeconds += (now - g_memLastTick) / SYSTEM_TIMER_TICK_1S;
+    /* Keep the remainder of the second for the next sample */
+    g_memLastTick = now - ((now - g_memLastTick) % SYSTEM_TIMER_TICK_1S);
+
+    sample->seconds = g_memSeconds;
+    sample->freeSize = status.totalFreeSize;
+    sample->maxFreeNode = status.maxFreeNodeSize;
+    sample->freeNodes = status.freeNodeNum;
+    sample->usedNodes = status.usedNodeNum;
+
+    if ((g_memSamples == 0) || (sample->freeSize < g_memLow.freeSize)) {
+        g_memLow.freeSize = sample->freeSize;
+    }
+    if ((g_memSamples == 0) || (sample->maxFreeNode < g_memLow.maxFreeNode)) {
+        g_memLow.maxFreeNode = sample->maxFreeNode;
+    }
+    if (sample->freeNodes > g_memLow.freeNodes) {
+        g_memLow.freeNodes = sample->freeNodes;
+    }
+    g_memHistory[g_memSamples % B91_MEM_HISTORY] = *sample;
+    g_memSamples++;
+    LOS_IntRestore(intSave);
+}
+
+/* Share of the free bytes not in the largest free block, in percent */
+STATIC UINT32 MemFragmentation(const MemSample *sample)
+{
+    if (sample->freeSize == 0) {
+        return 0;
+    }
+    return ((sample->freeSize - sample->maxFreeNode) * 100) / sample->freeSize;
+}
+
+STATIC VOID MemTelemetryTask(VOID)
+{
+    while (1) {
+        MemSample sample;
+        MemSampleTake(&sample);
+
+        if ((sample.maxFreeNode < B91_MEM_WARN_LARGEST) && !g_memWarned) {
+            B91_LOGT("mem: largest free block %u bytes of %u free, %u free blocks\r\n", sample.maxFreeNode,
+                     sample.freeSize, sample.freeNodes);
+            g_memWarned = TRUE;
+        } else if (sample.maxFreeNode >= B91_MEM_WARN_LARGEST) {
+            g_memWarned = FALSE;
+        }
+
+        LOS_Msleep(B91_MEM_SAMPLE_MS);
+    }
+}
+
+VOID B91MemTelemetryDump(VOID)
+{
+    STATIC MemTag tags[MEM_TAG_NUM];
+    MemSample history[B91_MEM_HISTORY];
+    MemSample now;
+    MemSample low;
+
+    MemSampleTake(&now);
+
+    UINT32 intSave = LOS_IntLock();
+    (VOID)memcpy(tags, g_memTags, sizeof(tags));
+    (VOID)memcpy(history, g_memHistory, sizeof(history));
+    UINT32 samples = g_memSamples;
+    low = g_memLow;
+    LOS_IntRestore(intSave);
+
+    printf("heap: %u free, largest %u, %u free / %u used blocks, %u%% fragmented\r\n", now.freeSize,
+           now.maxFreeNode, now.freeNodes, now.usedNodes, MemFragmentation(&now));
+    printf("low-water: %u free, largest %u, at most %u free blocks\r\n", low.freeSize, low.maxFreeNode,
+           low.freeNodes);
+
+    printf("time(s)     free  largest  free-blocks  frag(%%)\r\n");
+    UINT32 first = (samples > B91_MEM_HISTORY) ? (samples - B91_MEM_HISTORY) : 0;
+    for (UINT32 i = first; i < samples; i++) {
+        const MemSample *s = &history[i % B91_MEM_HISTORY];
+        B91_LOGT("%7u %8u %8u %12u %8u\r\n", s->seconds, s->freeSize, s->maxFreeNode, s->freeNodes,
+                 MemFragmentation(s));
+    }
+
+    printf("task              in-use     peak    allocs     frees  fails\r\n");
+    for (UINT32 i = 0; i < MEM_TAG_NUM; i++) {
+        const MemTag *t = &tags[i];
+        if (t->allocs == 0) {
+            continue;
+        }
+        TSK_INFO_S info;
+        const CHAR *name = "-";
+        if ((i != MEM_TAG_NONE) && (LOS_TaskInfoGet(i, &info) == LOS_OK)) {
+            name = info.acName;
+        }
+        printf("%-16s %8u %8u %9u %9u %6u\r\n", name, t->inUse, t->peak, t->allocs, t->frees, t->fails);
+    }
+
+    if ((myHeapCountUsed != NULL) && (myHeapCountAvailable != NULL)) {
+        printf("ble myHeap: %u used, %u available\r\n", myHeapCountUsed(), myHeapCountAvailable());
+    }
+
+    B91MallocDumpStats();
+    (VOID)LOS_MemFreeNodeShow(OS_SYS_MEM_ADDR);
+}
+
+#ifdef LOSCFG_SHELL
+STATIC UINT32 MemTelemetryShellCmd(UINT32 argc, const CHAR **argv)
+{
+    (VOID)argc;
+    (VOID)argv;
+
+    B91MemTelemetryDump();
+    return LOS_OK;
+}
+#endif /* LOSCFG_SHELL */
+
+UINT32 B91MemTelemetryInit(VOID)
+{
+    g_memLastTick = stimer_get_tick();
+
+    UINT32 taskId;
+    TSK_INIT_PARAM_S task = {0};
+    task.pfnTaskEntry = (TSK_ENTRY_FUNC)MemTelemetryTask;
+    task.uwStackSize = B91_MEM_TASK_STACKSIZE;
+    task.pcName = "B91MemStat";
+    task.usTaskPrio = B91_MEM_TASK_PRIO;
+    UINT32 ret = LOS_TaskCreate(&taskId, &task);
+    if (ret != LOS_OK) {
+        return ret;
+    }
+
+#ifdef LOSCFG_SHELL
+    (VOID)osCmdReg(CMD_TYPE_EX, "memstat", XARGS, (CmdCallBackFunc)MemTelemetryShellCmd);
+#endif
+    return LOS_OK;
+}
+
+#else /* B91_MEM_TELEMETRY */
+
+UINT32 B91MemTelemetryInit(VOID)
+{
+    return LOS_OK;
+}
+
+VOID B91MemTelemetryDump(VOID)
+{
+}
+
+#endif /* B91_MEM_TELEMETRY */
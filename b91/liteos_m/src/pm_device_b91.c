@@ -0,0 +1,153 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+
+#include <los_interrupt.h>
+
+#include <pm_device_b91.h>
+#include <pm_governor_b91.h>
+
+#define PM_DEVICE_IDLE       0
+#define PM_DEVICE_BUSY_UNTIL 1
+#define PM_DEVICE_BUSY       2
+
+STATIC B91PmDevice *g_pmDevices[B91_PM_DEVICE_MAX];
+STATIC UINT32 g_pmDeviceNum;
+/* Devices prepared by the last B91PmDevicesPrepare(), resumed in reverse order */
+STATIC UINT32 g_pmDevicePrepared;
+
+UINT32 B91PmDeviceRegister(B91PmDevice *dev)
+{
+    UINT32 ret = LOS_OK;
+
+    if (dev == NULL) {
+        return LOS_NOK;
+    }
+
+    UINT32 intSave = LOS_IntLock();
+    for (UINT32 i = 0; i < g_pmDeviceNum; i++) {
+        if (g_pmDevices[i] == dev) {
+            LOS_IntRestore(intSave);
+            return LOS_OK;
+        }
+    }
+
+    if (g_pmDeviceNum < B91_PM_DEVICE_MAX) {
+        dev->state = PM_DEVICE_IDLE;
+        dev->vetoes = 0;
+        g_pmDevices[g_pmDeviceNum++] = dev;
+    } else {
+        ret = LOS_NOK;
+    }
+    LOS_IntRestore(intSave);
+
+    return ret;
+}
+
+VOID B91PmDeviceUnregister(B91PmDevice *dev)
+{
+    UINT32 intSave = LOS_IntLock();
+    for (UINT32 i = 0; i < g_pmDeviceNum; i++) {
+        if (g_pmDevices[i] == dev) {
+            for (; (i + 1) < g_pmDeviceNum; i++) {
+                g_pmDevices[i] = g_pmDevices[i + 1];
+            }
+            g_pmDeviceNum--;
+            break;
+        }
+    }
+    LOS_IntRestore(intSave);
+}
+
+VOID B91PmDeviceBusyUntil(B91PmDevice *dev, UINT32 stimerTick)
+{
+    UINT32 intSave = LOS_IntLock();
+    dev->busyUntil = stimerTick;
+    dev->state = PM_DEVICE_BUSY_UNTIL;
+    LOS_IntRestore(intSave);
+}
+
+VOID B91PmDeviceBusy(B91PmDevice *dev)
+{
+    dev->state = PM_DEVICE_BUSY;
+}
+
+VOID B91PmDeviceIdle(B91PmDevice *dev)
+{
+    dev->state = PM_DEVICE_IDLE;
+}
+
+UINT32 B91PmDevicesBusyFor(UINT32 now)
+{
+    UINT32 busyFor = 0;
+
+    for (UINT32 i = 0; i < g_pmDeviceNum; i++) {
+        B91PmDevice *dev = g_pmDevices[i];
+        if (dev->state == PM_DEVICE_BUSY) {
+            return B91_PM_BUSY_FOREVER;
+        }
+        if (dev->state != PM_DEVICE_BUSY_UNTIL) {
+            continue;
+        }
+
+        INT32 left = (INT32)(dev->busyUntil - now);
+        if (left <= 0) {
+            dev->state = PM_DEVICE_IDLE;
+        } else if ((UINT32)left > busyFor) {
+            busyFor = (UINT32)left;
+        }
+    }
+
+    return busyFor;
+}
+
+UINT32 B91PmDevicesPrepare(UINT32 mode)
+{
+    for (g_pmDevicePrepared = 0; g_pmDevicePrepared < g_pmDeviceNum; g_pmDevicePrepared++) {
+        B91PmDevice *dev = g_pmDevices[g_pmDevicePrepared];
+        if ((dev->prepare != NULL) && (dev->prepare(dev, mode) != LOS_OK)) {
+            dev->vetoes++;
+            B91PmDevicesResume(B91_PM_MODE_WFI);
+            return LOS_NOK;
+        }
+    }
+
+    return LOS_OK;
+}
+
+VOID B91PmDevicesResume(UINT32 mode)
+{
+    while (g_pmDevicePrepared > 0) {
+        B91PmDevice *dev = g_pmDevices[--g_pmDevicePrepared];
+        if (dev->resume != NULL) {
+            dev->resume(dev, mode);
+        }
+    }
+}
+
+VOID B91PmDevicesDump(VOID)
+{
+    STATIC const CHAR *const states[] = {"idle", "busy-until", "busy"};
+
+    printf("pm device      state        vetoes\r\n");
+    for (UINT32 i = 0; i < g_pmDeviceNum; i++) {
+        B91PmDevice *dev = g_pmDevices[i];
+        printf("%-14s %-12s %6u\r\n", (dev->name != NULL) ? dev->name : "?", states[dev->state], dev->vetoes);
+    }
+}
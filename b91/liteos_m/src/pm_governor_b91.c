@@ -0,0 +1,100 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+#include <string.h>
+
+#include <pm_governor_b91.h>
+
+#define PM_EWMA_SHIFT       3
+#define PM_RESIDENCY_FACTOR 2
+
+static const B91PmModeParam g_pmDefaultParam[B91_PM_MODE_NUM] = {
+    [B91_PM_MODE_WFI] = {true, 0, 0, B91_PM_CURRENT_WFI_UA},
+    [B91_PM_MODE_SUSPEND] = {true, 1000, 400, B91_PM_CURRENT_SUSPEND_UA},
+    [B91_PM_MODE_DEEP_RET] = {false, 10000, 2000, B91_PM_CURRENT_DEEP_RET_UA},
+};
+
+static inline uint32_t PmEwma(uint32_t avg, uint32_t sample)
+{
+    return (uint32_t)((int32_t)avg + (((int32_t)sample - (int32_t)avg) >> PM_EWMA_SHIFT));
+}
+
+/* Charge spent idling predictedUs in the mode, including the active current paid while waking up */
+static uint64_t PmCharge(const B91PmModeParam *param, uint32_t predictedUs)
+{
+    return (uint64_t)predictedUs * param->currentUa + (uint64_t)param->exitLatencyUs * B91_PM_CURRENT_ACTIVE_UA;
+}
+
+void B91PmGovernorInit(B91PmGovernor *gov)
+{
+    (void)memset(gov, 0, sizeof(*gov));
+    (void)memcpy(gov->param, g_pmDefaultParam, sizeof(gov->param));
+    gov->accuracy = B91_PM_ACCURACY_ONE;
+}
+
+B91PmMode B91PmGovernorSelect(const B91PmGovernor *gov, uint32_t idleUs, uint32_t allowed)
+{
+    uint32_t predicted = (uint32_t)(((uint64_t)idleUs * gov->accuracy) / B91_PM_ACCURACY_ONE);
+
+    B91PmMode best = B91_PM_MODE_WFI;
+    uint64_t bestCharge = PmCharge(&gov->param[B91_PM_MODE_WFI], predicted);
+
+    for (int mode = B91_PM_MODE_WFI + 1; mode < B91_PM_MODE_NUM; mode++) {
+        const B91PmModeParam *param = &gov->param[mode];
+        if (!param->enabled || ((allowed & B91_PM_MODE_MASK(mode)) == 0)) {
+            continue;
+        }
+        if (predicted < param->minResidencyUs || predicted < param->exitLatencyUs * PM_RESIDENCY_FACTOR) {
+            continue;
+        }
+
+        uint64_t charge = PmCharge(param, predicted);
+        if (charge < bestCharge) {
+            best = (B91PmMode)mode;
+            bestCharge = charge;
+        }
+    }
+
+    return best;
+}
+
+void B91PmGovernorUpdate(B91PmGovernor *gov, B91PmMode mode, uint32_t expectedUs, uint32_t actualUs,
+                         uint32_t exitLatencyUs)
+{
+    B91PmModeParam *param = &gov->param[mode];
+    B91PmModeStats *stats = &gov->stats[mode];
+
+    if (exitLatencyUs != 0) {
+        param->exitLatencyUs = PmEwma(param->exitLatencyUs, exitLatencyUs);
+    }
+
+    stats->entries++;
+    stats->residencyUs += actualUs;
+    stats->chargeUaUs += (uint64_t)actualUs * param->currentUa + (uint64_t)exitLatencyUs * B91_PM_CURRENT_ACTIVE_UA;
+
+    if (expectedUs == 0) {
+        return;
+    }
+    if (actualUs < expectedUs / 2) {
+        stats->earlyWakeups++;
+    }
+
+    uint32_t ratio = (actualUs >= expectedUs) ? B91_PM_ACCURACY_ONE
+                                              : (uint32_t)(((uint64_t)actualUs * B91_PM_ACCURACY_ONE) / expectedUs);
+    gov->accuracy = PmEwma(gov->accuracy, ratio);
+}
@@ -33,12 +33,24 @@
 
 #include <stack/ble/ble.h>
 
+#include <clocksync_b91.h>
+#include <deepret_b91.h>
+#include <defer_b91.h>
+#include <dvfs_b91.h>
+#include <energy_b91.h>
+#include <log_b91.h>
+#include <log_token_b91.h>
+#include <pm_device_b91.h>
+#include <power_b91.h>
+
 #include <inttypes.h>
 
 #define SYSTICKS_MAX_SLEEP     (0xFFFFFFFF >> 2)
 #define MTICKS_MIN_SLEEP       (80)
-#define MTICKS_CORRECTION_TIME (0)
-#define MTICKS_RESERVE_TIME    (1 + MTICKS_CORRECTION_TIME)
+#define MTICKS_RESERVE_TIME    (1)
+
+/* Stimer ticks per 32k tick for an exact 32768 Hz, in 16.16 fixed point */
+#define RC32K_NOMINAL_Q16 ((UINT32)(((UINT64)SYSTEM_TIMER_TICK_1S << 16) / 32768))
 
 bool B91_system_suspend(UINT32 wake_stimer_tick);
 
@@ -47,9 +59,9 @@ static inline UINT64 MticksToSysticks(UINT64 mticks)
     return (mticks * SYSTEM_TIMER_TICK_1S) / OS_SYS_CLOCK;
 }
 
-static inline UINT32 SysticksToMticks(UINT32 sticks)
+static inline UINT64 SysticksToMticks(UINT64 systicks)
 {
-    return (UINT32)((UINT64)sticks * OS_SYS_CLOCK / SYSTEM_TIMER_TICK_1S);
+    return (systicks * OS_SYS_CLOCK) / SYSTEM_TIMER_TICK_1S;
 }
 
 static UINT32 B91Suspend(VOID);
@@ -67,6 +79,13 @@ static inline void SetMtime(UINT64 time)
     HalIrqEnable(RISCV_MACH_TIMER_IRQ);
 }
 
+static inline void SetMtimeCompare(UINT64 time)
+{
+    WRITE_UINT32(U32_MAX, MTIMERCMP + MTIMER_HI_OFFSET);
+    WRITE_UINT32((UINT32)time, MTIMERCMP);
+    WRITE_UINT32((UINT32)(time >> SHIFT_32_BIT), MTIMERCMP + MTIMER_HI_OFFSET);
+}
+
 static inline UINT64 GetMtimeCompare(void)
 {
     return *(volatile UINT64 *)(MTIMERCMP);
@@ -84,6 +103,193 @@ static inline UINT64 GetMtime(void)
     return (((UINT64)mtimeH) << SHIFT_32_BIT) | mtimeL;
 }
 
+#ifndef B91_CLOCK_SYNC_RC_TRIM_PPM
+#define B91_CLOCK_SYNC_RC_TRIM_PPM 500
+#endif
+
+STATIC B91PmGovernor g_pmGovernor;
+STATIC B91ClockSync g_clockSync;
+
+#if B91_PM_TRACE && B91_LOG_TOKENIZED
+#define B91PmTrace(expectedUs, actualUs) B91_LOGT("%u %u\n", (expectedUs), (actualUs))
+#elif B91_PM_TRACE
+/* One "<expected_us> <actual_us>" line per idle period for util/b91_pm_replay.c, straight to the log ring */
+_attribute_ram_code_ STATIC VOID B91PmTrace(UINT32 expectedUs, UINT32 actualUs)
+{
+    CHAR line[24];
+    INT32 len = snprintf(line, sizeof(line), "%u %u\n", expectedUs, actualUs);
+    if (len > 0) {
+        (VOID)B91LogWrite(line, (UINT32)len);
+    }
+}
+#else
+#define B91PmTrace(expectedUs, actualUs)
+#endif
+
+/* stimer and 32k timer at the end of the last sleep, start of the current active period */
+STATIC UINT32 g_wakeStimer;
+STATIC UINT32 g_wake32k;
+STATIC BOOL g_rcTrimPosted;
+
+typedef struct {
+    UINT64 mtick;
+    UINT32 stimer;
+    UINT32 rc32k;
+} B91SleepStamp;
+
+/*
+ * Runs in the defer task: clock_cal_32k_rc() busy-waits from flash for the length of the trim, which must
+ * not happen in the idle path with interrupts locked. The idle task can not run meanwhile, the lock only
+ * keeps the restart consistent with the wake-up stamps.
+ */
+STATIC VOID B91RcTrim(VOID *arg, UINT32 data)
+{
+    (VOID)arg;
+    (VOID)data;
+
+    clock_cal_32k_rc();
+
+    UINT32 intSave = LOS_IntLock();
+    g_clockSync.stimerPer32kQ16 = 0;
+    B91ClockSyncRestartCalibration(&g_clockSync);
+    /* The active period that spans the trim mixes two RC frequencies, start a new one */
+    g_wakeStimer = stimer_get_tick();
+    g_wake32k = clock_get_32k_tick();
+    g_rcTrimPosted = FALSE;
+    LOS_IntRestore(intSave);
+}
+
+/**
+ * @brief      Samples the timers right before sleeping and accounts the active period that ends here
+ *             for the 32k calibration. If the 32k RC has drifted too far from nominal a trim is queued
+ *             to the defer task.
+ */
+_attribute_ram_code_ STATIC VOID B91SleepStampTake(B91SleepStamp *stamp)
+{
+    stamp->stimer = stimer_get_tick();
+    stamp->rc32k = clock_get_32k_tick();
+    stamp->mtick = GetMtime();
+
+    UINT32 calibrations = g_clockSync.calibrations;
+    B91ClockSyncActive(&g_clockSync, stamp->stimer - g_wakeStimer, stamp->rc32k - g_wake32k);
+    if ((g_clockSync.calibrations == calibrations) || g_rcTrimPosted) {
+        return;
+    }
+
+    INT32 offset = (INT32)(g_clockSync.stimerPer32kQ16 - RC32K_NOMINAL_Q16);
+    UINT32 limit = (UINT32)(((UINT64)RC32K_NOMINAL_Q16 * B91_CLOCK_SYNC_RC_TRIM_PPM) / 1000000);
+    if ((UINT32)((offset < 0) ? -offset : offset) > limit) {
+        /* Sleeps keep using the current estimate until the trim has run */
+        g_rcTrimPosted = (B91DeferPost(B91_DEFER_PRIO_LOW, B91RcTrim, NULL, 0) == LOS_OK);
+    }
+}
+
+/**
+ * @brief      Advances mtime by the time slept since the stamp.
+ * @return     sleep length in stimer ticks.
+ */
+_attribute_ram_code_ STATIC UINT32 B91SleepResync(const B91SleepStamp *stamp)
+{
+    UINT32 now = stimer_get_tick();
+    UINT32 now32k = clock_get_32k_tick();
+
+    UINT32 span = B91ClockSyncSleepSpan(&g_clockSync, now - stamp->stimer, now32k - stamp->rc32k);
+    SetMtime(stamp->mtick + B91ClockSyncToMticks(&g_clockSync, span));
+    B91ClockSyncTuneCorrection(&g_clockSync, stimer_get_tick() - now);
+
+    g_wakeStimer = now;
+    g_wake32k = now32k;
+    return span;
+}
+
+STATIC UINT32 B91PmAllowedModes(UINT64 mticksIdle)
+{
+    if (mticksIdle < MTICKS_MIN_SLEEP + MTICKS_RESERVE_TIME) {
+        return B91_PM_MODE_MASK(B91_PM_MODE_WFI);
+    }
+
+    /* The link layer keeps radio timing state in hardware that deep retention does not keep */
+    extern bool blc_ll_isBleTaskIdle(void);
+    if (!blc_ll_isBleTaskIdle()) {
+        return B91_PM_MODE_MASK_ALL & ~B91_PM_MODE_MASK(B91_PM_MODE_DEEP_RET);
+    }
+
+    return B91_PM_MODE_MASK_ALL;
+}
+
+/**
+ * @brief      Waits for an interrupt.
+ * @param[in]  expectedUs - expected idle time.
+ * @param[in]  mcompare   - if not 0, an earlier machine timer compare value to wake up at. The OS one is
+ *                          restored before returning, so that the early wake-up only ends the WFI.
+ */
+_attribute_ram_code_ STATIC VOID B91IdleWfi(UINT32 expectedUs, UINT64 mcompare)
+{
+    UINT64 osCompare = GetMtimeCompare();
+    UINT32 start = stimer_get_tick();
+    if (mcompare != 0) {
+        SetMtimeCompare(mcompare);
+    }
+    __asm__ volatile("wfi");
+    if (mcompare != 0) {
+        SetMtimeCompare(osCompare);
+    }
+    UINT32 actualUs = (stimer_get_tick() - start) / SYSTEM_TIMER_TICK_1US;
+
+    B91PmGovernorUpdate(&g_pmGovernor, B91_PM_MODE_WFI, expectedUs, actualUs, 0);
+}
+
+_attribute_ram_code_ STATIC BOOL B91IdleSuspend(UINT64 mticksIdle, UINT32 expectedUs, UINT32 *slept)
+{
+    UINT64 systicksSleepTimeout = MticksToSysticks(mticksIdle);
+    if (systicksSleepTimeout > SYSTICKS_MAX_SLEEP) {
+        systicksSleepTimeout = SYSTICKS_MAX_SLEEP;
+    }
+    blc_pm_setWakeupSource(PM_WAKEUP_PAD);
+
+    B91SleepStamp stamp;
+    B91SleepStampTake(&stamp);
+    UINT32 wakeTick = stamp.stimer + systicksSleepTimeout - MTICKS_RESERVE_TIME;
+    if (B91_system_suspend(wakeTick)) {
+        UINT32 now = stimer_get_tick();
+        *slept = B91SleepResync(&stamp);
+
+        /* Time from the programmed wake-up to running again, only known when the timer woke us */
+        UINT32 late = now - wakeTick;
+        UINT32 exitLatencyUs = ((INT32)late >= 0) ? (late / SYSTEM_TIMER_TICK_1US) : 0;
+        B91PmGovernorUpdate(&g_pmGovernor, B91_PM_MODE_SUSPEND, expectedUs, *slept / SYSTEM_TIMER_TICK_1US,
+                            exitLatencyUs);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+_attribute_ram_code_ STATIC BOOL B91IdleDeepRet(UINT64 mticksIdle, UINT32 expectedUs, UINT32 *slept)
+{
+    UINT64 mcompare = GetMtimeCompare();
+    UINT64 systicksSleepTimeout = MticksToSysticks(mticksIdle);
+    if (systicksSleepTimeout > SYSTICKS_MAX_SLEEP) {
+        systicksSleepTimeout = SYSTICKS_MAX_SLEEP;
+    }
+
+    B91SleepStamp stamp;
+    B91SleepStampTake(&stamp);
+    UINT32 wakeTick = stamp.stimer + systicksSleepTimeout - MTICKS_RESERVE_TIME;
+    if (B91DeepRetSleep(wakeTick)) {
+        /* The machine timer restarted with the core, the stimer was restored from the 32k timer */
+        UINT32 now = stimer_get_tick();
+        SetMtimeCompare(mcompare);
+        *slept = B91SleepResync(&stamp);
+
+        UINT32 late = now - wakeTick;
+        UINT32 exitLatencyUs = ((INT32)late >= 0) ? (late / SYSTEM_TIMER_TICK_1US) : 0;
+        B91PmGovernorUpdate(&g_pmGovernor, B91_PM_MODE_DEEP_RET, expectedUs, *slept / SYSTEM_TIMER_TICK_1US,
+                            exitLatencyUs);
+        return TRUE;
+    }
+    return FALSE;
+}
+
 /**
  * @brief      	This function is used instead of the default sleep function
  * ArchEnterSleep()
@@ -92,46 +298,100 @@ static inline UINT64 GetMtime(void)
  */
 _attribute_ram_code_ static UINT32 B91Suspend(VOID)
 {
+    UINT32 intSave = LOS_IntLock();
+    B91DvfsIdleEnter();
+    B91EnergyIdleEnter();
+
     UINT64 mcompare = GetMtimeCompare();
     UINT64 mtick = GetMtime();
-    if ((mcompare - mtick) < (MTICKS_MIN_SLEEP + MTICKS_RESERVE_TIME)) {
-        return 0;
-    }
-
-    while (uart_tx_is_busy(UART0) || uart_tx_is_busy(UART1)) {
-        LOS_Msleep(1);
-    }
+    UINT64 mticksIdle = (mcompare > mtick) ? (mcompare - mtick) : 0;
+    UINT64 usIdle = MticksToSysticks(mticksIdle) / SYSTEM_TIMER_TICK_1US;
+    UINT32 expectedUs = (usIdle > U32_MAX) ? U32_MAX : (UINT32)usIdle;
 
-    UINT32 intSave = LOS_IntLock();
-    mcompare = GetMtimeCompare();
-    mtick = GetMtime();
-    if ((mcompare - mtick) < MTICKS_MIN_SLEEP + MTICKS_RESERVE_TIME) {
+    /* While a device is busy stay in WFI, until it is expected done if that comes before the OS timer */
+    UINT32 busyFor = B91PmDevicesBusyFor(stimer_get_tick());
+    if (busyFor != 0) {
+        UINT64 mcompareBusy = 0;
+        if ((busyFor != B91_PM_BUSY_FOREVER) && (busyFor < MticksToSysticks(mticksIdle))) {
+            mcompareBusy = mtick + SysticksToMticks(busyFor) + 1;
+            expectedUs = busyFor / SYSTEM_TIMER_TICK_1US;
+        }
+        B91IdleWfi(expectedUs, mcompareBusy);
+        B91EnergyIdleExit(0);
+        B91DvfsIdleExit();
         LOS_IntRestore(intSave);
         return 0;
     }
 
-    UINT64 systicksSleepTimeout = MticksToSysticks(mcompare - mtick);
-    if (systicksSleepTimeout > SYSTICKS_MAX_SLEEP) {
-        systicksSleepTimeout = SYSTICKS_MAX_SLEEP;
+    UINT32 mode = B91PmGovernorSelect(&g_pmGovernor, expectedUs, B91PmAllowedModes(mticksIdle));
+    if ((mode != B91_PM_MODE_WFI) && (B91PmDevicesPrepare(mode) != LOS_OK)) {
+        mode = B91_PM_MODE_WFI;
     }
-    blc_pm_setWakeupSource(PM_WAKEUP_PAD);
 
-    UINT32 sleepTick = stimer_get_tick();
-    if (B91_system_suspend(sleepTick + systicksSleepTimeout - MTICKS_RESERVE_TIME)) {
-        UINT32 span = SysticksToMticks(stimer_get_tick() - sleepTick) + MTICKS_CORRECTION_TIME;
-        mtick += span;
-        SetMtime(mtick);
-        uart_clr_tx_index(UART0);
-        uart_clr_tx_index(UART1);
-        uart_clr_rx_index(UART0);
-        uart_clr_rx_index(UART1);
+    UINT32 slept = 0;
+#if B91_PM_TRACE
+    UINT32 idleStart = stimer_get_tick();
+#endif
+    switch (mode) {
+        case B91_PM_MODE_SUSPEND:
+            B91PmDevicesResume(B91IdleSuspend(mticksIdle, expectedUs, &slept) ? mode : B91_PM_MODE_WFI);
+            break;
+        case B91_PM_MODE_DEEP_RET:
+            B91PmDevicesResume(B91IdleDeepRet(mticksIdle, expectedUs, &slept) ? mode : B91_PM_MODE_WFI);
+            break;
+        default:
+            B91IdleWfi(expectedUs, 0);
+            break;
     }
+    B91PmTrace(expectedUs, (stimer_get_tick() - idleStart) / SYSTEM_TIMER_TICK_1US);
+    B91EnergyIdleExit(slept);
+    B91DvfsIdleExit();
+
     LOS_IntRestore(intSave);
     return 0;
 }
 
+VOID B91PmGetGovernor(B91PmGovernor *gov)
+{
+    UINT32 intSave = LOS_IntLock();
+    *gov = g_pmGovernor;
+    LOS_IntRestore(intSave);
+}
+
+VOID B91PmDumpStats(VOID)
+{
+    STATIC const CHAR *const names[B91_PM_MODE_NUM] = {"wfi", "suspend", "deep-ret"};
+    B91PmGovernor gov;
+
+    B91PmGetGovernor(&gov);
+    printf("mode      entries  early  residency(ms)  charge(uAh)  exit(us)\r\n");
+    for (UINT32 i = 0; i < B91_PM_MODE_NUM; i++) {
+        printf("%-8s %8u %6u %14u %12u %9u\r\n", names[i], gov.stats[i].entries, gov.stats[i].earlyWakeups,
+               (UINT32)(gov.stats[i].residencyUs / 1000), (UINT32)(gov.stats[i].chargeUaUs / 3600000000ULL),
+               gov.param[i].exitLatencyUs);
+    }
+
+    B91ClockSync cs;
+    UINT32 intSave = LOS_IntLock();
+    cs = g_clockSync;
+    LOS_IntRestore(intSave);
+    printf("clock sync: %u resyncs, 32k = %u/65536 stimer ticks (%u samples), correction %u ticks, "
+           "32k vs restored stimer %d us\r\n",
+           cs.resyncs, cs.stimerPer32kQ16, cs.calibrations, cs.correction,
+           (INT32)(cs.rcMinusStimer / SYSTEM_TIMER_TICK_1US));
+
+    B91PmDevicesDump();
+    B91DvfsDumpStats();
+}
+
 VOID B91SuspendSleepInit(VOID)
 {
+    B91PmGovernorInit(&g_pmGovernor);
+    B91ClockSyncInit(&g_clockSync, OS_SYS_CLOCK, SYSTEM_TIMER_TICK_1S);
+    g_wakeStimer = stimer_get_tick();
+    g_wake32k = clock_get_32k_tick();
+    g_pmGovernor.param[B91_PM_MODE_DEEP_RET].enabled = B91DeepRetAvailable();
+
     UINT32 ret = LOS_PmRegister(LOS_PM_TYPE_SYSCTRL, &g_sysctrl);
     if (ret != LOS_OK) {
         printf("Ret of PMRegister = %#x\r\n", ret);
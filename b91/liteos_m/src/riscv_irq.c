@@ -17,6 +17,7 @@
  *****************************************************************************/
 
 #include <stdio.h>
+#include <string.h>
 
 #include <soc.h>
 #include <target_config.h>
@@ -28,6 +29,13 @@
 
 #include <B91/plic.h>
 
+#include <b91_irq.h>
+#include <log_token_b91.h>
+
+#if B91_IRQ_PROFILE && defined(LOSCFG_SHELL)
+#include <shcmd.h>
+#endif
+
 #define PLIC_IRQ_LIMIT 64
 
 typedef VOID (*HwiProcFunc)(VOID *arg);
@@ -37,6 +45,71 @@ VOID default_irq_handler(VOID);
 STATIC HWI_HANDLE_FORM_S irq_handlers[PLIC_IRQ_LIMIT] = {
     [0 ...(PLIC_IRQ_LIMIT - 1)] = {(HWI_PROC_FUNC)default_irq_handler, NULL, 0}};
 
+/* Priorities applied by B91IrqInit(), other sources keep their reset priority until registered */
+STATIC const UINT8 g_irqDefaultPrio[][2] = {
+    {IRQ15_ZB_RT, B91_IRQ_PRIO_RADIO},
+    {IRQ1_SYSTIMER, B91_IRQ_PRIO_RADIO},
+    {IRQ3_TIMER1, B91_IRQ_PRIO_TIMER},
+    {IRQ4_TIMER0, B91_IRQ_PRIO_TIMER},
+};
+
+#if B91_IRQ_PROFILE
+STATIC B91IrqProfile g_irqProfile[PLIC_IRQ_LIMIT];
+/* mcycle at which the trap first saw each source pending, valid while its bit is set in the caller's seen mask */
+STATIC UINT32 g_irqPendStamp[PLIC_IRQ_LIMIT];
+
+/* Stamps the sources that turned pending since the last poll of this trap */
+_attribute_ram_code_ STATIC VOID IrqPendingPoll(UINT32 now, UINT32 seen[2])
+{
+    for (UINT32 w = 0; w < 2; w++) {
+        UINT32 fresh = reg_irq_pending(w * 32) & ~seen[w];
+        seen[w] |= fresh;
+        while (fresh != 0) {
+            g_irqPendStamp[w * 32 + __builtin_ctz(fresh)] = now;
+            fresh &= fresh - 1;
+        }
+    }
+}
+
+/* Cycles since the source was first seen pending, the claim time if it turned pending after the last poll */
+_attribute_ram_code_ STATIC UINT32 IrqPendingWait(UINT32 irq, UINT32 now, UINT32 seen[2])
+{
+    UINT32 bit = 1U << (irq % 32);
+    if ((seen[irq / 32] & bit) == 0) {
+        return 0;
+    }
+    /* The claim cleared the pending bit, the next rise is a new request */
+    seen[irq / 32] &= ~bit;
+    return now - g_irqPendStamp[irq];
+}
+
+_attribute_ram_code_ STATIC VOID IrqProfileRecord(UINT32 irq, HwiProcFunc func, UINT32 wait, UINT32 cycles)
+{
+    B91IrqProfile *prof = &g_irqProfile[irq];
+
+    if (prof->count == 0 || cycles < prof->minCycles) {
+        prof->minCycles = cycles;
+    }
+    if (cycles > prof->maxCycles) {
+        prof->maxCycles = cycles;
+    }
+    if (wait > prof->maxLatency) {
+        prof->maxLatency = wait;
+    }
+    if (func == (HwiProcFunc)default_irq_handler) {
+        prof->unhandled++;
+    }
+    prof->count++;
+    prof->totalCycles += cycles;
+
+    UINT32 bucket = 0;
+    while ((bucket < B91_IRQ_HIST_BUCKETS - 1) && (cycles >= ((UINT32)B91_IRQ_HIST_BASE << bucket))) {
+        bucket++;
+    }
+    prof->hist[bucket]++;
+}
+#endif /* B91_IRQ_PROFILE */
+
 STATIC UINT32 EnableIrq(UINT32 hwiNum)
 {
     if (hwiNum > OS_HWI_MAX_NUM) {
@@ -91,15 +164,59 @@ VOID HalSetLocalInterPri(UINT32 interPriNum, UINT16 prior)
     plic_set_priority(interPriNum, prior);
 }
 
+/*
+ * The LiteOS-M trap entry always switches to the top of the interrupt stack, so the handler can not re-enable
+ * MIE and let a second external interrupt nest on top of it, and raising the PLIC threshold here would have
+ * nothing to preempt. Instead every source pending at trap time is served in this one trap: the PLIC claim
+ * returns the highest priority pending source first, so a radio or timer interrupt raised while a slow
+ * handler runs is the next one dispatched, ahead of lower priority sources that were already waiting, and
+ * without paying another trap entry. A high priority source still waits for the handler that is running.
+ *
+ * With B91_IRQ_PROFILE the wait of a source counts from the first point the trap saw it pending: trap entry,
+ * or the end of the handler during which it was raised. Time spent with interrupts locked before the trap
+ * is not visible to the PLIC and is not included.
+ */
 _attribute_ram_code_ void mext_irq_handler(void)
 {
+#if B91_IRQ_PROFILE
+    UINT32 seen[2] = {0, 0};
+    IrqPendingPoll(read_csr(NDS_MCYCLE), seen);
+#endif
     unsigned int periph_irq = plic_interrupt_claim();
+    UINT32 budget = B91_IRQ_DISPATCH_MAX;
+
+    do {
+#if B91_IRQ_PROFILE
+        UINT32 start = read_csr(NDS_MCYCLE);
+        UINT32 wait = IrqPendingWait(periph_irq, start, seen);
+#endif
+        HWI_HANDLE_FORM_S *hwiForm = &irq_handlers[periph_irq];
+        HwiProcFunc func = (HwiProcFunc)(hwiForm->pfnHook);
+        func(hwiForm->uwParam);
+#if B91_IRQ_PROFILE
+        UINT32 end = read_csr(NDS_MCYCLE);
+        IrqProfileRecord(periph_irq, func, wait, end - start);
+        IrqPendingPoll(end, seen);
+#endif
+
+        plic_interrupt_complete(periph_irq); /* complete interrupt */
+
+        /* Past the budget sources are left pending and trap again, so that a stuck source can't starve tasks */
+    } while ((--budget != 0) && ((periph_irq = plic_interrupt_claim()) != 0));
+}
+
+UINT32 B91IrqRegisterPrio(UINT32 irq_num, HWI_PROC_FUNC handler, HWI_ARG_T irqParam, UINT32 prio)
+{
+    if ((prio < IRQ_PRI_LEV1) || (prio > IRQ_PRI_LEV3)) {
+        return OS_ERRNO_HWI_PRIO_INVALID;
+    }
 
-    HWI_HANDLE_FORM_S *hwiForm = &irq_handlers[periph_irq];
-    HwiProcFunc func = (HwiProcFunc)(hwiForm->pfnHook);
-    func(hwiForm->uwParam);
+    UINT32 ret = B91IrqRegister(irq_num, handler, irqParam);
+    if (ret == LOS_OK) {
+        plic_set_priority(irq_num, prio);
+    }
 
-    plic_interrupt_complete(periph_irq); /* complete interrupt */
+    return ret;
 }
 
 UINT32 B91IrqRegister(UINT32 irq_num, HWI_PROC_FUNC handler, HWI_ARG_T irqParam)
@@ -123,12 +240,103 @@ UINT32 B91IrqRegister(UINT32 irq_num, HWI_PROC_FUNC handler, HWI_ARG_T irqParam)
     return LOS_OK;
 }
 
+UINT32 B91IrqSetPriority(UINT32 irq_num, UINT32 prio)
+{
+    if (irq_num >= PLIC_IRQ_LIMIT) {
+        return OS_ERRNO_HWI_NUM_INVALID;
+    }
+    if ((prio < IRQ_PRI_LEV1) || (prio > IRQ_PRI_LEV3)) {
+        return OS_ERRNO_HWI_PRIO_INVALID;
+    }
+
+    plic_set_priority(irq_num, prio);
+    return LOS_OK;
+}
+
+UINT32 B91IrqRaiseThreshold(UINT32 prio)
+{
+    UINT32 intSave = LOS_IntLock();
+    UINT32 prev = reg_irq_threshold;
+    if (prio > prev) {
+        plic_set_threshold(prio);
+    }
+    LOS_IntRestore(intSave);
+
+    return prev;
+}
+
+VOID B91IrqRestoreThreshold(UINT32 prev)
+{
+    plic_set_threshold(prev);
+}
+
+#if B91_IRQ_PROFILE
+UINT32 B91IrqProfileGet(UINT32 irq_num, B91IrqProfile *profile)
+{
+    if (irq_num >= PLIC_IRQ_LIMIT) {
+        return OS_ERRNO_HWI_NUM_INVALID;
+    }
+
+    UINT32 intSave = LOS_IntLock();
+    *profile = g_irqProfile[irq_num];
+    LOS_IntRestore(intSave);
+
+    return LOS_OK;
+}
+
+VOID B91IrqProfileReset(VOID)
+{
+    UINT32 intSave = LOS_IntLock();
+    (VOID)memset(g_irqProfile, 0, sizeof(g_irqProfile));
+    LOS_IntRestore(intSave);
+}
+
+VOID B91IrqProfileDump(VOID)
+{
+    B91IrqProfile prof;
+
+    printf("irq prio    count unhandled   min   avg   max  maxlat  histogram (x%u cycles)\r\n", B91_IRQ_HIST_BASE);
+    for (UINT32 i = 0; i < PLIC_IRQ_LIMIT; i++) {
+        (VOID)B91IrqProfileGet(i, &prof);
+        if (prof.count == 0) {
+            continue;
+        }
+        B91_LOGT("%3u %4u %8u %9u %5u %5u %5u %7u ", i, (UINT32)reg_irq_src_priority(i), prof.count, prof.unhandled,
+                 prof.minCycles, (UINT32)(prof.totalCycles / prof.count), prof.maxCycles, prof.maxLatency);
+        for (UINT32 b = 0; b < B91_IRQ_HIST_BUCKETS; b++) {
+            B91_LOGT(" %u", prof.hist[b]);
+        }
+        B91_LOGT("\r\n");
+    }
+}
+
+#ifdef LOSCFG_SHELL
+STATIC UINT32 IrqProfileShellCmd(UINT32 argc, const CHAR **argv)
+{
+    if ((argc > 0) && (strcmp(argv[0], "reset") == 0)) {
+        B91IrqProfileReset();
+    } else {
+        B91IrqProfileDump();
+    }
+    return LOS_OK;
+}
+#endif /* LOSCFG_SHELL */
+#endif /* B91_IRQ_PROFILE */
+
 VOID B91IrqInit(VOID)
 {
+    for (UINT32 i = 0; i < sizeof(g_irqDefaultPrio) / sizeof(g_irqDefaultPrio[0]); i++) {
+        plic_set_priority(g_irqDefaultPrio[i][0], g_irqDefaultPrio[i][1]);
+    }
+
     UINT32 ret = LOS_HwiCreate(RISCV_MACH_EXT_IRQ, OS_HWI_PRIO_LOWEST, 0, (HWI_PROC_FUNC)mext_irq_handler, 0);
     if (ret != LOS_OK) {
         printf("ret of LOS_HwiCreate(RISCV_MACH_EXT_IRQ) = %#x\r\n", ret);
     }
 
+#if B91_IRQ_PROFILE && defined(LOSCFG_SHELL)
+    (VOID)osCmdReg(CMD_TYPE_EX, "irqprof", XARGS, (CmdCallBackFunc)IrqProfileShellCmd);
+#endif
+
     core_interrupt_enable();
 }
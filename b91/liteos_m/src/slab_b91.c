@@ -0,0 +1,197 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+#include <string.h>
+
+#include <slab_b91.h>
+
+#define SLAB_ALIGN 8
+
+struct B91SlabPage {
+    B91SlabPage *next; /* in the list of pages with free objects */
+    B91SlabPage *prev;
+    void *free;        /* objects given back */
+    uint16_t carved;   /* objects handed out at least once, the rest follow them untouched */
+    uint16_t capacity;
+    uint16_t inUse;
+    uint8_t cls;
+};
+
+#define SLAB_HEADER_SIZE ((sizeof(B91SlabPage) + SLAB_ALIGN - 1) & ~(uintptr_t)(SLAB_ALIGN - 1))
+
+static const uint16_t g_slabClassSize[B91_SLAB_CLASS_NUM] = {16, 24, 32, 48, 64, 96, 128, 192, 256};
+
+/* Class of a size in units of SLAB_ALIGN, rounded up */
+static const uint8_t g_slabClassOf[B91_SLAB_MAX_SIZE / SLAB_ALIGN + 1] = {
+    0, 0, 0, 1, 2, 3, 3, 4, 4, 5, 5, 5, 5, 6, 6, 6, 6,
+    7, 7, 7, 7, 7, 7, 7, 7, 8, 8, 8, 8, 8, 8, 8, 8,
+};
+
+static void SlabLink(B91Slab *slab, B91SlabPage *page)
+{
+    page->prev = NULL;
+    page->next = slab->partial[page->cls];
+    if (page->next != NULL) {
+        page->next->prev = page;
+    }
+    slab->partial[page->cls] = page;
+}
+
+static void SlabUnlink(B91Slab *slab, B91SlabPage *page)
+{
+    if (page->prev != NULL) {
+        page->prev->next = page->next;
+    } else {
+        slab->partial[page->cls] = page->next;
+    }
+    if (page->next != NULL) {
+        page->next->prev = page->prev;
+    }
+    page->next = NULL;
+    page->prev = NULL;
+}
+
+/* Page map index of a pointer, pageNum if outside the region */
+static uint32_t SlabPageIndex(const B91Slab *slab, const void *ptr)
+{
+    uintptr_t addr = (uintptr_t)ptr;
+    if (addr < slab->base) {
+        return slab->pageNum;
+    }
+    uintptr_t index = (addr - slab->base) / B91_SLAB_PAGE_SIZE;
+    return (index < slab->pageNum) ? (uint32_t)index : slab->pageNum;
+}
+
+static B91SlabPage *SlabPageNew(B91Slab *slab, uint32_t cls)
+{
+    B91SlabPage *page = (B91SlabPage *)slab->pageAlloc(slab->ctx);
+    if (page == NULL) {
+        return NULL;
+    }
+
+    uint32_t index = SlabPageIndex(slab, page);
+    if ((index == slab->pageNum) || (((uintptr_t)page - slab->base) % B91_SLAB_PAGE_SIZE != 0)) {
+        /* Not where the map can find it again */
+        slab->pageFree(slab->ctx, page);
+        return NULL;
+    }
+
+    (void)memset(page, 0, sizeof(*page));
+    page->cls = (uint8_t)cls;
+    page->capacity = (uint16_t)((B91_SLAB_PAGE_SIZE - SLAB_HEADER_SIZE) / g_slabClassSize[cls]);
+    slab->pageMap[index] = (uint8_t)(cls + 1);
+    SlabLink(slab, page);
+
+    B91SlabClassStats *st = &slab->stats[cls];
+    if (++st->pages > st->peakPages) {
+        st->peakPages = st->pages;
+    }
+    return page;
+}
+
+void B91SlabInit(B91Slab *slab, uintptr_t base, uint32_t size, B91SlabPageAlloc pageAlloc,
+                 B91SlabPageFree pageFree, void *ctx)
+{
+    (void)memset(slab, 0, sizeof(*slab));
+
+    uintptr_t start = base & ~(uintptr_t)(B91_SLAB_PAGE_SIZE - 1);
+    uint32_t pageNum = (uint32_t)((base + size - start) / B91_SLAB_PAGE_SIZE);
+
+    slab->pageAlloc = pageAlloc;
+    slab->pageFree = pageFree;
+    slab->ctx = ctx;
+    slab->base = start;
+    slab->pageNum = (pageNum < B91_SLAB_MAP_MAX) ? pageNum : B91_SLAB_MAP_MAX;
+    for (uint32_t i = 0; i < B91_SLAB_CLASS_NUM; i++) {
+        slab->stats[i].size = g_slabClassSize[i];
+    }
+}
+
+void *B91SlabAlloc(B91Slab *slab, uint32_t size)
+{
+    if ((size == 0) || (size > B91_SLAB_MAX_SIZE)) {
+        return NULL;
+    }
+
+    uint32_t cls = g_slabClassOf[(size + SLAB_ALIGN - 1) / SLAB_ALIGN];
+    B91SlabClassStats *st = &slab->stats[cls];
+    B91SlabPage *page = slab->partial[cls];
+    if (page == NULL) {
+        page = SlabPageNew(slab, cls);
+        if (page == NULL) {
+            st->noPage++;
+            return NULL;
+        }
+    }
+
+    void *obj = page->free;
+    if (obj != NULL) {
+        page->free = *(void **)obj;
+    } else {
+        obj = (uint8_t *)page + SLAB_HEADER_SIZE + (uint32_t)page->carved * g_slabClassSize[cls];
+        page->carved++;
+    }
+    if (++page->inUse == page->capacity) {
+        SlabUnlink(slab, page);
+    }
+
+    st->allocs++;
+    st->requested += size;
+    if (++st->inUse > st->peakInUse) {
+        st->peakInUse = st->inUse;
+    }
+    return obj;
+}
+
+bool B91SlabFree(B91Slab *slab, void *ptr)
+{
+    uint32_t index = SlabPageIndex(slab, ptr);
+    if ((index == slab->pageNum) || (slab->pageMap[index] == 0)) {
+        return false;
+    }
+
+    uint32_t cls = slab->pageMap[index] - 1U;
+    B91SlabPage *page = (B91SlabPage *)(slab->base + (uintptr_t)index * B91_SLAB_PAGE_SIZE);
+    B91SlabClassStats *st = &slab->stats[cls];
+
+    if (page->inUse == page->capacity) {
+        SlabLink(slab, page);
+    }
+    *(void **)ptr = page->free;
+    page->free = ptr;
+    page->inUse--;
+    st->frees++;
+    st->inUse--;
+
+    if ((page->inUse == 0) && ((slab->partial[cls] != page) || (page->next != NULL))) {
+        SlabUnlink(slab, page);
+        slab->pageMap[index] = 0;
+        st->pages--;
+        slab->pageFree(slab->ctx, page);
+    }
+    return true;
+}
+
+uint32_t B91SlabObjectSize(const B91Slab *slab, const void *ptr)
+{
+    uint32_t index = SlabPageIndex(slab, ptr);
+    if ((index == slab->pageNum) || (slab->pageMap[index] == 0)) {
+        return 0;
+    }
+    return g_slabClassSize[slab->pageMap[index] - 1U];
+}
@@ -25,6 +25,8 @@
 
 #include <B91/ext_driver/ext_pm.h>
 
+#include <dvfs_b91.h>
+
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
@@ -80,6 +82,7 @@ VOID SystemInit(VOID)
 
     sys_init(POWER_MODE, VBAT_TYPE);
     CLOCK_INIT;
+    B91DvfsRestore();
 
     clock_32k_init(CLK_32K_RC);
     clock_cal_32k_rc();
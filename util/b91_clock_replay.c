@@ -0,0 +1,130 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+/*
+ * Replays sleep/active cycles through the mtime resynchronization and reports the long-run drift of the
+ * OS clock, compared with the plain truncating conversion that was used before.
+ *
+ *     cc -I b91/liteos_m/inc -o b91_clock_replay util/b91_clock_replay.c b91/liteos_m/src/clocksync_b91.c
+ *     ./b91_clock_replay [-m mtime_hz] [-p rc_ppm] [-n sleeps] [trace.txt]
+ *
+ * Without a trace, random cycles are generated. A trace has one cycle per line: "<active_us> <sleep_us>".
+ * The 32k RC runs rc_ppm off its nominal frequency; as on the chip, the sleep code restores the stimer
+ * from the 32k tick count assuming the nominal frequency.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <clocksync_b91.h>
+
+#define STIMER_HZ 16000000ULL
+#define RC_HZ     32768ULL
+
+typedef struct {
+    double rcPhase;  /* fractional 32k ticks not yet counted */
+    double rcHz;     /* actual 32k frequency */
+} Rc32k;
+
+static uint32_t RcAdvance(Rc32k *rc, uint64_t stimerTicks)
+{
+    rc->rcPhase += (double)stimerTicks * rc->rcHz / STIMER_HZ;
+    uint32_t ticks = (uint32_t)rc->rcPhase;
+    rc->rcPhase -= ticks;
+    return ticks;
+}
+
+static int NextCycle(FILE *trace, uint32_t *activeUs, uint32_t *sleepUs)
+{
+    if (trace != NULL) {
+        char line[128];
+        while (fgets(line, sizeof(line), trace) != NULL) {
+            if (sscanf(line, "%u %u", activeUs, sleepUs) == 2) {
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    *activeUs = 1000 + (uint32_t)(rand() % 50000);
+    *sleepUs = 1000 + (uint32_t)(rand() % 2000000);
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t mtimeHz = 32768;
+    double ppm = 300.0;
+    long sleeps = 100000;
+    FILE *trace = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "-m") == 0) && (i + 1 < argc)) {
+            mtimeHz = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if ((strcmp(argv[i], "-p") == 0) && (i + 1 < argc)) {
+            ppm = strtod(argv[++i], NULL);
+        } else if ((strcmp(argv[i], "-n") == 0) && (i + 1 < argc)) {
+            sleeps = strtol(argv[++i], NULL, 0);
+        } else if ((trace = fopen(argv[i], "r")) == NULL) {
+            perror(argv[i]);
+            return 1;
+        }
+    }
+
+    B91ClockSync cs;
+    B91ClockSyncInit(&cs, mtimeHz, STIMER_HZ);
+    Rc32k rc = {0, RC_HZ * (1.0 + ppm / 1e6)};
+
+    uint64_t trueStimer = 0;
+    double mtimeActive = 0; /* mtime runs on its own while active, both methods share it */
+    uint64_t mtimeOld = 0;
+    uint64_t mtimeNew = 0;
+    uint32_t activeUs, sleepUs;
+    long n;
+
+    for (n = 0; (n < sleeps) && NextCycle(trace, &activeUs, &sleepUs); n++) {
+        uint64_t active = (uint64_t)activeUs * (STIMER_HZ / 1000000);
+        uint64_t sleep = (uint64_t)sleepUs * (STIMER_HZ / 1000000);
+
+        /* Active: mtime runs from the crystal like the stimer */
+        B91ClockSyncActive(&cs, (uint32_t)active, RcAdvance(&rc, active));
+        trueStimer += active;
+        mtimeActive += (double)active * mtimeHz / STIMER_HZ;
+
+        /* Sleep: only the 32k RC runs, the stimer is restored from it assuming 32768 Hz */
+        uint32_t rcTicks = RcAdvance(&rc, sleep);
+        uint32_t restored = (uint32_t)(rcTicks * STIMER_HZ / RC_HZ);
+        trueStimer += sleep;
+        mtimeOld += (uint64_t)restored * mtimeHz / STIMER_HZ;
+        mtimeNew += B91ClockSyncToMticks(&cs, B91ClockSyncSleepSpan(&cs, restored, rcTicks));
+    }
+
+    double trueS = (double)trueStimer / STIMER_HZ;
+    double oldErr = (mtimeActive + mtimeOld) / mtimeHz - trueS;
+    double newErr = (mtimeActive + mtimeNew) / mtimeHz - trueS;
+    printf("%ld sleeps, %.1f s, mtime %u Hz, 32k RC %+.0f ppm, %u calibration samples\n", n, trueS, mtimeHz, ppm,
+           cs.calibrations);
+    printf("truncating, nominal 32k: %+.3f ms (%+.1f ppm)\n", oldErr * 1e3, oldErr / trueS * 1e6);
+    printf("clock sync:              %+.3f ms (%+.1f ppm)\n", newErr * 1e3, newErr / trueS * 1e6);
+
+    if (trace != NULL) {
+        fclose(trace);
+    }
+    return 0;
+}
@@ -0,0 +1,105 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+/*
+ * Replays a load trace through the B91 CPU frequency governor on the host.
+ *
+ *     cc -I b91/liteos_m/inc -o b91_dvfs_replay util/b91_dvfs_replay.c b91/liteos_m/src/dvfs_governor_b91.c
+ *     ./b91_dvfs_replay trace.txt
+ *
+ * One governor window per line: "<window_us> <kcycles> [boost]". kcycles is the CPU work that became ready
+ * in the window, in thousands of cycles; work not done by the end of a window is carried into the next
+ * one. "boost" holds a boost for the window. The levels are the default 24 to 96 MHz range.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <dvfs_governor_b91.h>
+
+static const uint32_t g_levels[] = {24, 32, 48, 64, 96};
+
+int main(int argc, char **argv)
+{
+    const char *path = (argc > 1) ? argv[1] : NULL;
+    FILE *trace = (path == NULL || strcmp(path, "-") == 0) ? stdin : fopen(path, "r");
+    if (trace == NULL) {
+        perror(path);
+        return 1;
+    }
+
+    B91DvfsGovernor gov;
+    uint32_t num = sizeof(g_levels) / sizeof(g_levels[0]);
+    B91DvfsGovernorInit(&gov, g_levels, num, num - 1);
+
+    char line[128];
+    uint64_t backlog = 0; /* cycles */
+    uint64_t maxBacklogUs = 0;
+    uint64_t totalUs = 0;
+    uint64_t mhzUs = 0;
+    uint32_t windows = 0;
+
+    while (fgets(line, sizeof(line), trace) != NULL) {
+        unsigned long windowUs;
+        unsigned long kcycles;
+        char flag[16] = "";
+        if (sscanf(line, "%lu %lu %15s", &windowUs, &kcycles, flag) < 2 || windowUs == 0) {
+            continue;
+        }
+
+        bool boost = (strcmp(flag, "boost") == 0);
+        if (boost) {
+            B91DvfsGovernorSetLevel(&gov, B91DvfsGovernorBoost(&gov, true), 0, 0);
+        }
+
+        uint32_t mhz = gov.freqMhz[gov.level];
+        backlog += (uint64_t)kcycles * 1000;
+        uint64_t capacity = (uint64_t)windowUs * mhz;
+        uint64_t done = (backlog < capacity) ? backlog : capacity;
+        backlog -= done;
+        uint32_t busyUs = (uint32_t)(done / mhz);
+
+        uint64_t backlogUs = backlog / mhz;
+        if (backlogUs > maxBacklogUs) {
+            maxBacklogUs = backlogUs;
+        }
+        totalUs += windowUs;
+        mhzUs += (uint64_t)windowUs * mhz;
+        windows++;
+
+        uint32_t next = B91DvfsGovernorWindow(&gov, (uint32_t)windowUs, busyUs);
+        if (boost) {
+            (void)B91DvfsGovernorBoost(&gov, false);
+        }
+        B91DvfsGovernorSetLevel(&gov, next, (uint32_t)windowUs, busyUs);
+    }
+
+    if (trace != stdin) {
+        fclose(trace);
+    }
+
+    printf("MHz  residency(ms)  load(%%)\n");
+    for (uint32_t i = 0; i < gov.levelNum; i++) {
+        uint32_t load = (gov.residencyUs[i] != 0) ? (uint32_t)((gov.busyUs[i] * 100) / gov.residencyUs[i]) : 0;
+        printf("%3u %14llu %8u\n", gov.freqMhz[i], (unsigned long long)(gov.residencyUs[i] / 1000), load);
+    }
+    printf("%u windows, %u switches, average %llu MHz, longest backlog %llu us, %llu kcycles left\n", windows,
+           gov.switches, (unsigned long long)(totalUs ? mhzUs / totalUs : 0), (unsigned long long)maxBacklogUs,
+           (unsigned long long)(backlog / 1000));
+    return 0;
+}
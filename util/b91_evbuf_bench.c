@@ -0,0 +1,195 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+/*
+ * Compares the double free check of ev_buf_free() on the host, walking the free list against the block
+ * state of common/buf_pool1/ev_buffer.c, for growing pool sizes.
+ *
+ *     cc -O2 -o b91_evbuf_bench util/b91_evbuf_bench.c
+ *     ./b91_evbuf_bench [-n repeat] [block_size]
+ *
+ * The SDK code casts pointers to u32 and does not build for a 64 bit host, so the mempool free list and both
+ * checks are repeated here as they are in the SDK. Every pass allocates the whole pool and frees it in a
+ * random order. Since ev_buf_free() runs with interrupts disabled from the check to the list update, the time
+ * per free is also the time interrupts are held off; the mean and the worst free are printed.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define POOL_SIZE_MAX 1024
+#define DEFAULT_BLOCK_SIZE 60
+
+typedef struct Block {
+    struct Block *next;
+} Block;
+
+typedef struct {
+    Block *freeList;
+    uint8_t *mem;
+    uint8_t *state;
+    uint32_t blockSize;
+    uint32_t num;
+} Pool;
+
+enum { STATE_FREE, STATE_USED };
+
+static void PoolInit(Pool *pool)
+{
+    pool->freeList = NULL;
+    for (uint32_t i = pool->num; i-- > 0;) {
+        Block *b = (Block *)(pool->mem + i * pool->blockSize);
+        b->next = pool->freeList;
+        pool->freeList = b;
+        pool->state[i] = STATE_FREE;
+    }
+}
+
+static Block *PoolAlloc(Pool *pool)
+{
+    Block *b = pool->freeList;
+    pool->freeList = b->next;
+    pool->state[((uint8_t *)b - pool->mem) / pool->blockSize] = STATE_USED;
+    return b;
+}
+
+static int FreeWalk(Pool *pool, Block *b)
+{
+    for (Block *cur = pool->freeList; cur != NULL; cur = cur->next) {
+        if (cur == b) {
+            return -1;
+        }
+    }
+    b->next = pool->freeList;
+    pool->freeList = b;
+    return 0;
+}
+
+static int FreeState(Pool *pool, Block *b)
+{
+    uintptr_t offset = (uintptr_t)((uint8_t *)b - pool->mem);
+    if (offset >= (uintptr_t)pool->blockSize * pool->num || offset % pool->blockSize) {
+        return -1;
+    }
+    uint8_t *state = &pool->state[offset / pool->blockSize];
+    if (*state == STATE_FREE) {
+        return -1;
+    }
+    *state = STATE_FREE;
+    b->next = pool->freeList;
+    pool->freeList = b;
+    return 0;
+}
+
+static double NowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+typedef struct {
+    double meanNs;
+    double worstNs;
+} Result;
+
+static Result Run(Pool *pool, int (*freeFn)(Pool *, Block *), uint32_t repeat)
+{
+    Block *blocks[POOL_SIZE_MAX];
+    double total = 0;
+    double worst = 0;
+    unsigned seed = 1;
+
+    for (uint32_t r = 0; r < repeat; r++) {
+        PoolInit(pool);
+        for (uint32_t i = 0; i < pool->num; i++) {
+            blocks[i] = PoolAlloc(pool);
+        }
+        for (uint32_t i = pool->num - 1; i > 0; i--) {
+            uint32_t j = (uint32_t)rand_r(&seed) % (i + 1);
+            Block *tmp = blocks[i];
+            blocks[i] = blocks[j];
+            blocks[j] = tmp;
+        }
+
+        for (uint32_t i = 0; i < pool->num; i++) {
+            double start = NowNs();
+            int ret = freeFn(pool, blocks[i]);
+            double ns = NowNs() - start;
+            if (ret != 0) {
+                fprintf(stderr, "false double free\n");
+                exit(1);
+            }
+            total += ns;
+            worst = (ns > worst) ? ns : worst;
+        }
+
+        /* Every block is free now, a second free of any of them must be caught */
+        if (freeFn(pool, blocks[0]) == 0) {
+            fprintf(stderr, "double free not caught\n");
+            exit(1);
+        }
+    }
+
+    Result res = {total / ((double)pool->num * repeat), worst};
+    return res;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t repeat = 2000;
+    uint32_t blockSize = DEFAULT_BLOCK_SIZE;
+    int argi = 1;
+
+    if (argc > 2 && strcmp(argv[1], "-n") == 0) {
+        repeat = (uint32_t)strtoul(argv[2], NULL, 0);
+        argi = 3;
+    }
+    if (argc > argi) {
+        blockSize = (uint32_t)strtoul(argv[argi], NULL, 0);
+    }
+    blockSize = (blockSize + 3) & ~3U;
+    if (blockSize < sizeof(Block) || repeat == 0) {
+        fprintf(stderr, "usage: %s [-n repeat] [block_size]\n", argv[0]);
+        return 1;
+    }
+
+    Pool pool;
+    pool.blockSize = blockSize;
+    pool.mem = malloc((size_t)blockSize * POOL_SIZE_MAX);
+    pool.state = malloc(POOL_SIZE_MAX);
+    if (pool.mem == NULL || pool.state == NULL) {
+        return 1;
+    }
+
+    printf("blocks   walk mean  walk worst   state mean  state worst (ns per free)\n");
+    for (uint32_t num = 8; num <= POOL_SIZE_MAX; num *= 2) {
+        pool.num = num;
+        Result walk = Run(&pool, FreeWalk, repeat);
+        Result state = Run(&pool, FreeState, repeat);
+        printf("%6u %11.1f %11.1f %12.1f %12.1f\n", num, walk.meanNs, walk.worstNs, state.meanNs,
+               state.worstNs);
+    }
+
+    free(pool.mem);
+    free(pool.state);
+    return 0;
+}
@@ -0,0 +1,302 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+/*
+ * Replays scripted pin edges through the pin resolution and event filter of the B91 GPIO driver on the host.
+ *
+ *     cc -I b91/hdf -o b91_gpio_edge_replay util/b91_gpio_edge_replay.c
+ *     ./b91_gpio_edge_replay [-l latency_us] [-d isr_us] [-c] script.txt
+ *
+ * One port of the shared GPIO source is modelled: it raises an interrupt when the OR of the enabled pins'
+ * input XOR polarity goes high, the handler runs latency_us later, reads the inputs on entry and clears the
+ * status isr_us later, as GpioIrqHandler does. Script lines, times in microseconds:
+ *
+ *     pin <bit> rise|fall <debounce_us>             configure an edge pin with the event service
+ *     set <at> <bit> <level>                        one raw edge
+ *     press <at> <bit> <hold> [<bounces> <gap>]     a press held for hold, with bounces edges gap apart
+ *                                                   after both the press and the release
+ *
+ * Every accepted event is printed, then per pin the presses scripted and the events accepted. -c exits with
+ * 1 when the two differ for any pin. util/b91_gpio_edge_replay.txt is the reference script.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <gpio_edge_telink.h>
+
+#define PINS          8
+#define EDGES_MAX     4096
+#define SCAN_MAX      4
+
+struct Edge {
+    uint32_t at;
+    uint8_t bit;
+    uint8_t level;
+};
+
+struct Pin {
+    int enabled;
+    int rising;
+    uint32_t debounce;
+    uint32_t lastTick;
+    uint32_t idleTick;
+    uint32_t presses;
+    uint32_t accepted;
+    uint32_t filtered;
+};
+
+static struct Edge g_edges[EDGES_MAX];
+static uint32_t g_edgeNum;
+static uint32_t g_edgeNext;
+static struct Pin g_pins[PINS];
+
+/* Modelled port */
+static uint8_t g_in;
+static uint8_t g_pol;
+static uint8_t g_en;
+static int g_line;
+static int g_pending;
+static uint32_t g_pendingAt;
+
+static uint32_t g_irqs;
+static uint32_t g_unresolved;
+
+static void AddEdge(uint32_t at, uint8_t bit, uint8_t level)
+{
+    if (g_edgeNum == EDGES_MAX) {
+        fprintf(stderr, "too many edges\n");
+        exit(2);
+    }
+    g_edges[g_edgeNum].at = at;
+    g_edges[g_edgeNum].bit = bit;
+    g_edges[g_edgeNum].level = level;
+    g_edgeNum++;
+}
+
+static int CompareEdge(const void *a, const void *b)
+{
+    const struct Edge *x = a;
+    const struct Edge *y = b;
+
+    return (x->at > y->at) - (x->at < y->at);
+}
+
+/* Re-evaluates the interrupt line after an input or polarity change, a rising line latches the status */
+static void UpdateLine(uint32_t now)
+{
+    int line = ((g_in ^ g_pol) & g_en) != 0;
+
+    if (line && !g_line && !g_pending) {
+        g_pending = 1;
+        g_pendingAt = now;
+    }
+    g_line = line;
+}
+
+static void ApplyEdgesUntil(uint32_t now)
+{
+    while ((g_edgeNext < g_edgeNum) && (g_edges[g_edgeNext].at <= now)) {
+        struct Edge *e = &g_edges[g_edgeNext++];
+        g_in = (g_in & ~(1u << e->bit)) | (e->level << e->bit);
+        UpdateLine(e->at);
+    }
+}
+
+static void Dispatch(uint8_t fired, uint8_t level, uint32_t tick)
+{
+    for (uint8_t bit = 0; bit < PINS; bit++) {
+        if (!(fired & (1u << bit))) {
+            continue;
+        }
+
+        struct Pin *pin = &g_pins[bit];
+        uint8_t pinLevel = (level >> bit) & 1;
+        if (!GpioEventFilter(pin->rising ? 1 : 0, pin->lastTick, pin->idleTick, pin->debounce, pinLevel, tick)) {
+            pin->filtered++;
+            continue;
+        }
+        pin->lastTick = tick;
+        pin->accepted++;
+        printf("%10u  pin %u  level %u\n", tick, bit, pinLevel);
+    }
+}
+
+static uint32_t RunIsr(uint32_t now, uint32_t isrUs, uint8_t rise, uint8_t fall, uint8_t *lastLevel)
+{
+    uint32_t start = now;
+    int resolved = 0;
+
+    g_irqs++;
+    for (int pass = 0; pass < SCAN_MAX; pass++) {
+        uint8_t level = g_in;
+        uint8_t fired = GpioPortFired(rise, fall, 0, 0, *lastLevel, level);
+        uint8_t moves = (level ^ *lastLevel) & (rise | fall);
+        if ((moves | fired) != 0) {
+            resolved = 1;
+        }
+        for (uint8_t bit = 0; bit < PINS; bit++) {
+            if (moves & ~fired & (1u << bit)) {
+                g_pins[bit].idleTick = start;
+            }
+        }
+        *lastLevel = level;
+        g_pol = GpioEdgePolarity(g_pol, rise | fall, level);
+        UpdateLine(now);
+        Dispatch(fired, level, start);
+
+        now += isrUs;
+        ApplyEdgesUntil(now);
+        g_pending = 0;
+        if (((g_in ^ *lastLevel) & (rise | fall)) == 0) {
+            break;
+        }
+    }
+
+    if (!resolved) {
+        g_unresolved++;
+        Dispatch(rise | fall, *lastLevel, start);
+    }
+
+    return now;
+}
+
+static int LoadScript(FILE *f)
+{
+    char line[256];
+    int lineNo = 0;
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        char cmd[16];
+        char trig[8];
+        unsigned a, b, c, d = 0, e = 0;
+
+        lineNo++;
+        if ((line[0] == '#') || (sscanf(line, "%15s", cmd) != 1)) {
+            continue;
+        }
+
+        if ((strcmp(cmd, "pin") == 0) && (sscanf(line, "%*s %u %7s %u", &a, trig, &b) == 3) && (a < PINS)) {
+            g_pins[a].enabled = 1;
+            g_pins[a].rising = (strcmp(trig, "rise") == 0);
+            g_pins[a].debounce = b;
+            g_pins[a].lastTick = 0u - b;
+            g_pins[a].idleTick = 0u - b;
+            g_en |= 1u << a;
+        } else if ((strcmp(cmd, "set") == 0) && (sscanf(line, "%*s %u %u %u", &a, &b, &c) == 3) && (b < PINS)) {
+            AddEdge(a, b, c ? 1 : 0);
+        } else if ((strcmp(cmd, "press") == 0) && (sscanf(line, "%*s %u %u %u %u %u", &a, &b, &c, &d, &e) >= 3) &&
+                   (b < PINS)) {
+            uint8_t active = g_pins[b].rising ? 1 : 0;
+            g_pins[b].presses++;
+            AddEdge(a, b, active);
+            AddEdge(a + c, b, !active);
+            for (unsigned i = 1; i <= d; i++) {
+                AddEdge(a + i * e, b, (i & 1) ? !active : active);
+                AddEdge(a + c + i * e, b, (i & 1) ? active : !active);
+            }
+            if (d & 1) {
+                /* An odd bounce count would leave the pin on the wrong level, settle it after the last one */
+                AddEdge(a + (d + 1) * e, b, active);
+                AddEdge(a + c + (d + 1) * e, b, !active);
+            }
+        } else {
+            fprintf(stderr, "line %d: cannot parse: %s", lineNo, line);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t latency = 5;
+    uint32_t isrUs = 3;
+    int check = 0;
+    const char *path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "-l") == 0) && (i + 1 < argc)) {
+            latency = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if ((strcmp(argv[i], "-d") == 0) && (i + 1 < argc)) {
+            isrUs = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-c") == 0) {
+            check = 1;
+        } else {
+            path = argv[i];
+        }
+    }
+
+    FILE *script = (path == NULL || strcmp(path, "-") == 0) ? stdin : fopen(path, "r");
+    if (script == NULL) {
+        perror(path);
+        return 2;
+    }
+    if (LoadScript(script) != 0) {
+        return 2;
+    }
+    qsort(g_edges, g_edgeNum, sizeof(g_edges[0]), CompareEdge);
+
+    /* Pins start idle and armed as GpioUpdateIrqMasks leaves them */
+    uint8_t rise = 0;
+    uint8_t fall = 0;
+    for (uint8_t bit = 0; bit < PINS; bit++) {
+        if (!g_pins[bit].enabled) {
+            continue;
+        }
+        if (g_pins[bit].rising) {
+            rise |= 1u << bit;
+        } else {
+            fall |= 1u << bit;
+            g_in |= 1u << bit;
+        }
+    }
+    uint8_t lastLevel = g_in;
+    g_pol = GpioEdgePolarity(0, rise | fall, g_in);
+    UpdateLine(0);
+
+    uint32_t now = 0;
+    while ((g_edgeNext < g_edgeNum) || g_pending) {
+        if (g_pending && ((g_edgeNext == g_edgeNum) || (g_pendingAt + latency <= g_edges[g_edgeNext].at))) {
+            if (now < g_pendingAt + latency) {
+                now = g_pendingAt + latency;
+            }
+            now = RunIsr(now, isrUs, rise, fall, &lastLevel);
+        } else {
+            ApplyEdgesUntil(g_edges[g_edgeNext].at);
+        }
+    }
+
+    int mismatch = 0;
+    printf("\ninterrupts %u, unresolved %u\n", g_irqs, g_unresolved);
+    for (uint8_t bit = 0; bit < PINS; bit++) {
+        struct Pin *pin = &g_pins[bit];
+        if (!pin->enabled) {
+            continue;
+        }
+        printf("pin %u %-4s  presses %4u  accepted %4u  filtered %4u%s\n", bit, pin->rising ? "rise" : "fall",
+               pin->presses, pin->accepted, pin->filtered, (pin->presses != pin->accepted) ? "  MISMATCH" : "");
+        if (pin->presses != pin->accepted) {
+            mismatch = 1;
+        }
+    }
+
+    return (check && mismatch) ? 1 : 0;
+}
@@ -0,0 +1,336 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+/*
+ * Stresses the lock-free block pool of the SDK on the host.
+ *
+ *     cc -O2 -DWIN32 -pthread -I b91/b91_ble_sdk/common -o b91_lfpool_stress util/b91_lfpool_stress.c \
+ *         b91/b91_ble_sdk/common/lf_pool.c
+ *     ./b91_lfpool_stress [-t threads] [-s seconds] [-n blocks]
+ *
+ * (WIN32 only keeps types.h from redefining size_t.)
+ *
+ * Every thread allocates and frees blocks of one shared pool in a loop, while a timer signal interrupts
+ * the threads every 50 us and allocates and frees from its handler, like an interrupt handler preempting a
+ * task in the middle of a pool operation on the B91. Each block is stamped with its owner while it is held
+ * and checked before it is given back, so a block handed out twice is reported. The same load then runs
+ * against the free list of mempool.c under a spin lock, standing in for irq_disable(); the time the lock
+ * is held is what the B91 would spend with interrupts masked. The lock-free pool never masks them.
+ */
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include "lf_pool.h"
+
+#define HOLD_MAX       4
+#define THREAD_MAX     16
+#define POOL_NUM_MAX   4096
+#define TIMER_US       50
+#define OWNER_FREE     0
+
+typedef struct {
+    uint32_t link; /* first word, owned by the pool while the block is free */
+    uint32_t owner;
+    uint32_t pad[2];
+} Block;
+
+typedef struct {
+    uint64_t ops;
+    uint64_t empty;
+    double worstNs;
+    double heldNs;
+    double worstHeldNs;
+    uint32_t id;
+} ThreadStats;
+
+static Block g_mem[POOL_NUM_MAX];
+static lf_pool_t g_pool;
+static volatile int g_stop;
+static volatile int g_locked;
+static volatile uint32_t g_errors;
+static volatile uint64_t g_irqOps;
+
+/* The mempool.c free list behind a lock, the irq_disable() critical section of the old code. A host
+ * pointer does not fit the link word, so the links are kept aside. */
+static Block *g_lockFree;
+static Block *g_lockNext[POOL_NUM_MAX];
+static volatile int g_lock;
+
+static double NowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void LockedInit(uint32_t num)
+{
+    g_lockFree = NULL;
+    for (uint32_t i = num; i-- > 0;) {
+        g_lockNext[i] = g_lockFree;
+        g_lockFree = &g_mem[i];
+    }
+}
+
+static void LockTake(void)
+{
+    while (__atomic_exchange_n(&g_lock, 1, __ATOMIC_ACQUIRE)) {
+    }
+}
+
+static void LockGive(void)
+{
+    __atomic_store_n(&g_lock, 0, __ATOMIC_RELEASE);
+}
+
+static Block *PoolAlloc(ThreadStats *st)
+{
+    if (!g_locked) {
+        return lf_pool_alloc(&g_pool);
+    }
+
+    /* Signals are blocked while the lock is held, as interrupts are on the B91 */
+    sigset_t all;
+    sigset_t old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    LockTake();
+    double start = NowNs();
+    Block *b = g_lockFree;
+    if (b != NULL) {
+        g_lockFree = g_lockNext[b - g_mem];
+    }
+    double held = NowNs() - start;
+    LockGive();
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    if (st != NULL) {
+        st->heldNs += held;
+        st->worstHeldNs = (held > st->worstHeldNs) ? held : st->worstHeldNs;
+    }
+    return b;
+}
+
+static void PoolFree(ThreadStats *st, Block *b)
+{
+    if (!g_locked) {
+        lf_pool_free(&g_pool, b);
+        return;
+    }
+
+    sigset_t all;
+    sigset_t old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    LockTake();
+    double start = NowNs();
+    g_lockNext[b - g_mem] = g_lockFree;
+    g_lockFree = b;
+    double held = NowNs() - start;
+    LockGive();
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    if (st != NULL) {
+        st->heldNs += held;
+        st->worstHeldNs = (held > st->worstHeldNs) ? held : st->worstHeldNs;
+    }
+}
+
+static int Claim(Block *b, uint32_t owner)
+{
+    uint32_t expected = OWNER_FREE;
+    if (!__atomic_compare_exchange_n(&b->owner, &expected, owner, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        __atomic_fetch_add(&g_errors, 1, __ATOMIC_RELAXED);
+        return -1;
+    }
+    return 0;
+}
+
+static void Release(Block *b, uint32_t owner)
+{
+    uint32_t expected = owner;
+    if (!__atomic_compare_exchange_n(&b->owner, &expected, OWNER_FREE, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        __atomic_fetch_add(&g_errors, 1, __ATOMIC_RELAXED);
+    }
+}
+
+/* The interrupt handler: takes a block and gives it back, it can not wait for the pool to refill */
+static void OnTimer(int sig)
+{
+    (void)sig;
+    if (g_locked) {
+        return; /* a spin lock can not be taken from a handler that interrupted its holder */
+    }
+    Block *b = lf_pool_alloc(&g_pool);
+    if (b != NULL) {
+        if (Claim(b, 0xffffffffU) == 0) {
+            Release(b, 0xffffffffU);
+        }
+        lf_pool_free(&g_pool, b);
+        g_irqOps++;
+    }
+}
+
+static void *Worker(void *arg)
+{
+    ThreadStats *st = arg;
+    Block *held[HOLD_MAX];
+    unsigned seed = st->id;
+
+    while (!g_stop) {
+        uint32_t n = 1 + (uint32_t)rand_r(&seed) % HOLD_MAX;
+        uint32_t got = 0;
+
+        double start = NowNs();
+        for (uint32_t i = 0; i < n; i++) {
+            Block *b = PoolAlloc(st);
+            if (b == NULL) {
+                st->empty++;
+                break;
+            }
+            if (Claim(b, st->id) != 0) {
+                continue; /* handed out twice, counted */
+            }
+            held[got++] = b;
+        }
+        for (uint32_t i = 0; i < got; i++) {
+            Release(held[i], st->id);
+            PoolFree(st, held[i]);
+        }
+        double ns = (NowNs() - start) / (double)(n + got);
+        st->worstNs = (ns > st->worstNs) ? ns : st->worstNs;
+        st->ops += n + got;
+    }
+    return NULL;
+}
+
+static void Run(const char *name, uint32_t threads, uint32_t seconds, uint32_t num)
+{
+    pthread_t tids[THREAD_MAX];
+    ThreadStats stats[THREAD_MAX];
+
+    memset(g_mem, 0, sizeof(g_mem));
+    if (g_locked) {
+        LockedInit(num);
+    } else if (lf_pool_init(&g_pool, g_mem, sizeof(Block), (u16)num) == NULL) {
+        fprintf(stderr, "bad pool parameters\n");
+        exit(1);
+    }
+    g_stop = 0;
+    g_errors = 0;
+    g_irqOps = 0;
+
+    struct itimerval timer = {{0, TIMER_US}, {0, TIMER_US}};
+    setitimer(ITIMER_REAL, &timer, NULL);
+
+    for (uint32_t t = 0; t < threads; t++) {
+        memset(&stats[t], 0, sizeof(stats[t]));
+        stats[t].id = t + 1;
+        pthread_create(&tids[t], NULL, Worker, &stats[t]);
+    }
+
+    /* The timer signal goes to the workers only, it would cut the wait short */
+    sigset_t alarm;
+    sigemptyset(&alarm);
+    sigaddset(&alarm, SIGALRM);
+    pthread_sigmask(SIG_BLOCK, &alarm, NULL);
+    struct timespec wait = {(time_t)seconds, 0};
+    nanosleep(&wait, NULL);
+    pthread_sigmask(SIG_UNBLOCK, &alarm, NULL);
+    g_stop = 1;
+
+    uint64_t ops = 0;
+    uint64_t empty = 0;
+    double worst = 0;
+    double held = 0;
+    double worstHeld = 0;
+    for (uint32_t t = 0; t < threads; t++) {
+        pthread_join(tids[t], NULL);
+        ops += stats[t].ops;
+        empty += stats[t].empty;
+        held += stats[t].heldNs;
+        worst = (stats[t].worstNs > worst) ? stats[t].worstNs : worst;
+        worstHeld = (stats[t].worstHeldNs > worstHeld) ? stats[t].worstHeldNs : worstHeld;
+    }
+
+    struct itimerval off = {{0, 0}, {0, 0}};
+    setitimer(ITIMER_REAL, &off, NULL);
+
+    /* Everything is back, every block must be free once */
+    uint32_t count = 0;
+    if (!g_locked) {
+        while (lf_pool_alloc(&g_pool) != NULL) {
+            count++;
+        }
+    } else {
+        for (Block *b = g_lockFree; b != NULL; b = g_lockNext[b - g_mem]) {
+            count++;
+        }
+    }
+
+    printf("%-10s %12llu ops %10llu empty %9llu irq ops  worst op %9.0f ns  masked %6.1f%% worst %7.0f ns",
+           name, (unsigned long long)ops, (unsigned long long)empty, (unsigned long long)g_irqOps, worst,
+           (ops != 0) ? (held * 100.0) / ((double)seconds * 1e9 * threads) : 0.0, worstHeld);
+    printf("  %s\n", (g_errors == 0 && count == num) ? "ok" : "CORRUPTED");
+    if (g_errors != 0 || count != num) {
+        printf("  %u blocks handed out twice, %u of %u blocks back in the pool\n", g_errors, count, num);
+        exit(1);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t threads = 4;
+    uint32_t seconds = 2;
+    uint32_t num = 16;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        uint32_t v = (uint32_t)strtoul(argv[i + 1], NULL, 0);
+        if (strcmp(argv[i], "-t") == 0) {
+            threads = v;
+        } else if (strcmp(argv[i], "-s") == 0) {
+            seconds = v;
+        } else if (strcmp(argv[i], "-n") == 0) {
+            num = v;
+        }
+    }
+    if (threads == 0 || threads > THREAD_MAX || num == 0 || num > POOL_NUM_MAX || seconds == 0) {
+        fprintf(stderr, "usage: %s [-t 1..%u] [-s seconds] [-n 1..%u]\n", argv[0], THREAD_MAX, POOL_NUM_MAX);
+        return 1;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = OnTimer;
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGALRM, &sa, NULL);
+
+    printf("%u threads, %u blocks, timer handler every %u us\n", threads, num, TIMER_US);
+    g_locked = 0;
+    Run("lock-free", threads, seconds, num);
+    g_locked = 1;
+    Run("locked", threads, seconds, num);
+    return 0;
+}
@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+# All rights reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Restore B91_LOGT() output captured from the debug UART.
+
+Plain text is passed through. Tokenized frames (see log_token_b91.h) are
+replaced with the format string found in the .b91_log_tokens section of the
+ELF the firmware was built from.
+
+    b91_log_detokenize.py out/.../OHOS_Image capture.bin
+    cat /dev/ttyUSB0 | b91_log_detokenize.py out/.../OHOS_Image -
+"""
+
+import argparse
+import codecs
+import re
+import struct
+import sys
+
+TOKEN_SECTION = ".b91_log_tokens"
+TOKEN_MAGIC = 0xFE
+TOKEN_HDR_SIZE = 6
+TOKEN_ARGS_MAX = 8
+
+ELF_MAGIC = b"\x7fELF"
+ELF_CLASS_32 = 1
+
+SPEC_RE = re.compile(r"%([-+ #0]*)(\d+|\*)?(?:\.(\d+))?(hh|h|ll|l|z|j|t)?([diuxXcspo%])")
+
+
+def load_tokens(elf_path):
+    with open(elf_path, "rb") as f:
+        elf = f.read()
+
+    if elf[:4] != ELF_MAGIC or elf[4] != ELF_CLASS_32:
+        raise ValueError("%s: not a 32-bit ELF" % elf_path)
+
+    e_shoff, = struct.unpack_from("<I", elf, 0x20)
+    e_shentsize, e_shnum, e_shstrndx = struct.unpack_from("<HHH", elf, 0x2E)
+
+    def section(index):
+        return struct.unpack_from("<IIIIIIIIII", elf, e_shoff + index * e_shentsize)
+
+    shstr = section(e_shstrndx)
+    names = elf[shstr[4]:shstr[4] + shstr[5]]
+
+    for i in range(e_shnum):
+        sh = section(i)
+        name = names[sh[0]:names.index(b"\0", sh[0])].decode()
+        if name != TOKEN_SECTION:
+            continue
+
+        data = elf[sh[4]:sh[4] + sh[5]]
+        tokens = {}
+        offset = 0
+        while offset < len(data):
+            end = data.index(b"\0", offset)
+            tokens[sh[3] + offset] = data[offset:end].decode(errors="replace")
+            offset = end + 1
+            while offset < len(data) and data[offset] == 0:
+                offset += 1
+        return tokens
+
+    raise ValueError("%s: no %s section, was it built with b91_log_tokenized?" % (elf_path, TOKEN_SECTION))
+
+
+def format_args(fmt, args):
+    it = iter(args)
+
+    def substitute(m):
+        flags, width, precision, length, conv = m.groups()
+        if conv == "%":
+            return "%"
+        value = next(it, 0)
+        if conv in "di":
+            value = struct.unpack("<i", struct.pack("<I", value))[0]
+            conv = "d"
+        elif conv in "sp":
+            return "0x%08x" % value
+        elif conv == "c":
+            value = value & 0xFF
+        spec = "%" + (flags or "") + (width or "") + ("." + precision if precision else "") + conv
+        return spec % value
+
+    return SPEC_RE.sub(substitute, fmt)
+
+
+def decode(stream, tokens, out):
+    # Text keeps its place in one decoder, a character split across reads or around a frame is not lost
+    # (TOKEN_MAGIC never occurs in UTF-8)
+    text = codecs.getincrementaldecoder("utf-8")(errors="replace")
+    buf = b""
+    while True:
+        chunk = stream.read(256)
+        if not chunk:
+            out.write(text.decode(b"", final=True))
+            out.flush()
+            break
+        buf += chunk
+
+        while buf:
+            pos = buf.find(bytes([TOKEN_MAGIC]))
+            if pos < 0:
+                out.write(text.decode(buf))
+                buf = b""
+                break
+            if pos > 0:
+                out.write(text.decode(buf[:pos]))
+                buf = buf[pos:]
+
+            if len(buf) < TOKEN_HDR_SIZE:
+                break
+            argc = buf[1]
+            if argc > TOKEN_ARGS_MAX:
+                buf = buf[1:]
+                continue
+            size = TOKEN_HDR_SIZE + argc * 4
+            if len(buf) < size:
+                break
+
+            token, = struct.unpack_from("<I", buf, 2)
+            args = struct.unpack_from("<%dI" % argc, buf, TOKEN_HDR_SIZE)
+            fmt = tokens.get(token)
+            if fmt is None:
+                out.write("<unknown token 0x%08x %s>\n" % (token, " ".join("0x%x" % a for a in args)))
+            else:
+                out.write(format_args(fmt, args))
+            buf = buf[size:]
+        out.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("elf", help="unstripped firmware ELF")
+    parser.add_argument("capture", help="raw UART capture, '-' for stdin")
+    args = parser.parse_args()
+
+    tokens = load_tokens(args.elf)
+    if args.capture == "-":
+        decode(sys.stdin.buffer, tokens, sys.stdout)
+    else:
+        with open(args.capture, "rb") as f:
+            decode(f, tokens, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
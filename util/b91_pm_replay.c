@@ -0,0 +1,96 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+/*
+ * Replays a recorded idle trace through the B91 idle governor on the host.
+ *
+ *     cc -I b91/liteos_m/inc -o b91_pm_replay util/b91_pm_replay.c b91/liteos_m/src/pm_governor_b91.c
+ *     ./b91_pm_replay [-d] trace.txt
+ *
+ * One idle period per line: "<expected_us> [<actual_us>]". expected_us is the time to the next OS timer
+ * event, actual_us the time until the system was really woken (defaults to expected_us). The wake-up cost
+ * of a mode is taken from its current parameters. -d enables deep sleep with retention.
+ *
+ * The firmware logs this format with the b91_pm_trace gn argument; util/b91_pm_idle_trace.txt is a reference
+ * trace.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <pm_governor_b91.h>
+
+static const char *const g_modeNames[B91_PM_MODE_NUM] = {"wfi", "suspend", "deep-ret"};
+
+int main(int argc, char **argv)
+{
+    B91PmGovernor gov;
+    const char *path = NULL;
+    bool deepRet = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-d") == 0) {
+            deepRet = true;
+        } else {
+            path = argv[i];
+        }
+    }
+
+    FILE *trace = (path == NULL || strcmp(path, "-") == 0) ? stdin : fopen(path, "r");
+    if (trace == NULL) {
+        perror(path);
+        return 1;
+    }
+
+    B91PmGovernorInit(&gov);
+    gov.param[B91_PM_MODE_DEEP_RET].enabled = deepRet;
+
+    char line[128];
+    uint64_t totalUs = 0;
+    while (fgets(line, sizeof(line), trace) != NULL) {
+        unsigned int expected, actual;
+        int n = sscanf(line, "%u %u", &expected, &actual);
+        if (n < 1) {
+            continue;
+        }
+        if ((n < 2) || (actual > expected)) {
+            actual = expected;
+        }
+
+        B91PmMode mode = B91PmGovernorSelect(&gov, expected, B91_PM_MODE_MASK_ALL);
+        uint32_t exitLatencyUs = (actual == expected) ? gov.param[mode].exitLatencyUs : 0;
+        B91PmGovernorUpdate(&gov, mode, expected, actual, exitLatencyUs);
+        totalUs += actual;
+    }
+
+    uint64_t chargeUaUs = 0;
+    printf("mode      entries  early  residency(ms)  share  charge(uAs)\n");
+    for (int i = 0; i < B91_PM_MODE_NUM; i++) {
+        const B91PmModeStats *stats = &gov.stats[i];
+        printf("%-8s %8u %6u %14.1f %5.1f%% %12.1f\n", g_modeNames[i], stats->entries, stats->earlyWakeups,
+               stats->residencyUs / 1e3, totalUs ? 100.0 * stats->residencyUs / totalUs : 0.0,
+               stats->chargeUaUs / 1e6);
+        chargeUaUs += stats->chargeUaUs;
+    }
+    printf("average idle current %.1f uA\n", totalUs ? (double)chargeUaUs / totalUs : 0.0);
+
+    if (trace != stdin) {
+        fclose(trace);
+    }
+    return 0;
+}
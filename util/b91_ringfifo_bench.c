@@ -0,0 +1,521 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+/*
+ * Fuzzes and benchmarks the ring FIFO of the SDK on the host.
+ *
+ *     cc -O2 -DWIN32 -pthread -I b91/b91_ble_sdk -I b91/b91_ble_sdk/common -o b91_ringfifo_bench \
+ *         util/b91_ringfifo_bench.c b91/b91_ble_sdk/common/ring_fifo.c
+ *     ./b91_ringfifo_bench [-f fuzz rounds] [-s seconds] [-p producers] [-r ring size] [-x seed]
+ *
+ * (WIN32 only keeps types.h from redefining size_t.)
+ *
+ * The fuzz part drives rings of random sizes with random operations from one thread: batches of single
+ * producer reservations, multiple producer reservations committed out of order, gets and releases of
+ * random runs of records. Every step is checked against a plain queue of the records that should be
+ * there: order, length, contents, the used byte count, no write past the end of the ring, and that a
+ * record of up to half the ring always fits an empty ring.
+ *
+ * The benchmark then runs a consumer thread against one producer pushing records one by one, one producer
+ * committing batches, and several producers sharing a multiple producer ring, each record carrying its
+ * producer and sequence number, checked by the consumer. The same single producer load runs through a
+ * copy of my_fifo with slots of the largest record, with the release and acquire ordering it lacks added.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ring_fifo.h"
+
+#define RING_MAX       (1U << 16)
+#define PRODUCER_MAX   8
+#define REC_MAX_LEN    96
+#define REC_MIN_LEN    8 /* producer id and sequence number */
+#define BATCH          8
+#define MP_HELD_MAX    8
+#define MODEL_MAX      (RING_MAX / RING_FIFO_HDR_SIZE)
+#define MYFIFO_NUM     64 /* my_fifo indexes are 8 bit */
+#define GUARD          0xa5
+#define GUARD_LEN      (REC_MAX_LEN + 8)
+
+typedef struct {
+    uint32_t seq;
+    uint16_t len;
+    uint8_t committed;
+} ModelRec;
+
+/* Records that should be in the ring, oldest first; the ones got are not released yet */
+typedef struct {
+    ModelRec rec[MODEL_MAX];
+    uint32_t first;
+    uint32_t got;
+    uint32_t count;
+} Model;
+
+static u8 g_mem[RING_MAX + GUARD_LEN] __attribute__((aligned(4)));
+static ring_fifo_t g_fifo;
+static volatile int g_stop;
+static volatile uint32_t g_errors;
+
+static double NowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static uint8_t Pattern(uint32_t seq, uint32_t i)
+{
+    return (uint8_t)(seq * 31U + i * 7U + 1U);
+}
+
+static void FillPattern(u8 *p, uint32_t seq, uint16_t len)
+{
+    for (uint32_t i = 0; i < len; i++) {
+        p[i] = Pattern(seq, i);
+    }
+}
+
+/* The pattern behind the producer and the sequence number, for the benchmark */
+static void Fill(u8 *p, uint32_t id, uint32_t seq, uint16_t len)
+{
+    FillPattern(p, seq, len);
+    if (len >= REC_MIN_LEN) {
+        memcpy(p, &id, sizeof(id));
+        memcpy(p + sizeof(id), &seq, sizeof(seq));
+    }
+}
+
+static int Check(const u8 *p, uint32_t seq, uint16_t len)
+{
+    for (uint32_t i = 0; i < len; i++) {
+        if (p[i] != Pattern(seq, i)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void Fail(const char *what, uint32_t round, uint32_t step)
+{
+    printf("fuzz: %s in round %u step %u\n", what, round, step);
+    exit(1);
+}
+
+static uint16_t RandLen(unsigned *seed, uint32_t size)
+{
+    uint32_t max = size / 2 - RING_FIFO_HDR_SIZE;
+    if (max > REC_MAX_LEN) {
+        max = REC_MAX_LEN;
+    }
+    return (uint16_t)(rand_r(seed) % (max + 1));
+}
+
+/* Gets a random run of the first visible records and releases all records got, or only gets them */
+static void FuzzConsume(Model *m, uint32_t visible, unsigned *seed, uint32_t round, uint32_t step)
+{
+    uint32_t n = (uint32_t)rand_r(seed) % 5;
+
+    for (uint32_t i = 0; i < n; i++) {
+        u16 len = 0;
+        u8 *p = ring_fifo_get(&g_fifo, &len);
+        if (m->got == visible) {
+            if (p != NULL) {
+                Fail("record got before it was published", round, step);
+            }
+            break;
+        }
+        ModelRec *r = &m->rec[(m->first + m->got) % MODEL_MAX];
+        if (p == NULL) {
+            Fail("published record not got", round, step);
+        }
+        if (len != r->len || Check(p, r->seq, len) != 0) {
+            Fail("record out of order or corrupted", round, step);
+        }
+        m->got++;
+    }
+    if (rand_r(seed) % 2) {
+        ring_fifo_release(&g_fifo);
+        m->first = (m->first + m->got) % MODEL_MAX;
+        m->count -= m->got;
+        m->got = 0;
+    }
+    if (ring_fifo_used(&g_fifo) > g_fifo.size) {
+        Fail("more bytes used than the ring has", round, step);
+    }
+    for (uint32_t i = 0; i < GUARD_LEN; i++) {
+        if (g_mem[g_fifo.size + i] != GUARD) {
+            Fail("record written past the end of the ring", round, step);
+        }
+    }
+}
+
+static void FuzzSp(uint32_t round, unsigned *seed, uint32_t steps)
+{
+    static Model m;
+    uint32_t seq = 0;
+
+    memset(&m, 0, sizeof(m));
+    for (uint32_t step = 0; step < steps; step++) {
+        uint32_t n = 1 + (uint32_t)rand_r(seed) % BATCH;
+        uint32_t reserved = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            uint16_t len = RandLen(seed, g_fifo.size);
+            int empty = (m.count + reserved == 0) && (ring_fifo_used(&g_fifo) == 0);
+            u8 *p = ring_fifo_reserve(&g_fifo, len);
+            if (p == NULL) {
+                if (empty) {
+                    Fail("record of half the ring refused by an empty ring", round, step);
+                }
+                break;
+            }
+            if ((uintptr_t)p & 3) {
+                Fail("unaligned payload", round, step);
+            }
+            FillPattern(p, seq, len);
+            m.rec[(m.first + m.count + reserved) % MODEL_MAX] = (ModelRec){seq++, len, 1};
+            reserved++;
+            if (m.got == m.count && ring_fifo_get(&g_fifo, NULL) != NULL) {
+                Fail("record got before the commit", round, step);
+            }
+        }
+        ring_fifo_commit(&g_fifo);
+        m.count += reserved;
+        FuzzConsume(&m, m.count, seed, round, step);
+    }
+}
+
+static void FuzzMp(uint32_t round, unsigned *seed, uint32_t steps)
+{
+    static Model m;
+    u8 *held[MP_HELD_MAX];
+    ModelRec *heldRec[MP_HELD_MAX];
+    uint32_t heldNum = 0;
+    uint32_t seq = 0;
+
+    memset(&m, 0, sizeof(m));
+    for (uint32_t step = 0; step < steps; step++) {
+        /* Reserve a few and commit a random one of the held records, as preempted producers would */
+        uint32_t n = (uint32_t)rand_r(seed) % 3;
+        for (uint32_t i = 0; i < n && heldNum < MP_HELD_MAX; i++) {
+            uint16_t len = RandLen(seed, g_fifo.size);
+            int empty = (m.count == 0) && (ring_fifo_used(&g_fifo) == 0);
+            u8 *p = ring_fifo_mpReserve(&g_fifo, len);
+            if (p == NULL) {
+                if (empty) {
+                    Fail("record of half the ring refused by an empty ring", round, step);
+                }
+                break;
+            }
+            FillPattern(p, seq, len);
+            ModelRec *r = &m.rec[(m.first + m.count++) % MODEL_MAX];
+            *r = (ModelRec){seq++, len, 0};
+            held[heldNum] = p;
+            heldRec[heldNum++] = r;
+        }
+        if (heldNum != 0 && rand_r(seed) % 2) {
+            uint32_t k = (uint32_t)rand_r(seed) % heldNum;
+            ring_fifo_mpCommit(&g_fifo, held[k]);
+            heldRec[k]->committed = 1;
+            held[k] = held[--heldNum];
+            heldRec[k] = heldRec[heldNum];
+        }
+
+        /* The consumer sees the committed records up to the first one still held */
+        uint32_t visible = m.got;
+        while (visible < m.count && m.rec[(m.first + visible) % MODEL_MAX].committed) {
+            visible++;
+        }
+        FuzzConsume(&m, visible, seed, round, step);
+    }
+}
+
+static void Fuzz(uint32_t rounds, unsigned seed)
+{
+    for (uint32_t round = 0; round < rounds; round++) {
+        uint32_t size = 8U << (rand_r(&seed) % 10);
+        u8 mp = (u8)(round & 1);
+        if (ring_fifo_init(&g_fifo, g_mem, size, mp) != 0) {
+            Fail("ring refused", round, 0);
+        }
+        memset(g_mem + size, GUARD, GUARD_LEN);
+        if (mp) {
+            FuzzMp(round, &seed, 2000);
+        } else {
+            FuzzSp(round, &seed, 2000);
+        }
+    }
+    printf("fuzz: %u rounds ok\n", rounds);
+}
+
+/* my_fifo of utility.c, with the ordering between its index and slot accesses that threads need */
+typedef struct {
+    u32 size;
+    u16 num;
+    u8 wptr;
+    u8 rptr;
+    u8 *p;
+} MyFifo;
+
+static MyFifo g_myFifo;
+
+static int MyFifoPush(MyFifo *f, const u8 *p, int n)
+{
+    u8 w = f->wptr;
+    if (((w - __atomic_load_n(&f->rptr, __ATOMIC_ACQUIRE)) & 255) >= f->num || n >= (int)f->size) {
+        return -1;
+    }
+    u8 *pd = f->p + (w & (f->num - 1)) * f->size;
+    *pd++ = n & 0xff;
+    *pd++ = (n >> 8) & 0xff;
+    memcpy(pd, p, n);
+    __atomic_store_n(&f->wptr, (u8)(w + 1), __ATOMIC_RELEASE);
+    return 0;
+}
+
+static u8 *MyFifoGet(MyFifo *f)
+{
+    u8 r = f->rptr;
+    if (r != __atomic_load_n(&f->wptr, __ATOMIC_ACQUIRE)) {
+        return f->p + (r & (f->num - 1)) * f->size;
+    }
+    return NULL;
+}
+
+static void MyFifoPop(MyFifo *f)
+{
+    __atomic_store_n(&f->rptr, (u8)(f->rptr + 1), __ATOMIC_RELEASE);
+}
+
+typedef enum {
+    MODE_SP,
+    MODE_SP_BATCH,
+    MODE_MP,
+    MODE_MYFIFO,
+} Mode;
+
+typedef struct {
+    Mode mode;
+    uint32_t id;
+    uint64_t records;
+    uint64_t full;
+} Producer;
+
+static void *ProducerMain(void *arg)
+{
+    Producer *pr = arg;
+    unsigned seed = pr->id * 7919U;
+    uint32_t seq = 0;
+    u8 rec[REC_MAX_LEN];
+
+    while (!g_stop) {
+        uint16_t len = (uint16_t)(REC_MIN_LEN + rand_r(&seed) % (REC_MAX_LEN - REC_MIN_LEN + 1));
+        int ok;
+
+        switch (pr->mode) {
+            case MODE_SP_BATCH: {
+                uint32_t n = 0;
+                for (; n < BATCH; n++) {
+                    u8 *p = ring_fifo_reserve(&g_fifo, len);
+                    if (p == NULL) {
+                        break;
+                    }
+                    Fill(p, pr->id, seq++, len);
+                }
+                if (n != 0) {
+                    ring_fifo_commit(&g_fifo);
+                }
+                pr->records += n;
+                ok = (n != 0);
+                break;
+            }
+            case MODE_MP: {
+                u8 *p = ring_fifo_mpReserve(&g_fifo, len);
+                ok = (p != NULL);
+                if (ok) {
+                    Fill(p, pr->id, seq++, len);
+                    ring_fifo_mpCommit(&g_fifo, p);
+                    pr->records++;
+                }
+                break;
+            }
+            case MODE_MYFIFO:
+                Fill(rec, pr->id, seq, len);
+                ok = (MyFifoPush(&g_myFifo, rec, len) == 0);
+                seq += ok;
+                pr->records += ok;
+                break;
+            default:
+                Fill(rec, pr->id, seq, len);
+                ok = (ring_fifo_push(&g_fifo, rec, len) == 0);
+                seq += ok;
+                pr->records += ok;
+                break;
+        }
+        if (!ok) {
+            pr->full++;
+            sched_yield(); /* lets the consumer run on a host with few cores */
+        }
+    }
+    return NULL;
+}
+
+static void Consume(const u8 *p, uint16_t len, uint32_t *next, uint64_t *bytes)
+{
+    uint32_t id;
+    uint32_t seq;
+    memcpy(&id, p, sizeof(id));
+    memcpy(&seq, p + sizeof(id), sizeof(seq));
+    if (id >= PRODUCER_MAX) {
+        g_errors++;
+        return;
+    }
+    if (seq != next[id]) {
+        g_errors++;
+    }
+    for (uint32_t i = REC_MIN_LEN; i < len; i++) {
+        if (p[i] != Pattern(seq, i)) {
+            g_errors++;
+            break;
+        }
+    }
+    next[id] = seq + 1;
+    *bytes += len;
+}
+
+static void Bench(const char *name, Mode mode, uint32_t producers, uint32_t seconds, uint32_t size)
+{
+    static u8 myFifoMem[MYFIFO_NUM * (REC_MAX_LEN + 4)] __attribute__((aligned(4)));
+    pthread_t tids[PRODUCER_MAX];
+    Producer prod[PRODUCER_MAX];
+    uint32_t next[PRODUCER_MAX] = {0};
+    uint64_t records = 0;
+    uint64_t bytes = 0;
+    uint64_t full = 0;
+    uint32_t ringBytes = size;
+
+    if (mode == MODE_MYFIFO) {
+        g_myFifo = (MyFifo){REC_MAX_LEN + 4, MYFIFO_NUM, 0, 0, myFifoMem};
+        ringBytes = sizeof(myFifoMem);
+    } else {
+        ring_fifo_init(&g_fifo, g_mem, size, mode == MODE_MP);
+    }
+    g_stop = 0;
+    g_errors = 0;
+
+    for (uint32_t t = 0; t < producers; t++) {
+        prod[t] = (Producer){mode, t, 0, 0};
+        pthread_create(&tids[t], NULL, ProducerMain, &prod[t]);
+    }
+
+    double end = NowNs() + seconds * 1e9;
+    uint32_t polls = 0;
+    for (;;) {
+        u16 len;
+        u8 *p;
+        if (mode == MODE_MYFIFO) {
+            p = MyFifoGet(&g_myFifo);
+            if (p != NULL) {
+                len = (u16)(p[0] | (p[1] << 8));
+                Consume(p + 2, len, next, &bytes);
+                MyFifoPop(&g_myFifo);
+                records++;
+            }
+        } else {
+            /* Release every few records, the batch counterpart of the producer side */
+            uint32_t n = 0;
+            while (n < BATCH && (p = ring_fifo_get(&g_fifo, &len)) != NULL) {
+                Consume(p, len, next, &bytes);
+                n++;
+            }
+            if (n != 0) {
+                ring_fifo_release(&g_fifo);
+            }
+            records += n;
+            p = (n != 0) ? g_mem : NULL;
+        }
+        if (p == NULL) {
+            if (g_stop) {
+                break;
+            }
+            sched_yield();
+        }
+        if ((++polls & 1023) == 0 && !g_stop && NowNs() >= end) {
+            g_stop = 1;
+            for (uint32_t t = 0; t < producers; t++) {
+                pthread_join(tids[t], NULL);
+            }
+        }
+    }
+
+    uint64_t produced = 0;
+    for (uint32_t t = 0; t < producers; t++) {
+        produced += prod[t].records;
+        full += prod[t].full;
+    }
+    printf("%-9s %u prod %6u B ring %9.2f Mrec/s %8.1f MB/s %11llu full  %s\n", name, producers, ringBytes,
+           (double)records / seconds / 1e6, (double)bytes / seconds / 1e6, (unsigned long long)full,
+           (g_errors == 0 && produced == records) ? "ok" : "CORRUPTED");
+    if (g_errors != 0 || produced != records) {
+        printf("  %u bad records, %llu produced, %llu consumed\n", g_errors, (unsigned long long)produced,
+               (unsigned long long)records);
+        exit(1);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t rounds = 200;
+    uint32_t seconds = 1;
+    uint32_t producers = 3;
+    uint32_t size = 4096;
+    unsigned seed = 1;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        uint32_t v = (uint32_t)strtoul(argv[i + 1], NULL, 0);
+        if (strcmp(argv[i], "-f") == 0) {
+            rounds = v;
+        } else if (strcmp(argv[i], "-s") == 0) {
+            seconds = v;
+        } else if (strcmp(argv[i], "-p") == 0) {
+            producers = v;
+        } else if (strcmp(argv[i], "-r") == 0) {
+            size = v;
+        } else if (strcmp(argv[i], "-x") == 0) {
+            seed = v;
+        }
+    }
+    if (seconds == 0 || producers == 0 || producers > PRODUCER_MAX || size < 4 * REC_MAX_LEN || size > RING_MAX ||
+        (size & (size - 1))) {
+        fprintf(stderr, "usage: %s [-f rounds] [-s seconds] [-p 1..%u] [-r power of two %u..%u] [-x seed]\n",
+                argv[0], PRODUCER_MAX, 4 * REC_MAX_LEN, RING_MAX);
+        return 1;
+    }
+
+    Fuzz(rounds, seed);
+    Bench("push", MODE_SP, 1, seconds, size);
+    Bench("batch", MODE_SP_BATCH, 1, seconds, size);
+    Bench("mp", MODE_MP, producers, seconds, size);
+    Bench("my_fifo", MODE_MYFIFO, 1, seconds, size);
+    return 0;
+}
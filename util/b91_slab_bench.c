@@ -0,0 +1,336 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+/*
+ * Replays an allocation trace through the B91 size class allocator on the host.
+ *
+ *     cc -O2 -I b91/liteos_m/inc -o b91_slab_bench util/b91_slab_bench.c b91/liteos_m/src/slab_b91.c
+ *     ./b91_slab_bench [-n repeat] trace.txt
+ *
+ * The trace is the log of a build with B91_MALLOC_TRACE: "a <ptr> <size>" per malloc or calloc, "f <ptr>"
+ * per free and both per realloc, other lines are skipped. util/b91_slab_ecdh_trace.txt is one recorded over
+ * an mbedtls ECDH key exchange. The trace is replayed repeat times through the host malloc and through the
+ * slab allocator, whose pages come from a static region of B91_SLAB_REGION_SIZE as on the B91 and whose
+ * larger blocks, and those no page is left for, go to the host malloc. The time per call of both is printed
+ * with the slab statistics and the fragmentation at the peak page count.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <slab_b91.h>
+
+#define REGION_PAGES (B91_SLAB_REGION_SIZE / B91_SLAB_PAGE_SIZE)
+#define LINE_MAX_LEN 128
+
+typedef struct {
+    uint32_t slot; /* live block the event works on */
+    uint32_t size; /* 0 for free */
+} Event;
+
+typedef struct {
+    unsigned long ptr;
+    uint32_t slot;
+    bool used;
+} PtrEntry;
+
+static Event *g_events;
+static uint32_t g_eventNum;
+static uint32_t g_slotNum;
+
+static PtrEntry *g_ptrs;
+static uint32_t g_ptrCap;
+
+static _Alignas(B91_SLAB_PAGE_SIZE) uint8_t g_region[B91_SLAB_REGION_SIZE];
+static bool g_pageUsed[REGION_PAGES];
+
+static void *RegionPageAlloc(void *ctx)
+{
+    (void)ctx;
+    for (uint32_t i = 0; i < REGION_PAGES; i++) {
+        if (!g_pageUsed[i]) {
+            g_pageUsed[i] = true;
+            return &g_region[i * B91_SLAB_PAGE_SIZE];
+        }
+    }
+    return NULL;
+}
+
+static void RegionPageFree(void *ctx, void *page)
+{
+    (void)ctx;
+    g_pageUsed[((uint8_t *)page - g_region) / B91_SLAB_PAGE_SIZE] = false;
+}
+
+/* Open addressing map of the live trace pointers to block slots */
+static PtrEntry *PtrFind(unsigned long ptr)
+{
+    uint32_t i = (uint32_t)((ptr >> 3) * 2654435761U) & (g_ptrCap - 1);
+    while (g_ptrs[i].used && g_ptrs[i].ptr != ptr) {
+        i = (i + 1) & (g_ptrCap - 1);
+    }
+    return &g_ptrs[i];
+}
+
+static void PtrRemove(PtrEntry *e)
+{
+    /* Backward shift deletion keeps the probe chains intact */
+    uint32_t i = (uint32_t)(e - g_ptrs);
+    g_ptrs[i].used = false;
+    for (uint32_t j = (i + 1) & (g_ptrCap - 1); g_ptrs[j].used; j = (j + 1) & (g_ptrCap - 1)) {
+        PtrEntry moved = g_ptrs[j];
+        g_ptrs[j].used = false;
+        *PtrFind(moved.ptr) = moved;
+    }
+}
+
+static int LoadTrace(FILE *trace)
+{
+    uint32_t cap = 4096;
+    uint32_t live = 0;
+    uint32_t *freeSlots = NULL;
+    uint32_t freeNum = 0;
+    char line[LINE_MAX_LEN];
+
+    g_ptrCap = 1U << 16;
+    g_ptrs = calloc(g_ptrCap, sizeof(*g_ptrs));
+    g_events = malloc(cap * sizeof(*g_events));
+    freeSlots = malloc(g_ptrCap * sizeof(*freeSlots));
+    if (g_ptrs == NULL || g_events == NULL || freeSlots == NULL) {
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), trace) != NULL) {
+        char op;
+        unsigned long ptr;
+        unsigned long size = 0;
+        int n = sscanf(line, " %c %lx %lu", &op, &ptr, &size);
+        if (n < 2 || (op != 'a' && op != 'f') || (op == 'a' && (n < 3 || ptr == 0))) {
+            continue;
+        }
+
+        PtrEntry *e = PtrFind(ptr);
+        Event ev;
+        if (op == 'a') {
+            if (e->used || live + 1 >= g_ptrCap / 2) {
+                continue; /* lost free in the log, or too many live blocks */
+            }
+            e->used = true;
+            e->ptr = ptr;
+            e->slot = (freeNum != 0) ? freeSlots[--freeNum] : g_slotNum++;
+            live++;
+            ev.slot = e->slot;
+            ev.size = (uint32_t)size;
+        } else {
+            if (!e->used) {
+                continue; /* allocated before the trace started */
+            }
+            ev.slot = e->slot;
+            ev.size = 0;
+            freeSlots[freeNum++] = e->slot;
+            PtrRemove(e);
+            live--;
+        }
+
+        if (g_eventNum == cap) {
+            cap *= 2;
+            Event *grown = realloc(g_events, cap * sizeof(*g_events));
+            if (grown == NULL) {
+                return -1;
+            }
+            g_events = grown;
+        }
+        g_events[g_eventNum++] = ev;
+    }
+
+    free(freeSlots);
+    return 0;
+}
+
+static double NowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static double ReplayHost(void **slots, uint32_t repeat)
+{
+    double start = NowNs();
+    for (uint32_t r = 0; r < repeat; r++) {
+        for (uint32_t i = 0; i < g_eventNum; i++) {
+            const Event *ev = &g_events[i];
+            if (ev->size != 0) {
+                slots[ev->slot] = malloc(ev->size);
+            } else {
+                free(slots[ev->slot]);
+                slots[ev->slot] = NULL;
+            }
+        }
+        for (uint32_t s = 0; s < g_slotNum; s++) {
+            free(slots[s]);
+            slots[s] = NULL;
+        }
+    }
+    return NowNs() - start;
+}
+
+typedef struct {
+    uint32_t fallbacks;    /* allocations per pass sent to the host malloc */
+    uint32_t peakPages;    /* most slab pages held at once */
+    uint64_t liveAtPeak;   /* bytes requested by the live slab objects when the page peak was reached */
+    uint64_t handedAtPeak; /* class bytes of the same objects */
+} SlabRun;
+
+static uint32_t SlabPages(const B91Slab *slab)
+{
+    uint32_t pages = 0;
+    for (uint32_t c = 0; c < B91_SLAB_CLASS_NUM; c++) {
+        pages += slab->stats[c].pages;
+    }
+    return pages;
+}
+
+/* With run set the fragmentation is tracked too, which costs more than the allocator itself */
+static double ReplaySlab(B91Slab *slab, void **slots, uint32_t *sizes, uint32_t repeat, SlabRun *run)
+{
+    uint64_t live = 0;
+    uint64_t handed = 0;
+    uint32_t fallbacks = 0;
+
+    double start = NowNs();
+    for (uint32_t r = 0; r < repeat; r++) {
+        for (uint32_t i = 0; i <= g_eventNum; i++) {
+            if (i < g_eventNum && g_events[i].size != 0) {
+                const Event *ev = &g_events[i];
+                void *p = B91SlabAlloc(slab, ev->size);
+                if (p == NULL) {
+                    p = malloc(ev->size);
+                    fallbacks++;
+                } else if (run != NULL) {
+                    live += ev->size;
+                    handed += B91SlabObjectSize(slab, p);
+                    uint32_t pages = SlabPages(slab);
+                    if (pages > run->peakPages) {
+                        run->peakPages = pages;
+                        run->liveAtPeak = live;
+                        run->handedAtPeak = handed;
+                    }
+                }
+                slots[ev->slot] = p;
+                sizes[ev->slot] = ev->size;
+                continue;
+            }
+
+            /* A free, or at the end of a pass every block still live */
+            uint32_t first = (i < g_eventNum) ? g_events[i].slot : 0;
+            uint32_t last = (i < g_eventNum) ? first + 1 : g_slotNum;
+            for (uint32_t s = first; s < last; s++) {
+                void *p = slots[s];
+                if (p == NULL) {
+                    continue;
+                }
+                uint32_t objSize = (run != NULL) ? B91SlabObjectSize(slab, p) : 0;
+                if (B91SlabFree(slab, p)) {
+                    live -= (run != NULL) ? sizes[s] : 0;
+                    handed -= objSize;
+                } else {
+                    free(p);
+                }
+                slots[s] = NULL;
+            }
+        }
+    }
+    double ns = NowNs() - start;
+
+    if (run != NULL) {
+        run->fallbacks = fallbacks / repeat;
+    }
+    return ns;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t repeat = 100;
+    int argi = 1;
+    if (argc > 2 && strcmp(argv[1], "-n") == 0) {
+        repeat = (uint32_t)strtoul(argv[2], NULL, 0);
+        argi = 3;
+    }
+
+    const char *path = (argc > argi) ? argv[argi] : NULL;
+    FILE *trace = (path == NULL || strcmp(path, "-") == 0) ? stdin : fopen(path, "r");
+    if (trace == NULL) {
+        perror(path);
+        return 1;
+    }
+    int ret = LoadTrace(trace);
+    if (trace != stdin) {
+        fclose(trace);
+    }
+    if (ret != 0 || g_eventNum == 0 || repeat == 0) {
+        fprintf(stderr, "no allocations in the trace\n");
+        return 1;
+    }
+
+    void **slots = calloc(g_slotNum, sizeof(*slots));
+    uint32_t *sizes = calloc(g_slotNum, sizeof(*sizes));
+    if (slots == NULL || sizes == NULL) {
+        return 1;
+    }
+
+    double hostNs = ReplayHost(slots, repeat);
+
+    B91Slab slab;
+    B91SlabInit(&slab, (uintptr_t)g_region, B91_SLAB_REGION_SIZE, RegionPageAlloc, RegionPageFree, NULL);
+    double slabNs = ReplaySlab(&slab, slots, sizes, repeat, NULL);
+
+    /* One more pass for the statistics, on a fresh region */
+    SlabRun run = {0};
+    (void)memset(g_pageUsed, 0, sizeof(g_pageUsed));
+    B91SlabInit(&slab, (uintptr_t)g_region, B91_SLAB_REGION_SIZE, RegionPageAlloc, RegionPageFree, NULL);
+    (void)ReplaySlab(&slab, slots, sizes, 1, &run);
+
+    uint64_t calls = (uint64_t)g_eventNum * repeat;
+    printf("%u events, %u passes\n", g_eventNum, repeat);
+    printf("host malloc: %.1f ns per call\n", hostNs / (double)calls);
+    printf("slab:        %.1f ns per call, %u of the allocations sent to malloc\n", slabNs / (double)calls,
+           run.fallbacks);
+
+    printf("size    allocs  peak  pages  waste(%%)\n");
+    for (uint32_t c = 0; c < B91_SLAB_CLASS_NUM; c++) {
+        const B91SlabClassStats *st = &slab.stats[c];
+        uint64_t classBytes = (uint64_t)st->allocs * st->size;
+        printf("%4u %9u %5u %6u %9u\n", st->size, st->allocs, st->peakInUse, st->peakPages,
+               classBytes ? (uint32_t)(((classBytes - st->requested) * 100) / classBytes) : 0);
+    }
+
+    uint64_t pageBytes = (uint64_t)run.peakPages * B91_SLAB_PAGE_SIZE;
+    printf("peak %u pages (%llu bytes): %llu requested, %llu in classes, %u%% of the pages unused\n",
+           run.peakPages, (unsigned long long)pageBytes, (unsigned long long)run.liveAtPeak,
+           (unsigned long long)run.handedAtPeak,
+           pageBytes ? (uint32_t)(((pageBytes - run.liveAtPeak) * 100) / pageBytes) : 0);
+
+    free(slots);
+    free(sizes);
+    free(g_events);
+    free(g_ptrs);
+    return 0;
+}
@@ -0,0 +1,535 @@
+/******************************************************************************
+ * Copyright (c) 2022 Telink Semiconductor (Shanghai) Co., Ltd. ("TELINK")
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *****************************************************************************/
+
+/*
+ * Checks and benchmarks the soft timer heap of vendor/common/blt_soft_timer.c on the host.
+ *
+ *     cc -O2 -DWIN32 -I b91/b91_ble_sdk -o b91_softtimer_bench util/b91_softtimer_bench.c
+ *     ./b91_softtimer_bench [-r rounds] [-x seed]
+ *
+ * (WIN32 only keeps types.h from redefining size_t.)
+ *
+ * blt_soft_timer.c is built into this file with MAX_TIMER_NUM 512, over a system timer and a wakeup
+ * programming call of its own, next to a copy of the bubble sorted table it replaced. Random adds,
+ * deletes and passes of the process are run on both with the same clock, starting next to the 32 bit
+ * wrap, and the timers fired by each pass and every blc_pm_setAppWakeupLowPower call must match. The
+ * copy deletes the timer after one returning -1 without running it and reads the stale first entry
+ * when its last timer is deleted, so these are left out of the comparison and checked on the heap alone,
+ * with stable handles, callbacks changing the table, and deadlines more than BIT(30) ticks apart.
+ *
+ * The time per add, expiry and delete is then measured on both with 16 to 512 timers.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TL_COMMON_H_ /* the SDK headers of the target are not needed */
+#define BLE_H_
+
+#include "common/bit.h"
+#include "common/types.h"
+
+#define SYSTEM_TIMER_TICK_1US 16
+#define SYSTEM_TIMER_TICK_1MS 16000
+#define SYSTEM_TIMER_TICK_1S  16000000
+
+#define _attribute_ble_data_retention_
+
+#define BLT_SOFTWARE_TIMER_ENABLE 1
+#define MAX_TIMER_NUM             512
+
+#define LOG_MAX   (4 * MAX_TIMER_NUM)
+#define WRAP_NEAR 0xfff00000U
+
+typedef struct {
+    u32 tick;
+    u8 enable;
+} Wakeup;
+
+typedef struct {
+    Wakeup wakeup[LOG_MAX];
+    u32 wakeupNum;
+    u16 fired[LOG_MAX];
+    u32 firedNum;
+} Log;
+
+static u32 g_now;
+static Log g_heapLog;
+static Log g_refLog;
+static Log *g_log = &g_heapLog;
+
+static u32 clock_time(void)
+{
+    return g_now;
+}
+
+static void blc_pm_setAppWakeupLowPower(u32 wakeup_tick, u8 enable)
+{
+    if (g_log->wakeupNum < LOG_MAX) {
+        g_log->wakeup[g_log->wakeupNum++] = (Wakeup){wakeup_tick, enable};
+    }
+}
+
+static void blc_pm_registerAppWakeupLowPowerCb(void (*cb)(int))
+{
+    (void)cb;
+}
+
+#include "vendor/common/blt_soft_timer.c"
+
+/* The bubble sorted table blt_soft_timer.c had before, as it was */
+static struct {
+    blt_time_event_t timer[MAX_TIMER_NUM];
+    u16 currentNum;
+} ref_timer;
+
+static int ref_sort(void)
+{
+    int n = ref_timer.currentNum;
+    u8 temp[sizeof(blt_time_event_t)];
+
+    for (int i = 0; i < n - 1; i++) {
+        for (int j = 0; j < n - i - 1; j++) {
+            if (TIME_COMPARE_BIG(ref_timer.timer[j].t, ref_timer.timer[j + 1].t)) {
+                memcpy(temp, &ref_timer.timer[j], sizeof(blt_time_event_t));
+                memcpy(&ref_timer.timer[j], &ref_timer.timer[j + 1], sizeof(blt_time_event_t));
+                memcpy(&ref_timer.timer[j + 1], temp, sizeof(blt_time_event_t));
+            }
+        }
+    }
+    return 1;
+}
+
+static int ref_add(blt_timer_callback_t func, u32 interval_us)
+{
+    u32 now = clock_time();
+
+    if (ref_timer.currentNum >= MAX_TIMER_NUM) {
+        return 0;
+    }
+    ref_timer.timer[ref_timer.currentNum].cb = func;
+    ref_timer.timer[ref_timer.currentNum].interval = interval_us * SYSTEM_TIMER_TICK_1US;
+    ref_timer.timer[ref_timer.currentNum].t = now + ref_timer.timer[ref_timer.currentNum].interval;
+    ref_timer.currentNum++;
+    ref_sort();
+    blc_pm_setAppWakeupLowPower(ref_timer.timer[0].t, 1);
+    return 1;
+}
+
+static void ref_delete_by_index(int index)
+{
+    for (int i = index; i < ref_timer.currentNum - 1; i++) {
+        memcpy(&ref_timer.timer[i], &ref_timer.timer[i + 1], sizeof(blt_time_event_t));
+    }
+    ref_timer.currentNum--;
+}
+
+static int ref_delete(blt_timer_callback_t func)
+{
+    for (int i = 0; i < ref_timer.currentNum; i++) {
+        if (ref_timer.timer[i].cb == func) {
+            ref_delete_by_index(i);
+            if (i == 0) {
+                if ((u32)(ref_timer.timer[0].t - clock_time()) < 3000 * SYSTEM_TIMER_TICK_1MS) {
+                    blc_pm_setAppWakeupLowPower(ref_timer.timer[0].t, 1);
+                } else {
+                    blc_pm_setAppWakeupLowPower(0, 0);
+                }
+            }
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void ref_process(void)
+{
+    u32 now = clock_time();
+    if (!ref_timer.currentNum) {
+        blc_pm_setAppWakeupLowPower(0, 0);
+        return;
+    }
+    if (!blt_is_timer_expired(ref_timer.timer[0].t, now)) {
+        return;
+    }
+
+    int change_flg = 0;
+    for (int i = 0; i < ref_timer.currentNum; i++) {
+        if (blt_is_timer_expired(ref_timer.timer[i].t, now)) {
+            int result = ref_timer.timer[i].cb();
+            if (result < 0) {
+                ref_delete_by_index(i);
+            } else if (result == 0) {
+                change_flg = 1;
+                ref_timer.timer[i].t = now + ref_timer.timer[i].interval;
+            } else {
+                change_flg = 1;
+                ref_timer.timer[i].interval = result * SYSTEM_TIMER_TICK_1US;
+                ref_timer.timer[i].t = now + ref_timer.timer[i].interval;
+            }
+        }
+    }
+
+    if (ref_timer.currentNum) {
+        if (change_flg) {
+            ref_sort();
+        }
+        if ((u32)(ref_timer.timer[0].t - now) < 3000 * SYSTEM_TIMER_TICK_1MS) {
+            blc_pm_setAppWakeupLowPower(ref_timer.timer[0].t, 1);
+        } else {
+            blc_pm_setAppWakeupLowPower(0, 0);
+        }
+    } else {
+        blc_pm_setAppWakeupLowPower(0, 0);
+    }
+}
+
+/* One callback per timer, the id tells which one fired; g_ret is what it returns */
+static int g_ret[MAX_TIMER_NUM];
+static void (*g_hook)(u16 id);
+
+static int Fire(u16 id)
+{
+    if (g_log->firedNum < LOG_MAX) {
+        g_log->fired[g_log->firedNum++] = id;
+    }
+    if (g_hook != NULL) {
+        g_hook(id);
+    }
+    return g_ret[id];
+}
+
+#define CB(n) static int Cb_##n(void) { return Fire(0x##n); }
+#define CB16(p)                                                                                                       \
+    CB(p##0) CB(p##1) CB(p##2) CB(p##3) CB(p##4) CB(p##5) CB(p##6) CB(p##7) CB(p##8) CB(p##9) CB(p##a) CB(p##b)      \
+    CB(p##c) CB(p##d) CB(p##e) CB(p##f)
+#define CB256(p)                                                                                                      \
+    CB16(p##0) CB16(p##1) CB16(p##2) CB16(p##3) CB16(p##4) CB16(p##5) CB16(p##6) CB16(p##7) CB16(p##8) CB16(p##9)    \
+    CB16(p##a) CB16(p##b) CB16(p##c) CB16(p##d) CB16(p##e) CB16(p##f)
+CB256(0)
+CB256(1)
+
+#define E(n) Cb_##n,
+#define E16(p)                                                                                                        \
+    E(p##0) E(p##1) E(p##2) E(p##3) E(p##4) E(p##5) E(p##6) E(p##7) E(p##8) E(p##9) E(p##a) E(p##b) E(p##c) E(p##d)  \
+    E(p##e) E(p##f)
+#define E256(p)                                                                                                       \
+    E16(p##0) E16(p##1) E16(p##2) E16(p##3) E16(p##4) E16(p##5) E16(p##6) E16(p##7) E16(p##8) E16(p##9) E16(p##a)    \
+    E16(p##b) E16(p##c) E16(p##d) E16(p##e) E16(p##f)
+static const blt_timer_callback_t g_cb[MAX_TIMER_NUM] = {E256(0) E256(1)};
+
+static void Fail(const char *what, u32 round, u32 step)
+{
+    printf("%s in round %u step %u\n", what, round, step);
+    exit(1);
+}
+
+static int CompareU16(const void *a, const void *b)
+{
+    return (int)*(const u16 *)a - (int)*(const u16 *)b;
+}
+
+/* The heap must order every slot after its parent, and the positions must match the slots */
+static void CheckHeap(u32 round, u32 step)
+{
+    for (u16 i = 0; i < blt_timer.currentNum; i++) {
+        if (blt_timer.heapPos[blt_timer.heap[i]] != i + 1) {
+            Fail("heap position out of step", round, step);
+        }
+        if (i > 0 && TIME_COMPARE_BEFORE(BLT_TIMER_HEAP_T(i), BLT_TIMER_HEAP_T((i - 1) / 2))) {
+            Fail("heap order broken", round, step);
+        }
+    }
+}
+
+static void CompareLogs(u32 round, u32 step)
+{
+    if (g_heapLog.wakeupNum != g_refLog.wakeupNum ||
+        memcmp(g_heapLog.wakeup, g_refLog.wakeup, g_heapLog.wakeupNum * sizeof(Wakeup)) != 0) {
+        Fail("wakeup programming differs from the sorted table", round, step);
+    }
+    /* Timers with the same deadline may fire in either order */
+    qsort(g_heapLog.fired, g_heapLog.firedNum, sizeof(u16), CompareU16);
+    qsort(g_refLog.fired, g_refLog.firedNum, sizeof(u16), CompareU16);
+    if (g_heapLog.firedNum != g_refLog.firedNum ||
+        memcmp(g_heapLog.fired, g_refLog.fired, g_heapLog.firedNum * sizeof(u16)) != 0) {
+        Fail("fired timers differ from the sorted table", round, step);
+    }
+    memset(&g_heapLog, 0, sizeof(g_heapLog));
+    memset(&g_refLog, 0, sizeof(g_refLog));
+}
+
+static void Reset(u32 now)
+{
+    memset(&blt_timer, 0, sizeof(blt_timer));
+    memset(&ref_timer, 0, sizeof(ref_timer));
+    memset(&g_heapLog, 0, sizeof(g_heapLog));
+    memset(&g_refLog, 0, sizeof(g_refLog));
+    memset(g_ret, 0, sizeof(g_ret));
+    g_hook = NULL;
+    g_now = now;
+}
+
+/* Same operations on the heap and the sorted table */
+static void Differential(u32 rounds, unsigned seed)
+{
+    for (u32 round = 0; round < rounds; round++) {
+        u16 limit = (u16)(4U << (rand_r(&seed) % 8)); /* 4 to 512 timers */
+        u8 live[MAX_TIMER_NUM] = {0};
+        u16 liveNum = 0;
+
+        if (limit > MAX_TIMER_NUM) {
+            limit = MAX_TIMER_NUM;
+        }
+        Reset(WRAP_NEAR + (u32)rand_r(&seed) % 0x100000);
+
+        for (u32 step = 0; step < 20 * (u32)limit; step++) {
+            u32 op = (u32)rand_r(&seed) % 8;
+            if (op < 3 && liveNum < limit) {
+                u16 id;
+                do {
+                    id = (u16)((u32)rand_r(&seed) % limit);
+                } while (live[id]);
+                u32 us = 1000 + (u32)rand_r(&seed) % 4000000;
+                g_ret[id] = (rand_r(&seed) % 3) ? 0 : (int)(1000 + (u32)rand_r(&seed) % 4000000);
+                g_log = &g_heapLog;
+                int h = blt_soft_timer_add(g_cb[id], us);
+                g_log = &g_refLog;
+                ref_add(g_cb[id], us);
+                if (h == 0) {
+                    Fail("add refused", round, step);
+                }
+                live[id] = 1;
+                liveNum++;
+            } else if (op < 4 && liveNum > 1) { /* the sorted table mishandles deleting its last timer */
+                u16 id;
+                do {
+                    id = (u16)((u32)rand_r(&seed) % limit);
+                } while (!live[id]);
+                g_log = &g_heapLog;
+                int a = blt_soft_timer_delete(g_cb[id]);
+                g_log = &g_refLog;
+                int b = ref_delete(g_cb[id]);
+                if (a != 1 || b != 1) {
+                    Fail("delete failed", round, step);
+                }
+                live[id] = 0;
+                liveNum--;
+            } else {
+                g_now += (u32)rand_r(&seed) % (500 * SYSTEM_TIMER_TICK_1MS);
+                g_log = &g_heapLog;
+                blt_soft_timer_process(MAINLOOP_ENTRY);
+                g_log = &g_refLog;
+                ref_process();
+            }
+            g_log = &g_heapLog;
+            if (blt_timer.currentNum != ref_timer.currentNum) {
+                Fail("timer count differs from the sorted table", round, step);
+            }
+            CheckHeap(round, step);
+            CompareLogs(round, step);
+        }
+    }
+    printf("differential: %u rounds ok\n", rounds);
+}
+
+static int g_handle[MAX_TIMER_NUM];
+static u16 g_victim;
+
+static void DeleteVictim(u16 id)
+{
+    (void)id;
+    blt_soft_timer_delete_by_handle(g_handle[g_victim]);
+}
+
+static void DeleteSelfAndAdd(u16 id)
+{
+    blt_soft_timer_delete_by_handle(g_handle[id]);
+    g_handle[id + 1] = blt_soft_timer_add(g_cb[id + 1], 1000);
+}
+
+static void HeapOnly(unsigned seed)
+{
+    /* Handles stay valid while other timers come and go */
+    Reset(WRAP_NEAR);
+    for (u16 id = 0; id < MAX_TIMER_NUM; id++) {
+        g_handle[id] = blt_soft_timer_add(g_cb[id], 1000 + (u32)rand_r(&seed) % 1000000);
+    }
+    if (blt_soft_timer_add(g_cb[0], 1000) != 0) {
+        Fail("add beyond MAX_TIMER_NUM accepted", 0, 0);
+    }
+    for (u16 id = 0; id < MAX_TIMER_NUM; id += 2) {
+        if (blt_soft_timer_delete_by_handle(g_handle[id]) != 1) {
+            Fail("delete by handle failed", 0, id);
+        }
+    }
+    for (u16 id = 1; id < MAX_TIMER_NUM; id += 2) {
+        if (blt_timer.timer[g_handle[id] - 1].cb != g_cb[id]) {
+            Fail("handle moved to another timer", 0, id);
+        }
+    }
+    if (blt_soft_timer_delete_by_handle(g_handle[0]) != 0 || blt_soft_timer_delete_by_handle(0) != 0) {
+        Fail("stale handle deleted", 0, 0);
+    }
+    CheckHeap(0, 0);
+
+    /* A timer returning -1 is deleted and the ones after it still run in the same pass */
+    Reset(WRAP_NEAR);
+    for (u16 id = 0; id < 8; id++) {
+        blt_soft_timer_add(g_cb[id], 1000 + id);
+        g_ret[id] = (id == 3) ? -1 : 0;
+    }
+    g_now += 2000 * SYSTEM_TIMER_TICK_1US;
+    blt_soft_timer_process(MAINLOOP_ENTRY);
+    if (g_heapLog.firedNum != 8 || blt_timer.currentNum != 7) {
+        Fail("timer returning -1 mishandled", 1, 0);
+    }
+    for (u16 id = 0; id < 8; id++) {
+        if (g_heapLog.fired[id] != id) {
+            Fail("timers fired out of deadline order across the wrap", 1, id);
+        }
+    }
+
+    /* Deleting the last timer disables the wakeup */
+    Reset(WRAP_NEAR);
+    g_handle[0] = blt_soft_timer_add(g_cb[0], 1000);
+    blt_soft_timer_delete_by_handle(g_handle[0]);
+    if (g_heapLog.wakeupNum != 2 || g_heapLog.wakeup[1].enable != 0) {
+        Fail("wakeup left on after the last delete", 2, 0);
+    }
+
+    /* Callbacks deleting other timers and themselves, and adding new ones */
+    Reset(WRAP_NEAR);
+    for (u16 id = 0; id < 4; id++) {
+        g_handle[id] = blt_soft_timer_add(g_cb[id], 1000 + id);
+    }
+    g_victim = 2;
+    g_hook = DeleteVictim;
+    g_now += 1000 * SYSTEM_TIMER_TICK_1US;
+    blt_soft_timer_process(MAINLOOP_ENTRY);
+    if (g_heapLog.firedNum != 3 || blt_timer.currentNum != 3 || blt_timer.heapPos[g_handle[2] - 1] != 0) {
+        Fail("timer deleted by a callback mishandled", 3, 0);
+    }
+    for (u32 i = 0; i < g_heapLog.firedNum; i++) {
+        if (g_heapLog.fired[i] == g_victim) {
+            Fail("timer deleted by a callback still fired", 3, i);
+        }
+    }
+    g_hook = DeleteSelfAndAdd;
+    g_now += 1000 * SYSTEM_TIMER_TICK_1US;
+    memset(&g_heapLog, 0, sizeof(g_heapLog));
+    blt_soft_timer_process(MAINLOOP_ENTRY);
+    CheckHeap(3, 1);
+
+    /* Deadlines more than BIT(30) ticks apart still order */
+    Reset(WRAP_NEAR);
+    blt_soft_timer_add(g_cb[0], 100000000); /* 100 s, 1.6e9 ticks */
+    blt_soft_timer_add(g_cb[1], 1000000);
+    if (blt_timer.heap[0] != 1) {
+        Fail("far deadline ordered before a near one", 4, 0);
+    }
+    printf("heap checks ok\n");
+}
+
+static double NowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* n timers, then passes that each expire a few of them, then every timer deleted */
+static void Bench(u16 n, int ref, unsigned seed, double *add, double *fire, double *del)
+{
+    u32 passes = 2000;
+    u32 fired = 0;
+
+    Reset(WRAP_NEAR);
+    g_log = ref ? &g_refLog : &g_heapLog;
+
+    double start = NowNs();
+    for (u16 id = 0; id < n; id++) {
+        u32 us = 10000 + (u32)rand_r(&seed) % 2000000;
+        if (ref) {
+            ref_add(g_cb[id], us);
+        } else {
+            blt_soft_timer_add(g_cb[id], us);
+        }
+        g_log->wakeupNum = 0;
+    }
+    *add = (NowNs() - start) / n;
+
+    start = NowNs();
+    for (u32 i = 0; i < passes; i++) {
+        g_now += 1000 * SYSTEM_TIMER_TICK_1US;
+        g_log->firedNum = 0;
+        g_log->wakeupNum = 0;
+        if (ref) {
+            ref_process();
+        } else {
+            blt_soft_timer_process(MAINLOOP_ENTRY);
+        }
+        fired += g_log->firedNum;
+    }
+    *fire = (NowNs() - start) / (fired ? fired : 1);
+
+    start = NowNs();
+    for (u16 id = 0; id < n; id++) {
+        g_log->wakeupNum = 0;
+        if (ref) {
+            ref_delete(g_cb[id]);
+        } else {
+            blt_soft_timer_delete(g_cb[id]);
+        }
+    }
+    *del = (NowNs() - start) / n;
+    g_log = &g_heapLog;
+}
+
+int main(int argc, char **argv)
+{
+    u32 rounds = 40;
+    unsigned seed = 1;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        u32 v = (u32)strtoul(argv[i + 1], NULL, 0);
+        if (strcmp(argv[i], "-r") == 0) {
+            rounds = v;
+        } else if (strcmp(argv[i], "-x") == 0) {
+            seed = v;
+        }
+    }
+
+    Differential(rounds, seed);
+    HeapOnly(seed);
+
+    printf("%6s  %22s  %22s  %22s\n", "timers", "add ns heap/sorted", "expiry ns heap/sorted",
+           "delete ns heap/sorted");
+    for (u16 n = 16; n <= MAX_TIMER_NUM; n *= 2) {
+        double add[2];
+        double fire[2];
+        double del[2];
+        Bench(n, 0, seed, &add[0], &fire[0], &del[0]);
+        Bench(n, 1, seed, &add[1], &fire[1], &del[1]);
+        printf("%6u  %10.0f / %9.0f  %10.0f / %9.0f  %10.0f / %9.0f\n", n, add[0], add[1], fire[0], fire[1], del[0],
+               del[1]);
+    }
+    return 0;
+}